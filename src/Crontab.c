@@ -0,0 +1,633 @@
+/**
+ * December 19, 2013
+ * The author disclaims copyright to this source code.
+ */
+
+#include "horo.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#define RETURN_ILLEGAL_IF(statement) if((statement)) return HORO_ERROR_ILLEGAL_ARG
+
+/*
+ * One schedule line of the crontab.  Lines are keyed by a hash of their
+ * trimmed contents: a line that is textually unchanged across a reload keeps
+ * its action, and with it its last run time.
+ */
+typedef struct
+{
+    uint64_t hash;
+    char* text;
+    int lineNumber;
+    int actionID;
+    void* actionData;
+    int matched;
+}crontabLine_t;
+
+struct horo_crontab
+{
+    horo_clock_t* clock;
+    char* path;
+    horo_resolveFunc resolve;
+    horo_releaseFunc release;
+    void* userp;
+    crontabLine_t* lines;
+    size_t lineCount;
+    int watchFD;
+    time_t modified;
+    off_t size;
+};
+
+static uint64_t
+hashLine(const char* text)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for(; *text; text++)
+    {
+        hash ^= (unsigned char)*text;
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static void
+freeLines(crontabLine_t* lines, size_t lineCount)
+{
+    size_t i = 0;
+
+    for(; i < lineCount; i++)
+    {
+        free(lines[i].text);
+    }
+    free(lines);
+}
+
+static HORO_ERROR
+readFile(const char* path, char** oContents)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    FILE* file = NULL;
+    char* contents = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    size_t got = 0;
+
+    file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        return HORO_ERROR_IO;
+    }
+
+    do
+    {
+        if(capacity - size < 4096)
+        {
+            char* grown = NULL;
+
+            capacity = (capacity == 0) ? 8192 : capacity * 2;
+            grown = (char*)realloc(contents, capacity + 1);
+            if(grown == NULL)
+            {
+                ret = HORO_ERROR_NO_MEM;
+                goto DONE;
+            }
+            contents = grown;
+        }
+
+        got = fread(contents + size, 1, capacity - size, file);
+        size += got;
+    }while(got > 0);
+
+    if(ferror(file))
+    {
+        ret = HORO_ERROR_IO;
+        goto DONE;
+    }
+
+    contents[size] = '\0';
+    *oContents = contents;
+    contents = NULL;
+
+DONE:
+    free(contents);
+    fclose(file);
+    return ret;
+}
+
+/*
+ * Collapses the whitespace between the schedule fields so that re-aligning
+ * the columns of a crontab does not count as a change.  The command is
+ * left as it is.
+ */
+static void
+normalizeLine(char* text)
+{
+    int separators = (text[0] == '@') ? 1 : 5;
+    char* in = text;
+    char* out = text;
+
+    while(*in)
+    {
+        if((separators > 0) && isspace((unsigned char)*in))
+        {
+            while(isspace((unsigned char)*in)) in++;
+            *out++ = ' ';
+            separators--;
+            continue;
+        }
+        *out++ = *in++;
+    }
+    *out = '\0';
+}
+
+/*
+ * Whether a line is an environment assignment such as "MAILTO=root" or
+ * "SHELL = /bin/sh".  No schedule starts with a letter or an underscore.
+ */
+static int
+isAssignment(const char* begin, const char* end)
+{
+    const char* cursor = begin;
+
+    if(!isalpha((unsigned char)*cursor) && (*cursor != '_')) return 0;
+
+    while((cursor < end) && (isalnum((unsigned char)*cursor) || (*cursor == '_')))
+    {
+        cursor++;
+    }
+    while((cursor < end) && ((*cursor == ' ') || (*cursor == '\t'))) cursor++;
+
+    return (cursor < end) && (*cursor == '=');
+}
+
+/*
+ * Splits the file into trimmed schedule lines, skipping blanks, comments and
+ * environment assignments
+ */
+static HORO_ERROR
+parseLines(char* contents, crontabLine_t** oLines, size_t* oLineCount)
+{
+    crontabLine_t* lines = NULL;
+    size_t lineCount = 0;
+    size_t capacity = 0;
+    int lineNumber = 0;
+    char* cursor = contents;
+
+    while(*cursor)
+    {
+        char* begin = cursor;
+        char* end = NULL;
+
+        lineNumber++;
+        while(*cursor && (*cursor != '\n')) cursor++;
+        end = cursor;
+        if(*cursor) cursor++;
+
+        while((begin < end) && isspace((unsigned char)*begin)) begin++;
+        while((end > begin) && isspace((unsigned char)end[-1])) end--;
+        if((begin == end) || (*begin == '#')) continue;
+        if(isAssignment(begin, end)) continue;
+
+        if(lineCount == capacity)
+        {
+            crontabLine_t* grown = NULL;
+
+            capacity = (capacity == 0) ? 16 : capacity * 2;
+            grown = (crontabLine_t*)realloc(lines, capacity * sizeof(crontabLine_t));
+            if(grown == NULL) goto ERR;
+            lines = grown;
+        }
+
+        memset(&lines[lineCount], 0, sizeof(crontabLine_t));
+        lines[lineCount].text = (char*)malloc((end - begin) + 1);
+        if(lines[lineCount].text == NULL) goto ERR;
+
+        memcpy(lines[lineCount].text, begin, end - begin);
+        lines[lineCount].text[end - begin] = '\0';
+        normalizeLine(lines[lineCount].text);
+        lines[lineCount].hash = hashLine(lines[lineCount].text);
+        lines[lineCount].lineNumber = lineNumber;
+        lines[lineCount].actionID = -1;
+        lineCount++;
+    }
+
+    *oLines = lines;
+    *oLineCount = lineCount;
+    return HORO_SUCCESS;
+
+ERR:
+    freeLines(lines, lineCount);
+    return HORO_ERROR_NO_MEM;
+}
+
+/*
+ * Splits "<schedule> <command>" without modifying the line.  The schedule is
+ * either a single @macro or five whitespace separated fields, it is the
+ * first 'oScheduleLength' bytes of the line.
+ */
+static HORO_ERROR
+splitLine(const char* text, size_t* oScheduleLength, const char** oCommand)
+{
+    int fields = (text[0] == '@') ? 1 : 5;
+    const char* cursor = text;
+
+    while(fields-- > 0)
+    {
+        while(*cursor && !isspace((unsigned char)*cursor)) cursor++;
+        if(fields == 0) break;
+        while(*cursor && isspace((unsigned char)*cursor)) cursor++;
+    }
+
+    if(*cursor == '\0')
+    {
+        return HORO_ERROR_PARSER_ILLEGAL_FIELD;
+    }
+
+    *oScheduleLength = (size_t)(cursor - text);
+    while(*cursor && isspace((unsigned char)*cursor)) cursor++;
+    *oCommand = cursor;
+
+    return HORO_SUCCESS;
+}
+
+static HORO_ERROR
+scheduleLine(horo_crontab_t* crontab, crontabLine_t* line)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_actionFunc action = NULL;
+    void* actionData = NULL;
+    const char* command = NULL;
+    size_t scheduleLength = 0;
+
+    err = splitLine(line->text, &scheduleLength, &command);
+    if(err) return err;
+
+    err = crontab->resolve(crontab->userp, command, &action, &actionData);
+    if(err) return err;
+
+    err = horo_scheduleActionN(crontab->clock, line->text, scheduleLength,
+                               action, actionData, &line->actionID);
+    if(!err)
+    {
+        line->actionData = actionData;
+
+        //The line doubles as checkpoint key so restarts keep de-dup state too
+        err = horo_setActionKey(crontab->clock, line->actionID, line->text);
+        if(err)
+        {
+            horo_unscheduleAction(crontab->clock, line->actionID);
+            line->actionID = -1;
+        }
+    }
+
+    if(err && crontab->release)
+    {
+        crontab->release(crontab->userp, actionData);
+    }
+
+    return err;
+}
+
+static void
+unscheduleLine(horo_crontab_t* crontab, crontabLine_t* line)
+{
+    horo_unscheduleAction(crontab->clock, line->actionID);
+    if(crontab->release)
+    {
+        crontab->release(crontab->userp, line->actionData);
+    }
+    line->actionID = -1;
+}
+
+/*
+ * Builds an open addressing table of the current lines keyed by their hash
+ * so that a reload finds the old line of each new line without a scan.
+ * Slots hold the index of a line + 1, 0 is an empty slot.
+ */
+static HORO_ERROR
+indexLines(crontabLine_t const* lines, size_t lineCount, size_t** oSlots,
+           size_t* oCapacity)
+{
+    size_t capacity = 16;
+    size_t* slots = NULL;
+    size_t i = 0;
+
+    while(capacity < lineCount * 2) capacity *= 2;
+
+    slots = (size_t*)calloc(capacity, sizeof(size_t));
+    if(slots == NULL)
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+
+    for(; i < lineCount; i++)
+    {
+        size_t slot = (size_t)lines[i].hash & (capacity - 1);
+
+        while(slots[slot] != 0) slot = (slot + 1) & (capacity - 1);
+        slots[slot] = i + 1;
+    }
+
+    *oSlots = slots;
+    *oCapacity = capacity;
+    return HORO_SUCCESS;
+}
+
+/*Finds an unmatched current line with the text of 'line', NULL if none*/
+static crontabLine_t*
+findOldLine(horo_crontab_t* crontab, size_t const* slots, size_t capacity,
+            crontabLine_t const* line)
+{
+    size_t slot = (size_t)line->hash & (capacity - 1);
+
+    for(; slots[slot] != 0; slot = (slot + 1) & (capacity - 1))
+    {
+        crontabLine_t* old = &crontab->lines[slots[slot] - 1];
+
+        if(!old->matched && (old->hash == line->hash) &&
+           (strcmp(old->text, line->text) == 0))
+        {
+            return old;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+rememberFileState(horo_crontab_t* crontab)
+{
+    struct stat fileStat;
+
+    if(stat(crontab->path, &fileStat) == 0)
+    {
+        crontab->modified = fileStat.st_mtime;
+        crontab->size = fileStat.st_size;
+    }
+}
+
+HORO_ERROR
+horo_crontabReload(horo_crontab_t* crontab, horo_crontab_diff_t* oDiff)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    crontabLine_t* lines = NULL;
+    size_t lineCount = 0;
+    char* contents = NULL;
+    size_t* slots = NULL;
+    size_t capacity = 0;
+    horo_crontab_diff_t diff;
+    size_t i = 0;
+    size_t j = 0;
+
+    RETURN_ILLEGAL_IF(crontab == NULL);
+
+    memset(&diff, 0, sizeof(diff));
+    rememberFileState(crontab);
+
+    err = readFile(crontab->path, &contents);
+    if(err) goto DONE;
+
+    err = parseLines(contents, &lines, &lineCount);
+    if(err) goto DONE;
+
+    err = indexLines(crontab->lines, crontab->lineCount, &slots, &capacity);
+    if(err) goto DONE;
+
+    for(i = 0; i < crontab->lineCount; i++)
+    {
+        crontab->lines[i].matched = 0;
+    }
+
+    //Carry over the actions of unchanged lines
+    for(i = 0; i < lineCount; i++)
+    {
+        crontabLine_t* old = findOldLine(crontab, slots, capacity, &lines[i]);
+
+        if(old == NULL) continue;
+
+        old->matched = 1;
+        lines[i].actionID = old->actionID;
+        lines[i].actionData = old->actionData;
+        lines[i].matched = 1;
+        diff.kept++;
+    }
+
+    //Schedule new lines first so that a bad line leaves the clock untouched
+    for(i = 0; i < lineCount; i++)
+    {
+        if(lines[i].matched) continue;
+
+        err = scheduleLine(crontab, &lines[i]);
+        if(err)
+        {
+            diff.errorLine = lines[i].lineNumber;
+            for(j = 0; j < i; j++)
+            {
+                if(!lines[j].matched) unscheduleLine(crontab, &lines[j]);
+            }
+            goto DONE;
+        }
+        diff.added++;
+    }
+
+    for(i = 0; i < crontab->lineCount; i++)
+    {
+        if(crontab->lines[i].matched) continue;
+
+        unscheduleLine(crontab, &crontab->lines[i]);
+        diff.removed++;
+    }
+
+    freeLines(crontab->lines, crontab->lineCount);
+    crontab->lines = lines;
+    crontab->lineCount = lineCount;
+    lines = NULL;
+
+DONE:
+    if(lines) freeLines(lines, lineCount);
+    free(slots);
+    free(contents);
+    if(oDiff) *oDiff = diff;
+    return err;
+}
+
+static void
+startWatch(horo_crontab_t* crontab)
+{
+#ifdef __linux__
+    char* directory = NULL;
+    char* slash = NULL;
+
+    crontab->watchFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(crontab->watchFD < 0) return;
+
+    //Watch the directory, editors usually replace the file by renaming
+    directory = (char*)malloc(strlen(crontab->path) + 2);
+    if(directory == NULL) goto ERR;
+    strcpy(directory, crontab->path);
+
+    slash = strrchr(directory, '/');
+    if(slash == NULL) strcpy(directory, ".");
+    else if(slash == directory) slash[1] = '\0';
+    else *slash = '\0';
+
+    if(inotify_add_watch(crontab->watchFD, directory,
+                         IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0)
+    {
+        goto ERR;
+    }
+
+    free(directory);
+    return;
+
+ERR:
+    free(directory);
+    close(crontab->watchFD);
+    crontab->watchFD = -1;
+#endif
+}
+
+HORO_ERROR
+horo_crontabOpen(horo_clock_t* clock, const char* path,
+                 horo_resolveFunc resolve, horo_releaseFunc release,
+                 void* userp, horo_crontab_t** oCrontab,
+                 horo_crontab_diff_t* oDiff)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_crontab_t* crontab = NULL;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(path == NULL);
+    RETURN_ILLEGAL_IF(resolve == NULL);
+    RETURN_ILLEGAL_IF(oCrontab == NULL);
+
+    crontab = (horo_crontab_t*)calloc(1, sizeof(horo_crontab_t));
+    if(crontab == NULL)
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+
+    crontab->path = (char*)malloc(strlen(path) + 1);
+    if(crontab->path == NULL)
+    {
+        free(crontab);
+        return HORO_ERROR_NO_MEM;
+    }
+    strcpy(crontab->path, path);
+
+    crontab->clock = clock;
+    crontab->resolve = resolve;
+    crontab->release = release;
+    crontab->userp = userp;
+    crontab->watchFD = -1;
+
+    //Watch before the first read so no change is missed in between
+    startWatch(crontab);
+
+    err = horo_crontabReload(crontab, oDiff);
+    if(err)
+    {
+        horo_crontabClose(crontab);
+        return err;
+    }
+
+    *oCrontab = crontab;
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_crontabWatchFD(horo_crontab_t* crontab, int* oFD)
+{
+    RETURN_ILLEGAL_IF(crontab == NULL);
+    RETURN_ILLEGAL_IF(oFD == NULL);
+
+    *oFD = crontab->watchFD;
+    return HORO_SUCCESS;
+}
+
+/*Drains pending inotify events, returns non zero if any concerned the file*/
+static int
+drainEvents(horo_crontab_t* crontab)
+{
+    int changed = 0;
+#ifdef __linux__
+    char buffer[4096];
+    const char* name = strrchr(crontab->path, '/');
+    ssize_t got = 0;
+
+    name = (name == NULL) ? crontab->path : name + 1;
+
+    while((got = read(crontab->watchFD, buffer, sizeof(buffer))) > 0)
+    {
+        char* cursor = buffer;
+
+        while(cursor < buffer + got)
+        {
+            struct inotify_event* event = (struct inotify_event*)cursor;
+
+            if(event->len && (strcmp(event->name, name) == 0))
+            {
+                changed = 1;
+            }
+            cursor += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#endif
+    return changed;
+}
+
+HORO_ERROR
+horo_crontabPoll(horo_crontab_t* crontab, horo_crontab_diff_t* oDiff)
+{
+    struct stat fileStat;
+    int changed = 0;
+
+    RETURN_ILLEGAL_IF(crontab == NULL);
+
+    if(oDiff) memset(oDiff, 0, sizeof(*oDiff));
+
+    if(crontab->watchFD >= 0)
+    {
+        changed = drainEvents(crontab);
+    }
+    else if(stat(crontab->path, &fileStat) == 0)
+    {
+        changed = (fileStat.st_mtime != crontab->modified) ||
+            (fileStat.st_size != crontab->size);
+    }
+
+    return changed ? horo_crontabReload(crontab, oDiff) : HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_crontabClose(horo_crontab_t* crontab)
+{
+    size_t i = 0;
+
+    RETURN_ILLEGAL_IF(crontab == NULL);
+
+    for(; i < crontab->lineCount; i++)
+    {
+        unscheduleLine(crontab, &crontab->lines[i]);
+    }
+
+#ifdef __linux__
+    if(crontab->watchFD >= 0) close(crontab->watchFD);
+#endif
+
+    freeLines(crontab->lines, crontab->lineCount);
+    free(crontab->path);
+    free(crontab);
+    return HORO_SUCCESS;
+}
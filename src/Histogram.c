@@ -0,0 +1,163 @@
+/**
+ * December 19, 2013
+ * The author disclaims copyright to this source code.
+ */
+
+#include "Histogram.h"
+
+#include <string.h>
+
+static int
+highestBit(uint64_t value)
+{
+    int bit = 0;
+    if(value >> 32) { value >>= 32; bit += 32; }
+    if(value >> 16) { value >>= 16; bit += 16; }
+    if(value >> 8) { value >>= 8; bit += 8; }
+    if(value >> 4) { value >>= 4; bit += 4; }
+    if(value >> 2) { value >>= 2; bit += 2; }
+    if(value >> 1) { bit += 1; }
+    return bit;
+}
+
+static int
+bucketIndex(uint64_t value)
+{
+    int shift = 0;
+
+    if(value < (2 * HORO_HISTOGRAM_SUB_BUCKETS))
+    {
+        return (int)value;
+    }
+
+    shift = highestBit(value) - HORO_HISTOGRAM_SUB_BUCKET_BITS;
+    return (2 * HORO_HISTOGRAM_SUB_BUCKETS) +
+        ((shift - 1) * HORO_HISTOGRAM_SUB_BUCKETS) +
+        (int)((value >> shift) - HORO_HISTOGRAM_SUB_BUCKETS);
+}
+
+/*Returns the value in the middle of the range covered by 'index'*/
+static uint64_t
+bucketMidpoint(int index)
+{
+    int relative = 0;
+    int shift = 0;
+    uint64_t low = 0;
+
+    if(index < (2 * HORO_HISTOGRAM_SUB_BUCKETS))
+    {
+        return (uint64_t)index;
+    }
+
+    relative = index - (2 * HORO_HISTOGRAM_SUB_BUCKETS);
+    shift = (relative / HORO_HISTOGRAM_SUB_BUCKETS) + 1;
+    low = (uint64_t)((relative % HORO_HISTOGRAM_SUB_BUCKETS) +
+                     HORO_HISTOGRAM_SUB_BUCKETS) << shift;
+
+    return low + (((uint64_t)1 << shift) >> 1);
+}
+
+void
+horoHistogram_init(horoHistogram_t* histogram)
+{
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+/*Halves every bucket, a bucket that had a count keeps at least 1*/
+static void
+halveBuckets(horoHistogram_t* histogram)
+{
+    int i = 0;
+
+    for(; i < HORO_HISTOGRAM_BUCKETS; i++)
+    {
+        histogram->buckets[i] = (uint16_t)((histogram->buckets[i] + 1) / 2);
+    }
+}
+
+void
+horoHistogram_record(horoHistogram_t* histogram, uint64_t value)
+{
+    uint16_t* bucket = NULL;
+
+    if((histogram->count == 0) || (value < histogram->min))
+    {
+        histogram->min = value;
+    }
+    if(value > histogram->max)
+    {
+        histogram->max = value;
+    }
+    ++histogram->count;
+    histogram->total += value;
+
+    if(value > HORO_HISTOGRAM_MAX_VALUE)
+    {
+        value = HORO_HISTOGRAM_MAX_VALUE;
+    }
+
+    bucket = &histogram->buckets[bucketIndex(value)];
+    if(*bucket == UINT16_MAX)
+    {
+        halveBuckets(histogram);
+    }
+    ++(*bucket);
+}
+
+uint64_t
+horoHistogram_valueAtPercentile(horoHistogram_t const* histogram,
+                                double percentile)
+{
+    uint64_t total = 0;
+    uint64_t target = 0;
+    uint64_t seen = 0;
+    uint64_t value = 0;
+    int i = 0;
+
+    if(histogram->count == 0) return 0;
+
+    if(percentile < 0.0) percentile = 0.0;
+    if(percentile > 100.0) percentile = 100.0;
+
+    //The buckets only hold 'count' values until they are first halved
+    for(i = 0; i < HORO_HISTOGRAM_BUCKETS; i++)
+    {
+        total += histogram->buckets[i];
+    }
+
+    target = (uint64_t)(((percentile / 100.0) * (double)total) + 0.5);
+    if(target < 1) target = 1;
+
+    for(i = 0; i < HORO_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if(seen >= target)
+        {
+            value = bucketMidpoint(i);
+            break;
+        }
+    }
+
+    if(i == HORO_HISTOGRAM_BUCKETS) value = histogram->max;
+    if(value < histogram->min) value = histogram->min;
+    if(value > histogram->max) value = histogram->max;
+
+    return value;
+}
+
+void
+horoHistogram_summarize(horoHistogram_t const* histogram,
+                        horo_histogram_summary_t* oSummary)
+{
+    memset(oSummary, 0, sizeof(*oSummary));
+    if(histogram->count == 0) return;
+
+    oSummary->count = histogram->count;
+    oSummary->min = histogram->min;
+    oSummary->max = histogram->max;
+    oSummary->mean = histogram->total / histogram->count;
+    oSummary->p50 = horoHistogram_valueAtPercentile(histogram, 50.0);
+    oSummary->p90 = horoHistogram_valueAtPercentile(histogram, 90.0);
+    oSummary->p99 = horoHistogram_valueAtPercentile(histogram, 99.0);
+    oSummary->p999 = horoHistogram_valueAtPercentile(histogram, 99.9);
+}
@@ -0,0 +1,61 @@
+/**
+ * December 19, 2013
+ * The author disclaims copyright to this source code.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include "horo.h"
+
+/*
+ * Log bucketed histogram in the style of HdrHistogram.  Values below
+ * 2 * HORO_HISTOGRAM_SUB_BUCKETS are recorded exactly.  Above that every
+ * power of two is split into HORO_HISTOGRAM_SUB_BUCKETS linear buckets so
+ * the midpoint of a bucket is never more than 1/(2 * SUB_BUCKETS) (~3.1%)
+ * away from the recorded value.
+ */
+#define HORO_HISTOGRAM_SUB_BUCKET_BITS 4
+#define HORO_HISTOGRAM_SUB_BUCKETS (1 << HORO_HISTOGRAM_SUB_BUCKET_BITS)
+
+/*
+ * Values from 2^28 on (~4.5 minutes when recording microseconds) share the
+ * last bucket.  min, max and the mean stay exact.
+ */
+#define HORO_HISTOGRAM_VALUE_BITS 28
+#define HORO_HISTOGRAM_MAX_VALUE (((uint64_t)1 << HORO_HISTOGRAM_VALUE_BITS) - 1)
+
+#define HORO_HISTOGRAM_BUCKETS \
+    ((2 * HORO_HISTOGRAM_SUB_BUCKETS) + \
+     ((HORO_HISTOGRAM_VALUE_BITS - HORO_HISTOGRAM_SUB_BUCKET_BITS - 1) * \
+      HORO_HISTOGRAM_SUB_BUCKETS))
+
+/*
+ * 400 16 bit buckets, 832 bytes in all.  When a bucket would overflow every
+ * bucket is halved, so percentiles lean towards recent values from then on.
+ */
+struct horoHistogram
+{
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t total;
+    uint16_t buckets[HORO_HISTOGRAM_BUCKETS];
+};
+typedef struct horoHistogram horoHistogram_t;
+
+HORO_INTERNAL void
+horoHistogram_init(horoHistogram_t* histogram);
+
+HORO_INTERNAL void
+horoHistogram_record(horoHistogram_t* histogram, uint64_t value);
+
+HORO_INTERNAL uint64_t
+horoHistogram_valueAtPercentile(horoHistogram_t const* histogram,
+                                double percentile);
+
+HORO_INTERNAL void
+horoHistogram_summarize(horoHistogram_t const* histogram,
+                        horo_histogram_summary_t* oSummary);
+
+#endif
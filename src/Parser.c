@@ -4,6 +4,15 @@
  */
 
 #include "Parser.h"
+#include "Trace.h"
+#include "cron.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VALIDATE_RANGE_OR_RETURN(var, min, max)  \
+    if(((var) < (min)) || ((var) > (max))) return HORO_ERROR_OUT_OF_RANGE
 
 static int 
 isValidCronVal(int cronVal)
@@ -18,6 +27,12 @@ isValidMinute(uint64_t minute)
     return (minute == HORO_ASTERISK) || ((minute >= 0) && (minute < ((uint64_t)1 << 60)));
 }
 
+static int 
+isValidSecond(uint64_t second)
+{
+    return (second < ((uint64_t)1 << 60));
+}
+
 static int 
 isValidHour(uint64_t hour)
 {
@@ -52,6 +67,7 @@ validateCronVals(CronVals const* cronVals)
     if(!isValidDOM(cronVals->dayOfMonth)) return HORO_ERROR_PARSER_DOM_RANGE;
     if(!isValidMonth(cronVals->month)) return HORO_ERROR_PARSER_MONTH_RANGE;
     if(!isValidDOW(cronVals->dayOfWeek)) return HORO_ERROR_PARSER_DOW_RANGE;
+    if(!isValidSecond(cronVals->second)) return HORO_ERROR_PARSER_SECOND_RANGE;
 
     return HORO_SUCCESS;
 }
@@ -76,6 +92,9 @@ maxValueFromPosition(FieldPosition_e position)
     case HORO_POSITION_DOW: 
         return 7;
         break; 
+    case HORO_POSITION_SECOND: 
+        return 59; 
+        break; 
     default: 
         return 0; 
         break; 
@@ -116,7 +135,8 @@ cronFieldFromList(List const* list, CronField* cronField)
         val |= ((uint64_t)1 << list->listNums[i]);
     }
 
-    cronField->val = val;
+    //A list may also have ranges
+    cronField->val |= val;
 }
 
 static void
@@ -150,17 +170,47 @@ cronFieldFromAsteriskStep(int step, CronField* cronField,
     case HORO_POSITION_DOW: \
         return HORO_ERROR_PARSER_DOW_RANGE; \
     break; \
+    case HORO_POSITION_SECOND: \
+        return HORO_ERROR_PARSER_SECOND_RANGE; \
+    break; \
     default: \
         return HORO_ERROR_OUT_OF_RANGE; \
     break; \
     } \
     }while(0)
 
+void
+addFieldListItem(CronField* cronField, Range const* item)
+{
+    List* list = &cronField->typeVal.list;
+    RangeList* rangeList = &cronField->typeVal.rangeList;
+
+    if((item->start == item->stop) && (list->numCount < MAX_NUMS_IN_LIST))
+    {
+        list->listNums[list->numCount++] = item->start;
+        cronField->type |= HORO_FIELD_TYPE_LIST;
+    }
+    else if(rangeList->numRanges < MAX_RANGES_IN_RANGELIST)
+    {
+        rangeList->ranges[rangeList->numRanges++] = *item;
+        cronField->type |= HORO_FIELD_TYPE_RANGELIST;
+    }
+    else
+    {
+        cronField->hasError = 1;
+    }
+}
+
 HORO_ERROR
 setCronFieldValues(CronField *cronField, FieldPosition_e position)
 {
     int i = 0;
 
+    if(cronField->hasError)
+    {
+        RETURN_POSITION_ERROR(position);
+    }
+
     if(cronField->type & HORO_FIELD_TYPE_ASTERISK)
     {
         if(cronField->typeVal.asteriskStep > 0)
@@ -210,9 +260,11 @@ setCronFieldValues(CronField *cronField, FieldPosition_e position)
         i = 0;
         for(; i < cronField->typeVal.rangeList.numRanges; i++)
         {
-            if(!isValidCronVal(cronField->typeVal.range.start) ||
-               !isValidCronVal(cronField->typeVal.range.stop) ||
-               !isValidCronVal(cronField->typeVal.range.step))
+            Range const* range = &cronField->typeVal.rangeList.ranges[i];
+
+            if(!isValidCronVal(range->start) ||
+               !isValidCronVal(range->stop) ||
+               !isValidCronVal(range->step))
             {
                 RETURN_POSITION_ERROR(position);
             }
@@ -235,3 +287,560 @@ setCronFieldValues(CronField *cronField, FieldPosition_e position)
 
     return HORO_SUCCESS;
 }
+
+int
+checkDOMWithDOW(uint64_t dayOfMonth, uint64_t dayOfWeek, 
+                horo_time_t const* timeVals)
+{
+    if((dayOfMonth == HORO_ASTERISK) &&
+       (dayOfWeek == HORO_ASTERISK))
+    {
+        return 1;
+    }
+
+    if((dayOfMonth != HORO_ASTERISK) &&
+       (dayOfWeek != HORO_ASTERISK))
+    {
+        if((dayOfWeek & ((uint64_t)1 << timeVals->dayOfWeek)) &&
+           (dayOfMonth & ((uint64_t)1 << timeVals->dayOfMonth)))
+        {
+            return 1;
+        }
+    }
+
+    if(dayOfMonth == HORO_ASTERISK)
+    {
+        if(dayOfWeek & ((uint64_t)1 << timeVals->dayOfWeek))
+        {
+            return 1;
+        }
+    }
+
+    if(dayOfWeek == HORO_ASTERISK)
+    {
+        if(dayOfMonth & ((uint64_t)1 << timeVals->dayOfMonth))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int
+matchCronVals(CronVals const* cronVals, horo_time_t const* timeVals)
+{
+    return (cronVals->minute & ((uint64_t)1 << timeVals->minute)) &&
+        (cronVals->hour & ((uint64_t)1 << timeVals->hour)) &&
+        (cronVals->month & ((uint64_t)1 << timeVals->month)) &&
+        checkDOMWithDOW(cronVals->dayOfMonth, cronVals->dayOfWeek, timeVals);
+}
+
+void
+packCronVals(CronVals const* cronVals, PackedCronVals* oPacked)
+{
+    oPacked->minute = cronVals->minute;
+    oPacked->second = cronVals->second;
+    oPacked->hour = (uint32_t)cronVals->hour;
+    oPacked->dayOfMonth = (uint32_t)cronVals->dayOfMonth;
+    oPacked->month = (uint16_t)cronVals->month;
+    oPacked->dayOfWeek = (uint8_t)cronVals->dayOfWeek;
+    oPacked->asterisks = 0;
+
+    if(cronVals->hour == HORO_ASTERISK) oPacked->asterisks |= PACKED_HOUR_ASTERISK;
+    if(cronVals->dayOfMonth == HORO_ASTERISK) oPacked->asterisks |= PACKED_DOM_ASTERISK;
+    if(cronVals->month == HORO_ASTERISK) oPacked->asterisks |= PACKED_MONTH_ASTERISK;
+    if(cronVals->dayOfWeek == HORO_ASTERISK) oPacked->asterisks |= PACKED_DOW_ASTERISK;
+}
+
+void
+unpackCronVals(PackedCronVals const* packed, CronVals* oCronVals)
+{
+    uint8_t asterisks = packed->asterisks;
+
+    oCronVals->minute = packed->minute;
+    oCronVals->second = packed->second;
+    oCronVals->hour = (asterisks & PACKED_HOUR_ASTERISK) ? HORO_ASTERISK : packed->hour;
+    oCronVals->dayOfMonth = (asterisks & PACKED_DOM_ASTERISK) ?
+        HORO_ASTERISK : packed->dayOfMonth;
+    oCronVals->month = (asterisks & PACKED_MONTH_ASTERISK) ? HORO_ASTERISK : packed->month;
+    oCronVals->dayOfWeek = (asterisks & PACKED_DOW_ASTERISK) ?
+        HORO_ASTERISK : packed->dayOfWeek;
+    oCronVals->error = HORO_SUCCESS;
+}
+
+int
+checkPackedDOMWithDOW(PackedCronVals const* packed, horo_time_t const* timeVals)
+{
+    int domAsterisk = (packed->asterisks & PACKED_DOM_ASTERISK) != 0;
+    int dowAsterisk = (packed->asterisks & PACKED_DOW_ASTERISK) != 0;
+    int domMatch = (packed->dayOfMonth >> timeVals->dayOfMonth) & 1;
+    int dowMatch = (packed->dayOfWeek >> timeVals->dayOfWeek) & 1;
+
+    if(domAsterisk) return dowAsterisk || dowMatch;
+    if(dowAsterisk) return domMatch;
+    return domMatch && dowMatch;
+}
+
+int
+matchPackedCronVals(PackedCronVals const* packed, horo_time_t const* timeVals)
+{
+    return ((packed->minute >> timeVals->minute) & 1) &&
+        ((packed->hour >> timeVals->hour) & 1) &&
+        ((packed->month >> timeVals->month) & 1) &&
+        checkPackedDOMWithDOW(packed, timeVals);
+}
+
+uint32_t
+packRuntime(horo_time_t const* timeVals)
+{
+    return RUNTIME_STAMP_VALID |
+        (uint32_t)timeVals->minute |
+        ((uint32_t)timeVals->hour << 6) |
+        ((uint32_t)timeVals->dayOfMonth << 11) |
+        ((uint32_t)timeVals->month << 16) |
+        ((uint32_t)timeVals->dayOfWeek << 20) |
+        ((uint32_t)timeVals->second << RUNTIME_STAMP_SECOND_SHIFT);
+}
+
+void
+unpackRuntime(uint32_t stamp, horo_time_t* oTimeVals)
+{
+    oTimeVals->minute = stamp & 0x3F;
+    oTimeVals->hour = (stamp >> 6) & 0x1F;
+    oTimeVals->dayOfMonth = (stamp >> 11) & 0x1F;
+    oTimeVals->month = (stamp >> 16) & 0xF;
+    oTimeVals->dayOfWeek = (stamp >> 20) & 0x7;
+    oTimeVals->second = (stamp & RUNTIME_STAMP_SECOND_MASK) >> RUNTIME_STAMP_SECOND_SHIFT;
+}
+
+HORO_ERROR
+validateHoroTime(horo_time_t const* timeVals)
+{
+    VALIDATE_RANGE_OR_RETURN(timeVals->minute, 0, 59);
+    VALIDATE_RANGE_OR_RETURN(timeVals->hour, 0, 23);
+    VALIDATE_RANGE_OR_RETURN(timeVals->dayOfMonth, 1, 31);
+    VALIDATE_RANGE_OR_RETURN(timeVals->month, 1, 12);
+    VALIDATE_RANGE_OR_RETURN(timeVals->dayOfWeek, 0, 7);
+    VALIDATE_RANGE_OR_RETURN(timeVals->second, 0, 59);
+
+    return HORO_SUCCESS;
+}
+
+/*
+ * Like the scanner the parser is not reentrant, so a single parser is built
+ * in static storage instead of allocating one per schedule.
+ */
+static union
+{
+    uint64_t align;
+    void* alignPointer;
+    char bytes[64 * 1024];
+}parserStorage;
+
+static void*
+allocParser(size_t size)
+{
+    return (size <= sizeof(parserStorage)) ? (void*)&parserStorage : malloc(size);
+}
+
+static void
+freeParser(void* parser)
+{
+    if(parser != (void*)&parserStorage) free(parser);
+}
+
+static int
+isCronSpace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+/*Reports the field that contains byte 'offset', or the next one if it is a space*/
+static void
+spanFieldAt(char const* string, size_t length, size_t offset,
+            horo_validation_t* oValidation)
+{
+    size_t end = 0;
+
+    while((offset < length) && isCronSpace(string[offset])) offset++;
+    if(offset == length)
+    {
+        //A field is missing at the end
+        oValidation->offset = length;
+        oValidation->length = 0;
+        return;
+    }
+    while((offset > 0) && !isCronSpace(string[offset - 1])) offset--;
+    for(end = offset; (end < length) && !isCronSpace(string[end]); end++);
+
+    oValidation->offset = offset;
+    oValidation->length = end - offset;
+}
+
+static void
+spanField(char const* string, size_t length, int field,
+          horo_validation_t* oValidation)
+{
+    size_t offset = 0;
+
+    for(; field >= 0; field--)
+    {
+        while((offset < length) && isCronSpace(string[offset])) offset++;
+        spanFieldAt(string, length, offset, oValidation);
+        offset = oValidation->offset + oValidation->length;
+    }
+}
+
+static int
+countFields(char const* string, size_t length)
+{
+    int fields = 0;
+    size_t i = 0;
+
+    for(; i < length; i++)
+    {
+        if(!isCronSpace(string[i]) && ((i == 0) || isCronSpace(string[i - 1]))) fields++;
+    }
+    return fields;
+}
+
+/*The field of the schedule that a range error is about, -1 if there is none*/
+static int
+fieldOfError(HORO_ERROR error, int numFields)
+{
+    int first = (numFields == 6) ? 1 : 0;
+
+    switch(error)
+    {
+    case HORO_ERROR_PARSER_SECOND_RANGE:
+        return (numFields == 6) ? 0 : -1;
+    case HORO_ERROR_PARSER_MINUTE_RANGE:
+        return first;
+    case HORO_ERROR_PARSER_HOUR_RANGE:
+        return first + 1;
+    case HORO_ERROR_PARSER_DOM_RANGE:
+        return first + 2;
+    case HORO_ERROR_PARSER_MONTH_RANGE:
+        return first + 3;
+    case HORO_ERROR_PARSER_DOW_RANGE:
+        return first + 4;
+    default:
+        return -1;
+    }
+}
+
+/*
+ * Fills in where a parse failed.  Range errors name their field.  Other
+ * errors are found at a token: a syntax error at the token the parser did
+ * not expect and a number that is too long at the token before the one
+ * that completed it.
+ */
+static void
+locateError(char const* string, size_t length, HORO_ERROR error,
+            size_t tokenOffset, size_t previousOffset,
+            horo_validation_t* oValidation)
+{
+    int field = fieldOfError(error, countFields(string, length));
+
+    oValidation->error = error;
+    if(field >= 0)
+    {
+        spanField(string, length, field, oValidation);
+    }
+    else
+    {
+        spanFieldAt(string, length,
+                    (error == HORO_ERROR_OUT_OF_RANGE) ? previousOffset : tokenOffset,
+                    oValidation);
+    }
+}
+
+HORO_ERROR
+parseCronString(char const* string, size_t length, CronVals* oCronVals,
+                horo_validation_t* oValidation)
+{
+    Token theToken;
+    void* parser = horoParserAlloc(allocParser);
+    HORO_ERROR ret = HORO_SUCCESS;
+    int token = 0;
+    size_t offset = 0;
+    size_t tokenOffset = 0;
+    size_t previousOffset = 0;
+
+    if(oValidation != NULL)
+    {
+        memset(oValidation, 0, sizeof(*oValidation));
+    }
+    if(parser == NULL)
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+
+    HORO_PROBE_PARSE_BEGIN(string, length);
+
+    memset(oCronVals, 0, sizeof(CronVals));
+    horoLexer_begin(string, length);
+    while(1)
+    {
+        previousOffset = tokenOffset;
+        tokenOffset = offset;
+        token = horoLexer_next(&theToken);
+        offset += theToken.length;
+        if(!token)
+        {
+            //If there are no more tokens, we need to call the parser one last time.
+            horoParser(parser, 0, theToken, oCronVals);
+            ret = oCronVals->error;
+            break;
+        }
+
+        if((token == HORO_TOKEN_UNKNOWN) ||
+           (theToken.length >= sizeof(theToken.string)))
+        {
+            ret = HORO_ERROR_PARSER_ILLEGAL_FIELD;
+            break;
+        }
+        horoParser(parser, token, theToken, oCronVals);
+        if(oCronVals->error != HORO_SUCCESS)
+        {
+            ret = oCronVals->error;
+            break;
+        }
+    }
+
+    horoParserFree(parser, freeParser);
+
+    if(ret && (oValidation != NULL))
+    {
+        locateError(string, length, ret, tokenOffset, previousOffset, oValidation);
+    }
+
+    HORO_PROBE_PARSE_END(string, length, ret, oCronVals);
+    return ret;
+}
+
+HORO_ERROR 
+processCronString(char const* string, CronVals* oCronVals)
+{
+    return parseCronString(string, strlen(string), oCronVals, NULL);
+}
+
+/*The bits of the values that a time can have in a field*/
+static uint64_t
+fieldValueMask(FieldPosition_e position)
+{
+    switch(position)
+    {
+    case HORO_POSITION_MINUTE:
+    case HORO_POSITION_SECOND:
+        return ((uint64_t)1 << 60) - 1;
+    case HORO_POSITION_HOUR:
+        return ((uint64_t)1 << 24) - 1;
+    case HORO_POSITION_DOM:
+        return (((uint64_t)1 << 32) - 1) & ~(uint64_t)1;
+    case HORO_POSITION_MONTH:
+        return (((uint64_t)1 << 13) - 1) & ~(uint64_t)1;
+    case HORO_POSITION_DOW:
+        return ((uint64_t)1 << 8) - 1;
+    default:
+        return 0;
+    }
+}
+
+static uint64_t
+canonicalField(uint64_t val, FieldPosition_e position)
+{
+    uint64_t mask = fieldValueMask(position);
+
+    if(val == HORO_ASTERISK) return mask;
+
+    //Sunday is both 0 and 7
+    if((position == HORO_POSITION_DOW) && (val & 0x81)) val |= 0x81;
+
+    //A field that no time matches keeps its bits so that it can be written out
+    return ((val & mask) != 0) ? (val & mask) : val;
+}
+
+void
+canonicalCronVals(CronVals const* cronVals, CronVals* oCanonical)
+{
+    oCanonical->minute = canonicalField(cronVals->minute, HORO_POSITION_MINUTE);
+    oCanonical->hour = canonicalField(cronVals->hour, HORO_POSITION_HOUR);
+    oCanonical->dayOfMonth = canonicalField(cronVals->dayOfMonth, HORO_POSITION_DOM);
+    oCanonical->month = canonicalField(cronVals->month, HORO_POSITION_MONTH);
+    oCanonical->dayOfWeek = canonicalField(cronVals->dayOfWeek, HORO_POSITION_DOW);
+    oCanonical->second = (cronVals->second != 0) ?
+        canonicalField(cronVals->second, HORO_POSITION_SECOND) : 0;
+    oCanonical->error = HORO_SUCCESS;
+}
+
+uint64_t
+fingerprintCronVals(CronVals const* canonical)
+{
+    uint64_t const fields[6] = {canonical->minute, canonical->hour,
+                                canonical->dayOfMonth, canonical->month,
+                                canonical->dayOfWeek, canonical->second};
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    int field = 0;
+    int byte = 0;
+
+    //FNV-1a over the little endian bytes of the masks
+    for(; field < 6; field++)
+    {
+        for(byte = 0; byte < 8; byte++)
+        {
+            hash ^= (fields[field] >> (byte * 8)) & 0xFF;
+            hash *= 0x100000001B3ULL;
+        }
+    }
+
+    return hash;
+}
+
+/*
+ * Appends 'text' if it fits.  The length grows either way so that the
+ * caller learns how much space the whole string needs.
+ */
+static void
+appendText(char* buffer, size_t size, size_t* ioLength, const char* text)
+{
+    size_t length = strlen(text);
+
+    if(*ioLength + length < size)
+    {
+        memcpy(buffer + *ioLength, text, length + 1);
+    }
+    *ioLength += length;
+}
+
+static void
+formatCronField(uint64_t val, FieldPosition_e position, char* buffer,
+                size_t size, size_t* ioLength)
+{
+    int values[64];
+    int numValues = 0;
+    int maxValue = maxValueFromPosition(position);
+    int numNumbers = 0;
+    int pairRanges = 0;
+    int step = 0;
+    int i = 0;
+    int j = 0;
+    char text[24];
+
+    if(val == fieldValueMask(position))
+    {
+        appendText(buffer, size, ioLength, "*");
+        return;
+    }
+
+    for(i = 0; i < 64; i++)
+    {
+        if(val & ((uint64_t)1 << i)) values[numValues++] = i;
+    }
+
+    //Sunday is written as 0 only
+    if((position == HORO_POSITION_DOW) && (val & 1) && (values[numValues - 1] == 7))
+    {
+        numValues--;
+    }
+
+    if(numValues == 1)
+    {
+        sprintf(text, "%d", values[0]);
+        appendText(buffer, size, ioLength, text);
+        return;
+    }
+
+    //The same mask as '*/step' gets after clearing the values no time has
+    for(step = 2; step <= maxValue; step++)
+    {
+        CronField stepField;
+
+        stepField.val = 0;
+        cronFieldFromAsteriskStep(step, &stepField, position);
+        if(canonicalField(stepField.val, position) == val)
+        {
+            sprintf(text, "*/%d", step);
+            appendText(buffer, size, ioLength, text);
+            return;
+        }
+    }
+
+    //Evenly spaced values are a range with a step
+    step = values[1] - values[0];
+    for(i = 2; (i < numValues) && (values[i] - values[i - 1] == step); i++);
+    if(i == numValues)
+    {
+        if(step == 1)
+        {
+            sprintf(text, "%d-%d", values[0], values[numValues - 1]);
+        }
+        else if(numValues > 2)
+        {
+            sprintf(text, "%d-%d/%d", values[0], values[numValues - 1], step);
+        }
+        else
+        {
+            sprintf(text, "%d,%d", values[0], values[1]);
+        }
+        appendText(buffer, size, ioLength, text);
+        return;
+    }
+
+    /*
+     * Runs of three or more values are ranges, the other values numbers.
+     * Runs of two become ranges too while the numbers do not fit in a list.
+     * 60 values never need more than MAX_RANGES_IN_RANGELIST ranges.
+     */
+    for(i = 0; i < numValues; i = j)
+    {
+        for(j = i + 1; (j < numValues) && (values[j] == values[j - 1] + 1); j++);
+        if(j - i < 3) numNumbers += j - i;
+    }
+    if(numNumbers > MAX_NUMS_IN_LIST)
+    {
+        pairRanges = (numNumbers - MAX_NUMS_IN_LIST + 1) / 2;
+    }
+
+    for(i = 0; i < numValues; i = j)
+    {
+        for(j = i + 1; (j < numValues) && (values[j] == values[j - 1] + 1); j++);
+        if((j - i >= 3) || ((j - i == 2) && (pairRanges-- > 0)))
+        {
+            sprintf(text, (i == 0) ? "%d-%d" : ",%d-%d", values[i], values[j - 1]);
+            appendText(buffer, size, ioLength, text);
+            continue;
+        }
+        for(; i < j; i++)
+        {
+            sprintf(text, (i == 0) ? "%d" : ",%d", values[i]);
+            appendText(buffer, size, ioLength, text);
+        }
+    }
+}
+
+size_t
+formatCronVals(CronVals const* canonical, char* buffer, size_t size)
+{
+    size_t length = 0;
+
+    if(size > 0) buffer[0] = '\0';
+
+    if(canonical->second != 0)
+    {
+        formatCronField(canonical->second, HORO_POSITION_SECOND, buffer, size, &length);
+        appendText(buffer, size, &length, " ");
+    }
+    formatCronField(canonical->minute, HORO_POSITION_MINUTE, buffer, size, &length);
+    appendText(buffer, size, &length, " ");
+    formatCronField(canonical->hour, HORO_POSITION_HOUR, buffer, size, &length);
+    appendText(buffer, size, &length, " ");
+    formatCronField(canonical->dayOfMonth, HORO_POSITION_DOM, buffer, size, &length);
+    appendText(buffer, size, &length, " ");
+    formatCronField(canonical->month, HORO_POSITION_MONTH, buffer, size, &length);
+    appendText(buffer, size, &length, " ");
+    formatCronField(canonical->dayOfWeek, HORO_POSITION_DOW, buffer, size, &length);
+
+    return length;
+}
@@ -8,10 +8,12 @@
 
 #include "horo.h"
 
+#include <stdio.h>
+
 struct Token
 {
     char string[64];
-    int length;
+    size_t length;
 };
 typedef struct Token Token;
     
@@ -74,22 +76,163 @@ struct CronVals
     uint64_t month;
     uint64_t dayOfWeek;
 
+    /*0 if the schedule has no seconds field*/
+    uint64_t second;
+
     HORO_ERROR error;
 };
 typedef struct CronVals CronVals;
 
+/*
+ * The masks of a CronVals as they are stored in every scheduled entry, in
+ * 32 bytes instead of 56.  Each mask only keeps the bits of its field's
+ * values, fields that were '*' are flagged in 'asterisks' so that they can
+ * be unpacked and matched exactly like HORO_ASTERISK.
+ */
+#define PACKED_HOUR_ASTERISK 0x1
+#define PACKED_DOM_ASTERISK 0x2
+#define PACKED_MONTH_ASTERISK 0x4
+#define PACKED_DOW_ASTERISK 0x8
+
+struct PackedCronVals
+{
+    uint64_t minute;
+    uint64_t second;
+    uint32_t hour;
+    uint32_t dayOfMonth;
+    uint16_t month;
+    uint8_t dayOfWeek;
+    uint8_t asterisks;
+};
+typedef struct PackedCronVals PackedCronVals;
+
 typedef enum
 {
     HORO_POSITION_MINUTE,
     HORO_POSITION_HOUR,
     HORO_POSITION_DOM,
     HORO_POSITION_MONTH,
-    HORO_POSITION_DOW
+    HORO_POSITION_DOW,
+    HORO_POSITION_SECOND
 }FieldPosition_e;
 
-HORO_ERROR
+HORO_INTERNAL HORO_ERROR
 setCronFieldValues(CronField *cronField, FieldPosition_e position);
 
-HORO_ERROR 
+/*
+ * Adds a number or range of a comma separated list to a field.  A number
+ * is a range whose start is its stop.  An item that does not fit sets
+ * hasError.
+ */
+HORO_INTERNAL void
+addFieldListItem(CronField* cronField, Range const* item);
+
+/*Returned by the scanner for a byte that starts no token*/
+#define HORO_TOKEN_UNKNOWN -1
+
+/*Points the scanner (cron.l) at 'length' bytes of 'string'*/
+HORO_INTERNAL void
+horoLexer_begin(char const* string, size_t length);
+
+/*
+ * Returns the next token, 0 at the end of the string.  The token's text is
+ * only copied if it is shorter than Token::string, its length always is.
+ */
+HORO_INTERNAL int
+horoLexer_next(Token* oToken);
+
+/*The parser generated from cron.y*/
+HORO_INTERNAL void*
+horoParserAlloc(void* (*mallocProc)(size_t));
+
+HORO_INTERNAL void
+horoParser(void* parser, int token, Token minor, CronVals* cronVals);
+
+HORO_INTERNAL void
+horoParserFree(void* parser, void (*freeProc)(void*));
+
+#ifndef NDEBUG
+HORO_INTERNAL void
+horoParserTrace(FILE* traceFile, char* tracePrompt);
+#endif
+
+/*
+ * Parses 'length' bytes of 'string' without allocating.  On an error the
+ * field it was found in is reported through 'oValidation', which may be
+ * NULL.  Not reentrant.
+ */
+HORO_INTERNAL HORO_ERROR
+parseCronString(char const* string, size_t length, CronVals* oCronVals,
+                horo_validation_t* oValidation);
+
+HORO_INTERNAL HORO_ERROR 
 processCronString(char const* string, CronVals* oCronVals);
+
+HORO_INTERNAL HORO_ERROR
+validateCronVals(CronVals const* cronVals);
+
+/*Returns HORO_ERROR_OUT_OF_RANGE if a field of 'timeVals' is out of range*/
+HORO_INTERNAL HORO_ERROR
+validateHoroTime(horo_time_t const* timeVals);
+
+HORO_INTERNAL int
+checkDOMWithDOW(uint64_t dayOfMonth, uint64_t dayOfWeek, 
+                horo_time_t const* timeVals);
+
+/*
+ * Returns non-zero if the minute of 'timeVals' is part of the schedule.
+ * The seconds field is not checked.
+ */
+HORO_INTERNAL int
+matchCronVals(CronVals const* cronVals, horo_time_t const* timeVals);
+
+HORO_INTERNAL void
+packCronVals(CronVals const* cronVals, PackedCronVals* oPacked);
+
+HORO_INTERNAL void
+unpackCronVals(PackedCronVals const* packed, CronVals* oCronVals);
+
+/*checkDOMWithDOW() for a packed schedule*/
+HORO_INTERNAL int
+checkPackedDOMWithDOW(PackedCronVals const* packed, horo_time_t const* timeVals);
+
+/*matchCronVals() for a packed schedule*/
+HORO_INTERNAL int
+matchPackedCronVals(PackedCronVals const* packed, horo_time_t const* timeVals);
+
+/*
+ * The masks of a schedule with every value that no time has cleared and
+ * HORO_ASTERISK replaced by the values it stands for, so that schedules
+ * that match the same times have the same masks.
+ */
+HORO_INTERNAL void
+canonicalCronVals(CronVals const* cronVals, CronVals* oCanonical);
+
+/*A hash of canonical masks that does not change between processes*/
+HORO_INTERNAL uint64_t
+fingerprintCronVals(CronVals const* canonical);
+
+/*
+ * Writes canonical masks as a schedule string.  Returns the length of the
+ * whole string, which did not fit if it is not less than 'size'.
+ */
+HORO_INTERNAL size_t
+formatCronVals(CronVals const* canonical, char* buffer, size_t size);
+
+/*
+ * A horo_time_t packed into a 32 bit word so that it can be stored
+ * atomically.  Bit 31 marks the stamp as valid.
+ */
+#define RUNTIME_STAMP_VALID ((uint32_t)1 << 31)
+#define RUNTIME_STAMP_SECOND_SHIFT 23
+#define RUNTIME_STAMP_SECOND_MASK ((uint32_t)0x3F << RUNTIME_STAMP_SECOND_SHIFT)
+
+/*The stamp of the minute that contains 'stamp'*/
+#define RUNTIME_STAMP_MINUTE(stamp) ((stamp) & ~RUNTIME_STAMP_SECOND_MASK)
+
+HORO_INTERNAL uint32_t
+packRuntime(horo_time_t const* timeVals);
+
+HORO_INTERNAL void
+unpackRuntime(uint32_t stamp, horo_time_t* oTimeVals);
 #endif
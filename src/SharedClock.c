@@ -0,0 +1,448 @@
+/**
+ * December 19, 2013
+ * The author disclaims copyright to this source code.
+ */
+
+#include "horo.h"
+#include "Parser.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define RETURN_ILLEGAL_IF(statement) if((statement)) return HORO_ERROR_ILLEGAL_ARG
+
+#define SHARED_MAGIC "HOROSHM"
+#define SHARED_VERSION 3
+
+/*
+ * Layout of the segment: a header followed by 'capacity' slots.
+ *
+ * The writer publishes a slot with a sequence lock: 'sequence' is odd while
+ * the slot is being modified.  Readers copy the slot and only use the copy
+ * if 'sequence' was even and unchanged around the copy.
+ *
+ * 'claim' holds the sequence of the slot in its upper 32 bits and the UTC
+ * minute (or second, for schedules with a seconds field) of the last claim
+ * in the lower 32 bits.  A reader owns an action for a minute once its
+ * compare-and-swap of 'claim' succeeds.  Claims only move forward, so a
+ * reader that is behind can not take a minute that was already claimed
+ * after the one it processes.  Because the sequence is part of the word,
+ * claims made against a slot that has been rewritten in the meantime fail.
+ *
+ * Free slots below 'highWater' are chained through 'nextFree', starting at
+ * 'freeHead'.  Both hold a slot index + 1, 0 ends the chain.
+ */
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;
+    volatile uint32_t highWater;
+    volatile uint32_t actionCount;
+    uint32_t freeHead;
+    uint32_t reserved;
+}sharedHeader_t;
+
+typedef struct
+{
+    volatile uint32_t sequence;
+    uint32_t inUse;
+    uint32_t nextFree;
+    uint32_t reserved;
+    volatile uint64_t claim;
+    uint64_t tag;
+    uint64_t minute;
+    uint64_t hour;
+    uint64_t dayOfMonth;
+    uint64_t month;
+    uint64_t dayOfWeek;
+    uint64_t second;
+}sharedSlot_t;
+
+struct horo_shared_clock
+{
+    void* base;
+    size_t size;
+    sharedHeader_t* header;
+    sharedSlot_t* slots;
+};
+
+#ifdef _WIN32
+
+HORO_ERROR
+horo_sharedCreate(const char* name, size_t capacity, horo_shared_clock_t** oClock)
+{
+    return HORO_ERROR_NOT_SUPPORTED;
+}
+
+HORO_ERROR
+horo_sharedAttach(const char* name, horo_shared_clock_t** oClock)
+{
+    return HORO_ERROR_NOT_SUPPORTED;
+}
+
+HORO_ERROR
+horo_sharedScheduleAction(horo_shared_clock_t* clock, const char* scheduleString,
+                          uint64_t tag, int* oActionID)
+{
+    return HORO_ERROR_NOT_SUPPORTED;
+}
+
+HORO_ERROR
+horo_sharedUnscheduleAction(horo_shared_clock_t* clock, int actionID)
+{
+    return HORO_ERROR_NOT_SUPPORTED;
+}
+
+HORO_ERROR
+horo_sharedActionCount(horo_shared_clock_t* clock, int* oActionCount)
+{
+    return HORO_ERROR_NOT_SUPPORTED;
+}
+
+HORO_ERROR
+horo_sharedProcess(horo_shared_clock_t* clock, int64_t utcSeconds,
+                   horo_sharedActionFunc action, void* userp)
+{
+    return HORO_ERROR_NOT_SUPPORTED;
+}
+
+HORO_ERROR
+horo_sharedDetach(horo_shared_clock_t* clock)
+{
+    return HORO_ERROR_NOT_SUPPORTED;
+}
+
+HORO_ERROR
+horo_sharedUnlink(const char* name)
+{
+    return HORO_ERROR_NOT_SUPPORTED;
+}
+
+#else
+
+#define memoryBarrier() __sync_synchronize()
+
+static HORO_ERROR
+mapSegment(int fd, size_t size, horo_shared_clock_t** oClock)
+{
+    horo_shared_clock_t* clock = NULL;
+
+    clock = (horo_shared_clock_t*)malloc(sizeof(horo_shared_clock_t));
+    if(clock == NULL)
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+
+    clock->base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(clock->base == MAP_FAILED)
+    {
+        free(clock);
+        return HORO_ERROR_IO;
+    }
+
+    clock->size = size;
+    clock->header = (sharedHeader_t*)clock->base;
+    clock->slots = (sharedSlot_t*)((char*)clock->base + sizeof(sharedHeader_t));
+    *oClock = clock;
+
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_sharedCreate(const char* name, size_t capacity, horo_shared_clock_t** oClock)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    size_t size = 0;
+    int fd = -1;
+
+    RETURN_ILLEGAL_IF(name == NULL);
+    RETURN_ILLEGAL_IF(oClock == NULL);
+    RETURN_ILLEGAL_IF((capacity == 0) || (capacity > INT32_MAX));
+
+    size = sizeof(sharedHeader_t) + (capacity * sizeof(sharedSlot_t));
+
+    //A restarted writer takes over the live table instead of wiping it
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if((fd < 0) && (errno == EEXIST))
+    {
+        return horo_sharedAttach(name, oClock);
+    }
+    if(fd < 0)
+    {
+        return HORO_ERROR_IO;
+    }
+
+    //The new segment is zero filled
+    if(ftruncate(fd, (off_t)size) != 0)
+    {
+        ret = HORO_ERROR_IO;
+        goto DONE;
+    }
+
+    ret = mapSegment(fd, size, oClock);
+    if(ret) goto DONE;
+
+    (*oClock)->header->version = SHARED_VERSION;
+    (*oClock)->header->capacity = (uint32_t)capacity;
+    memoryBarrier();
+    memcpy((*oClock)->header->magic, SHARED_MAGIC, sizeof((*oClock)->header->magic));
+
+DONE:
+    if(ret) shm_unlink(name);
+    close(fd);
+    return ret;
+}
+
+HORO_ERROR
+horo_sharedAttach(const char* name, horo_shared_clock_t** oClock)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    sharedHeader_t header;
+    struct stat segmentStat;
+    int fd = -1;
+
+    RETURN_ILLEGAL_IF(name == NULL);
+    RETURN_ILLEGAL_IF(oClock == NULL);
+
+    fd = shm_open(name, O_RDWR, 0);
+    if(fd < 0)
+    {
+        return HORO_ERROR_IO;
+    }
+
+    if((fstat(fd, &segmentStat) != 0) ||
+       (pread(fd, &header, sizeof(header), 0) != sizeof(header)))
+    {
+        ret = HORO_ERROR_IO;
+        goto DONE;
+    }
+
+    if(memcmp(header.magic, SHARED_MAGIC, sizeof(header.magic)) != 0)
+    {
+        ret = HORO_ERROR_CORRUPT;
+        goto DONE;
+    }
+    if(header.version != SHARED_VERSION)
+    {
+        ret = HORO_ERROR_UNSUPPORTED_VERSION;
+        goto DONE;
+    }
+    if((size_t)segmentStat.st_size !=
+       sizeof(sharedHeader_t) + (header.capacity * sizeof(sharedSlot_t)))
+    {
+        ret = HORO_ERROR_CORRUPT;
+        goto DONE;
+    }
+
+    ret = mapSegment(fd, (size_t)segmentStat.st_size, oClock);
+
+DONE:
+    close(fd);
+    return ret;
+}
+
+HORO_ERROR
+horo_sharedScheduleAction(horo_shared_clock_t* clock, const char* scheduleString,
+                          uint64_t tag, int* oActionID)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    CronVals cronVals;
+    sharedSlot_t* slot = NULL;
+    uint32_t index = 0;
+    uint32_t sequence = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(scheduleString == NULL);
+    RETURN_ILLEGAL_IF(oActionID == NULL);
+
+    err = processCronString(scheduleString, &cronVals);
+    if(err) return err;
+
+    if(clock->header->freeHead != 0)
+    {
+        index = clock->header->freeHead - 1;
+        clock->header->freeHead = clock->slots[index].nextFree;
+    }
+    else if(clock->header->highWater < clock->header->capacity)
+    {
+        index = clock->header->highWater;
+    }
+    else
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+
+    slot = &clock->slots[index];
+    sequence = slot->sequence + 1;
+    slot->sequence = sequence;
+    memoryBarrier();
+
+    slot->tag = tag;
+    slot->minute = cronVals.minute;
+    slot->hour = cronVals.hour;
+    slot->dayOfMonth = cronVals.dayOfMonth;
+    slot->month = cronVals.month;
+    slot->dayOfWeek = cronVals.dayOfWeek;
+    slot->second = cronVals.second;
+    slot->inUse = 1;
+    slot->nextFree = 0;
+    slot->claim = (uint64_t)(sequence + 1) << 32;
+
+    memoryBarrier();
+    slot->sequence = sequence + 1;
+
+    if(index >= clock->header->highWater)
+    {
+        clock->header->highWater = index + 1;
+    }
+    clock->header->actionCount++;
+
+    *oActionID = (int)index;
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_sharedUnscheduleAction(horo_shared_clock_t* clock, int actionID)
+{
+    sharedSlot_t* slot = NULL;
+    uint32_t sequence = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    if((actionID < 0) || ((uint32_t)actionID >= clock->header->highWater) ||
+       !clock->slots[actionID].inUse)
+    {
+        return HORO_ERROR_UNKNOWN_ACTION;
+    }
+
+    slot = &clock->slots[actionID];
+    sequence = slot->sequence + 1;
+    slot->sequence = sequence;
+    memoryBarrier();
+
+    slot->inUse = 0;
+    slot->claim = (uint64_t)(sequence + 1) << 32;
+
+    memoryBarrier();
+    slot->sequence = sequence + 1;
+
+    slot->nextFree = clock->header->freeHead;
+    clock->header->freeHead = (uint32_t)actionID + 1;
+    clock->header->actionCount--;
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_sharedActionCount(horo_shared_clock_t* clock, int* oActionCount)
+{
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(oActionCount == NULL);
+
+    *oActionCount = (int)clock->header->actionCount;
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_sharedProcess(horo_shared_clock_t* clock, int64_t utcSeconds,
+                   horo_sharedActionFunc action, void* userp)
+{
+    time_t now = (time_t)utcSeconds;
+    struct tm localTime;
+    horo_time_t timeValsStorage;
+    horo_time_t const* timeVals = &timeValsStorage;
+    uint32_t highWater = 0;
+    uint32_t index = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(action == NULL);
+
+    //Claims are 32 bit UTC seconds
+    if((utcSeconds < 0) || (utcSeconds > UINT32_MAX) ||
+       ((int64_t)now != utcSeconds) || (localtime_r(&now, &localTime) == NULL))
+    {
+        return HORO_ERROR_OUT_OF_RANGE;
+    }
+    timeValsStorage.minute = localTime.tm_min;
+    timeValsStorage.hour = localTime.tm_hour;
+    timeValsStorage.dayOfMonth = localTime.tm_mday;
+    timeValsStorage.month = localTime.tm_mon + 1;
+    timeValsStorage.dayOfWeek = localTime.tm_wday;
+    timeValsStorage.second = (localTime.tm_sec < 60) ? localTime.tm_sec : 59;
+
+    highWater = clock->header->highWater;
+
+    for(; index < highWater; index++)
+    {
+        sharedSlot_t* slot = &clock->slots[index];
+        CronVals cronVals;
+        uint64_t tag = 0;
+        uint64_t claim = 0;
+        uint32_t claimStamp = 0;
+        uint32_t sequence = slot->sequence;
+        int inUse = 0;
+
+        if(sequence & 1) continue;
+        memoryBarrier();
+
+        inUse = slot->inUse;
+        tag = slot->tag;
+        cronVals.minute = slot->minute;
+        cronVals.hour = slot->hour;
+        cronVals.dayOfMonth = slot->dayOfMonth;
+        cronVals.month = slot->month;
+        cronVals.dayOfWeek = slot->dayOfWeek;
+        cronVals.second = slot->second;
+        claim = slot->claim;
+
+        memoryBarrier();
+        if(slot->sequence != sequence) continue;
+
+        if(!inUse || !matchCronVals(&cronVals, timeVals)) continue;
+
+        //Minutes since the epoch, seconds for schedules with a seconds field
+        claimStamp = (uint32_t)(utcSeconds / 60);
+        if(cronVals.second != 0)
+        {
+            if(!(cronVals.second & ((uint64_t)1 << timeVals->second))) continue;
+            claimStamp = (uint32_t)utcSeconds;
+        }
+        if(((uint32_t)(claim >> 32) != sequence) || ((uint32_t)claim >= claimStamp)) continue;
+
+        if(__sync_bool_compare_and_swap(&slot->claim, claim,
+                                        ((uint64_t)sequence << 32) | claimStamp))
+        {
+            action(userp, (int)index, tag);
+        }
+    }
+
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_sharedDetach(horo_shared_clock_t* clock)
+{
+    RETURN_ILLEGAL_IF(clock == NULL);
+
+    munmap(clock->base, clock->size);
+    free(clock);
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_sharedUnlink(const char* name)
+{
+    RETURN_ILLEGAL_IF(name == NULL);
+
+    return (shm_unlink(name) == 0) ? HORO_SUCCESS : HORO_ERROR_IO;
+}
+
+#endif
@@ -0,0 +1,65 @@
+/**
+ * December 19, 2013
+ * The author disclaims copyright to this source code.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * USDT probes for attaching bpftrace, perf or dtrace to a running process.
+ * Build with -DHORO_ENABLE_USDT (requires <sys/sdt.h> from systemtap-sdt-dev)
+ * to compile the probes in.  Otherwise every probe expands to nothing.
+ *
+ * Provider: libhoro
+ *   process__begin(minute, hour, dayOfMonth, month, dayOfWeek)
+ *   process__end(error)
+ *   action__begin(id, minuteMask, hourMask, domMask, monthMask, dowMask)
+ *   action__end(id)
+ *   parse__begin(scheduleString, length)
+ *   parse__end(scheduleString, length, error, minuteMask, hourMask,
+ *              domMask, monthMask, dowMask)
+ *
+ * scheduleString is not NUL terminated, read 'length' bytes of it.
+ */
+#if defined(HORO_ENABLE_USDT) && !defined(_WIN32)
+
+#include <sys/sdt.h>
+
+#define HORO_PROBE_PROCESS_BEGIN(timeVals) \
+    DTRACE_PROBE5(libhoro, process__begin, (timeVals)->minute, \
+                  (timeVals)->hour, (timeVals)->dayOfMonth, \
+                  (timeVals)->month, (timeVals)->dayOfWeek)
+
+#define HORO_PROBE_PROCESS_END(error) \
+    DTRACE_PROBE1(libhoro, process__end, (int)(error))
+
+#define HORO_PROBE_ACTION_BEGIN(id, cronVals) \
+    DTRACE_PROBE6(libhoro, action__begin, (id), (cronVals)->minute, \
+                  (cronVals)->hour, (cronVals)->dayOfMonth, \
+                  (cronVals)->month, (cronVals)->dayOfWeek)
+
+#define HORO_PROBE_ACTION_END(id) \
+    DTRACE_PROBE1(libhoro, action__end, (id))
+
+#define HORO_PROBE_PARSE_BEGIN(string, length) \
+    DTRACE_PROBE2(libhoro, parse__begin, (string), (length))
+
+#define HORO_PROBE_PARSE_END(string, length, error, cronVals) \
+    DTRACE_PROBE8(libhoro, parse__end, (string), (length), (int)(error), \
+                  (cronVals)->minute, (cronVals)->hour, \
+                  (cronVals)->dayOfMonth, (cronVals)->month, \
+                  (cronVals)->dayOfWeek)
+
+#else
+
+#define HORO_PROBE_PROCESS_BEGIN(timeVals)
+#define HORO_PROBE_PROCESS_END(error)
+#define HORO_PROBE_ACTION_BEGIN(id, cronVals)
+#define HORO_PROBE_ACTION_END(id)
+#define HORO_PROBE_PARSE_BEGIN(string, length)
+#define HORO_PROBE_PARSE_END(string, length, error, cronVals)
+
+#endif
+
+#endif
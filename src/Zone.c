@@ -0,0 +1,646 @@
+/**
+ * December 19, 2013
+ * The author disclaims copyright to this source code.
+ */
+
+#include "Zone.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ZONE_DEFAULT_DIR "/usr/share/zoneinfo"
+#define ZONE_MAX_FILE_SIZE (1024 * 1024)
+#define SECONDS_PER_DAY 86400
+
+static int64_t
+floorDiv(int64_t a, int64_t b)
+{
+    return (a / b) - (((a % b) != 0) && ((a < 0) != (b < 0)));
+}
+
+/*Days since 1970-01-01 of a proleptic Gregorian date*/
+static int64_t
+daysFromCivil(int64_t year, int month, int day)
+{
+    int64_t era = 0;
+    int64_t yearOfEra = 0;
+    int64_t dayOfYear = 0;
+    int64_t dayOfEra = 0;
+
+    year -= (month <= 2);
+    era = floorDiv(year, 400);
+    yearOfEra = year - (era * 400);
+    dayOfYear = ((153 * (month + ((month > 2) ? -3 : 9))) + 2) / 5 + day - 1;
+    dayOfEra = (yearOfEra * 365) + (yearOfEra / 4) - (yearOfEra / 100) + dayOfYear;
+
+    return (era * 146097) + dayOfEra - 719468;
+}
+
+static void
+civilFromDays(int64_t days, int64_t* oYear, int* oMonth, int* oDay)
+{
+    int64_t era = 0;
+    int64_t dayOfEra = 0;
+    int64_t yearOfEra = 0;
+    int64_t dayOfYear = 0;
+    int64_t monthIndex = 0;
+
+    days += 719468;
+    era = floorDiv(days, 146097);
+    dayOfEra = days - (era * 146097);
+    yearOfEra = (dayOfEra - (dayOfEra / 1460) + (dayOfEra / 36524) -
+                 (dayOfEra / 146096)) / 365;
+    dayOfYear = dayOfEra - ((365 * yearOfEra) + (yearOfEra / 4) - (yearOfEra / 100));
+    monthIndex = ((5 * dayOfYear) + 2) / 153;
+
+    *oDay = (int)(dayOfYear - (((153 * monthIndex) + 2) / 5) + 1);
+    *oMonth = (int)((monthIndex < 10) ? monthIndex + 3 : monthIndex - 9);
+    *oYear = yearOfEra + (era * 400) + (*oMonth <= 2);
+}
+
+/*0 is Sunday, 1970-01-01 was a Thursday*/
+static int
+weekDay(int64_t days)
+{
+    int64_t day = (days + 4) % 7;
+    return (int)((day < 0) ? day + 7 : day);
+}
+
+static int
+isLeapYear(int64_t year)
+{
+    return ((year % 4) == 0) && (((year % 100) != 0) || ((year % 400) == 0));
+}
+
+void
+horoZone_breakDownOffset(int64_t utc, int32_t offset, horo_time_t* oTimeVals)
+{
+    int64_t local = utc + offset;
+    int64_t days = floorDiv(local, SECONDS_PER_DAY);
+    int64_t secondOfDay = local - (days * SECONDS_PER_DAY);
+    int64_t year = 0;
+
+    civilFromDays(days, &year, &oTimeVals->month, &oTimeVals->dayOfMonth);
+    oTimeVals->hour = (int)(secondOfDay / 3600);
+    oTimeVals->minute = (int)((secondOfDay / 60) % 60);
+    oTimeVals->second = (int)(secondOfDay % 60);
+    oTimeVals->dayOfWeek = weekDay(days);
+}
+
+size_t
+horoZone_find(horoZone_t* zone, int64_t utc)
+{
+    size_t low = 0;
+    size_t high = zone->numTransitions;
+    size_t cursor = zone->cursor;
+
+    //Ticks move forward, so the last transition or the next one usually fits
+    if((zone->transitions[cursor].at <= utc) &&
+       ((cursor + 1 == zone->numTransitions) || (utc < zone->transitions[cursor + 1].at)))
+    {
+        return cursor;
+    }
+    if((cursor + 1 < zone->numTransitions) && (zone->transitions[cursor + 1].at <= utc) &&
+       ((cursor + 2 == zone->numTransitions) || (utc < zone->transitions[cursor + 2].at)))
+    {
+        zone->cursor = cursor + 1;
+        return zone->cursor;
+    }
+
+    while(high - low > 1)
+    {
+        size_t middle = low + ((high - low) / 2);
+
+        if(zone->transitions[middle].at <= utc) low = middle;
+        else high = middle;
+    }
+
+    zone->cursor = low;
+    return low;
+}
+
+void
+horoZone_breakDown(horoZone_t* zone, int64_t utc, horo_time_t* oTimeVals)
+{
+    horoZone_breakDownOffset(utc, zone->transitions[horoZone_find(zone, utc)].offset,
+                             oTimeVals);
+}
+
+int32_t
+horoZone_shift(horoZone_t const* zone, size_t index)
+{
+    if(index == 0) return 0;
+
+    return zone->transitions[index].offset - zone->transitions[index - 1].offset;
+}
+
+static HORO_ERROR
+addTransition(horoZone_t* zone, size_t* capacity, int64_t at, int32_t offset,
+              int32_t isDst)
+{
+    if(zone->numTransitions == *capacity)
+    {
+        size_t grown = (*capacity == 0) ? 64 : *capacity * 2;
+        horoZoneTransition_t* transitions = NULL;
+
+        transitions = (horoZoneTransition_t*)realloc(zone->transitions,
+                                                     grown * sizeof(horoZoneTransition_t));
+        if(transitions == NULL)
+        {
+            return HORO_ERROR_NO_MEM;
+        }
+        zone->transitions = transitions;
+        *capacity = grown;
+    }
+
+    zone->transitions[zone->numTransitions].at = at;
+    zone->transitions[zone->numTransitions].offset = offset;
+    zone->transitions[zone->numTransitions].isDst = isDst;
+    zone->numTransitions++;
+    return HORO_SUCCESS;
+}
+
+/*
+ * POSIX TZ strings, e.g. "EST5EDT,M3.2.0,M11.1.0" as found at the end of
+ * version 2+ zoneinfo files.
+ */
+typedef struct
+{
+    char kind; /*'M', 'J' or 'n' (zero based day of year)*/
+    int month;
+    int week;
+    int day;
+    int32_t time;
+}posixRule_t;
+
+typedef struct
+{
+    int32_t stdOffset; /*Seconds east of UTC*/
+    int32_t dstOffset;
+    int hasDst;
+    posixRule_t start;
+    posixRule_t end;
+}posixZone_t;
+
+static const char*
+skipZoneName(const char* cursor)
+{
+    if(*cursor == '<')
+    {
+        while(*cursor && (*cursor != '>')) cursor++;
+        return (*cursor == '>') ? cursor + 1 : NULL;
+    }
+
+    if(!isalpha((unsigned char)*cursor)) return NULL;
+    while(isalpha((unsigned char)*cursor)) cursor++;
+    return cursor;
+}
+
+static const char*
+parseNumber(const char* cursor, int* oValue)
+{
+    if(!isdigit((unsigned char)*cursor)) return NULL;
+
+    *oValue = 0;
+    while(isdigit((unsigned char)*cursor))
+    {
+        *oValue = (*oValue * 10) + (*cursor++ - '0');
+        if(*oValue > 100000) return NULL;
+    }
+    return cursor;
+}
+
+/*[+-]hh[:mm[:ss]], the result is in seconds with the sign as written*/
+static const char*
+parseTime(const char* cursor, int32_t* oSeconds)
+{
+    int sign = 1;
+    int value = 0;
+    int32_t seconds = 0;
+
+    if((*cursor == '+') || (*cursor == '-'))
+    {
+        sign = (*cursor++ == '-') ? -1 : 1;
+    }
+
+    cursor = parseNumber(cursor, &value);
+    if(cursor == NULL) return NULL;
+    seconds = value * 3600;
+
+    if(*cursor == ':')
+    {
+        cursor = parseNumber(cursor + 1, &value);
+        if(cursor == NULL) return NULL;
+        seconds += value * 60;
+
+        if(*cursor == ':')
+        {
+            cursor = parseNumber(cursor + 1, &value);
+            if(cursor == NULL) return NULL;
+            seconds += value;
+        }
+    }
+
+    *oSeconds = sign * seconds;
+    return cursor;
+}
+
+static const char*
+parseRule(const char* cursor, posixRule_t* oRule)
+{
+    memset(oRule, 0, sizeof(*oRule));
+    oRule->time = 2 * 3600;
+
+    if(*cursor == 'M')
+    {
+        oRule->kind = 'M';
+        if(((cursor = parseNumber(cursor + 1, &oRule->month)) == NULL) || (*cursor != '.') ||
+           ((cursor = parseNumber(cursor + 1, &oRule->week)) == NULL) || (*cursor != '.') ||
+           ((cursor = parseNumber(cursor + 1, &oRule->day)) == NULL))
+        {
+            return NULL;
+        }
+        if((oRule->month < 1) || (oRule->month > 12) || (oRule->week < 1) ||
+           (oRule->week > 5) || (oRule->day > 6))
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        oRule->kind = (*cursor == 'J') ? 'J' : 'n';
+        if(*cursor == 'J') cursor++;
+        cursor = parseNumber(cursor, &oRule->day);
+        if((cursor == NULL) || (oRule->day > 365)) return NULL;
+    }
+
+    if(*cursor == '/')
+    {
+        cursor = parseTime(cursor + 1, &oRule->time);
+    }
+    return cursor;
+}
+
+static int
+parsePosixZone(const char* string, posixZone_t* oZone)
+{
+    const char* cursor = string;
+    int32_t offset = 0;
+
+    memset(oZone, 0, sizeof(*oZone));
+
+    if(((cursor = skipZoneName(cursor)) == NULL) ||
+       ((cursor = parseTime(cursor, &offset)) == NULL))
+    {
+        return 0;
+    }
+
+    //POSIX offsets are positive west of Greenwich
+    oZone->stdOffset = -offset;
+    if(*cursor == '\0') return 1;
+
+    if((cursor = skipZoneName(cursor)) == NULL) return 0;
+    oZone->hasDst = 1;
+    oZone->dstOffset = oZone->stdOffset + 3600;
+
+    if((*cursor != ',') && (*cursor != '\0'))
+    {
+        if((cursor = parseTime(cursor, &offset)) == NULL) return 0;
+        oZone->dstOffset = -offset;
+    }
+
+    //Without rules the POSIX default is the US rule
+    if(*cursor == '\0')
+    {
+        return (parseRule("M3.2.0", &oZone->start) != NULL) &&
+            (parseRule("M11.1.0", &oZone->end) != NULL);
+    }
+
+    if((*cursor != ',') || ((cursor = parseRule(cursor + 1, &oZone->start)) == NULL) ||
+       (*cursor != ',') || ((cursor = parseRule(cursor + 1, &oZone->end)) == NULL))
+    {
+        return 0;
+    }
+
+    return *cursor == '\0';
+}
+
+/*Local seconds since the epoch at which 'rule' triggers in 'year'*/
+static int64_t
+ruleLocalTime(posixRule_t const* rule, int64_t year)
+{
+    int64_t days = 0;
+
+    if(rule->kind == 'M')
+    {
+        static const int monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+        int length = monthDays[rule->month - 1] + ((rule->month == 2) && isLeapYear(year));
+        int64_t first = daysFromCivil(year, rule->month, 1);
+        int firstDay = weekDay(first);
+        int dayOfMonth = 1 + ((rule->day - firstDay + 7) % 7) + ((rule->week - 1) * 7);
+
+        while(dayOfMonth > length) dayOfMonth -= 7;
+        days = first + dayOfMonth - 1;
+    }
+    else if(rule->kind == 'J')
+    {
+        //1-365, February 29th is never counted
+        days = daysFromCivil(year, 1, 1) + rule->day - 1;
+        if(isLeapYear(year) && (rule->day >= 60)) days++;
+    }
+    else
+    {
+        days = daysFromCivil(year, 1, 1) + rule->day;
+    }
+
+    return (days * SECONDS_PER_DAY) + rule->time;
+}
+
+static HORO_ERROR
+expandPosixZone(horoZone_t* zone, size_t* capacity, posixZone_t const* rule)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    int64_t last = zone->transitions[zone->numTransitions - 1].at;
+    int64_t year = 1970;
+
+    //The last transition of the table already has the fixed offset
+    if(!rule->hasDst)
+    {
+        return HORO_SUCCESS;
+    }
+
+    if(zone->numTransitions > 1)
+    {
+        int64_t lastDays = floorDiv(last, SECONDS_PER_DAY);
+        int month = 0;
+        int day = 0;
+
+        civilFromDays(lastDays, &year, &month, &day);
+    }
+
+    for(; year <= HORO_ZONE_LAST_YEAR; year++)
+    {
+        int64_t start = ruleLocalTime(&rule->start, year) - rule->stdOffset;
+        int64_t end = ruleLocalTime(&rule->end, year) - rule->dstOffset;
+        int64_t first = (start < end) ? start : end;
+        int64_t second = (start < end) ? end : start;
+
+        if(first > last)
+        {
+            err = addTransition(zone, capacity, first,
+                                (first == start) ? rule->dstOffset : rule->stdOffset,
+                                first == start);
+            if(err) return err;
+        }
+        if(second > last)
+        {
+            err = addTransition(zone, capacity, second,
+                                (second == start) ? rule->dstOffset : rule->stdOffset,
+                                second == start);
+            if(err) return err;
+        }
+    }
+
+    return HORO_SUCCESS;
+}
+
+static uint32_t
+readBigEndian32(const unsigned char* bytes)
+{
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+        ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+}
+
+static int64_t
+readBigEndian64(const unsigned char* bytes)
+{
+    return (int64_t)(((uint64_t)readBigEndian32(bytes) << 32) | readBigEndian32(bytes + 4));
+}
+
+typedef struct
+{
+    uint32_t isUtCount;
+    uint32_t isStdCount;
+    uint32_t leapCount;
+    uint32_t timeCount;
+    uint32_t typeCount;
+    uint32_t charCount;
+}tzifCounts_t;
+
+static int
+readTzifHeader(const unsigned char* bytes, size_t size, int* oVersion,
+               tzifCounts_t* oCounts)
+{
+    if((size < 44) || (memcmp(bytes, "TZif", 4) != 0)) return 0;
+
+    *oVersion = (bytes[4] == 0) ? 1 : bytes[4] - '0';
+    oCounts->isUtCount = readBigEndian32(bytes + 20);
+    oCounts->isStdCount = readBigEndian32(bytes + 24);
+    oCounts->leapCount = readBigEndian32(bytes + 28);
+    oCounts->timeCount = readBigEndian32(bytes + 32);
+    oCounts->typeCount = readBigEndian32(bytes + 36);
+    oCounts->charCount = readBigEndian32(bytes + 40);
+
+    return (oCounts->typeCount > 0) && (oCounts->typeCount <= 256) &&
+        (oCounts->timeCount <= 100000) && (oCounts->leapCount <= 100000) &&
+        (oCounts->charCount <= 100000);
+}
+
+static size_t
+tzifDataSize(tzifCounts_t const* counts, size_t timeSize)
+{
+    return (counts->timeCount * timeSize) + counts->timeCount +
+        (counts->typeCount * 6) + counts->charCount +
+        (counts->leapCount * (timeSize + 4)) + counts->isStdCount + counts->isUtCount;
+}
+
+static HORO_ERROR
+parseTzif(horoZone_t* zone, const unsigned char* bytes, size_t size)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    tzifCounts_t counts;
+    const unsigned char* data = NULL;
+    const unsigned char* types = NULL;
+    const unsigned char* footer = NULL;
+    size_t timeSize = 4;
+    size_t capacity = 0;
+    int version = 0;
+    uint32_t i = 0;
+
+    if(!readTzifHeader(bytes, size, &version, &counts)) return HORO_ERROR_CORRUPT;
+    data = bytes + 44;
+    if(tzifDataSize(&counts, 4) > size - 44) return HORO_ERROR_CORRUPT;
+
+    //Version 2+ files repeat the data with 64 bit times, followed by a TZ rule
+    if(version >= 2)
+    {
+        size_t offset = 44 + tzifDataSize(&counts, 4);
+
+        if(!readTzifHeader(bytes + offset, size - offset, &version, &counts))
+        {
+            return HORO_ERROR_CORRUPT;
+        }
+        data = bytes + offset + 44;
+        timeSize = 8;
+        if(tzifDataSize(&counts, 8) > size - offset - 44) return HORO_ERROR_CORRUPT;
+        footer = data + tzifDataSize(&counts, 8);
+    }
+
+    types = data + (counts.timeCount * timeSize) + counts.timeCount;
+
+    //Times before the first transition use the first type
+    err = addTransition(zone, &capacity, INT64_MIN, (int32_t)readBigEndian32(types),
+                        types[4] != 0);
+    if(err) return err;
+
+    for(i = 0; i < counts.timeCount; i++)
+    {
+        const unsigned char* type = NULL;
+        int64_t at = (timeSize == 8) ? readBigEndian64(data + (i * 8)) :
+            (int32_t)readBigEndian32(data + (i * 4));
+        uint8_t typeIndex = data[(counts.timeCount * timeSize) + i];
+
+        if(typeIndex >= counts.typeCount) return HORO_ERROR_CORRUPT;
+        if(at <= zone->transitions[zone->numTransitions - 1].at) continue;
+
+        type = types + (typeIndex * 6);
+        err = addTransition(zone, &capacity, at, (int32_t)readBigEndian32(type),
+                            type[4] != 0);
+        if(err) return err;
+    }
+
+    if((footer != NULL) && (footer < bytes + size) && (*footer == '\n'))
+    {
+        char rule[128];
+        size_t length = 0;
+        posixZone_t posixZone;
+
+        footer++;
+        while((footer + length < bytes + size) && (footer[length] != '\n') &&
+              (length < sizeof(rule) - 1))
+        {
+            rule[length] = (char)footer[length];
+            length++;
+        }
+        rule[length] = '\0';
+
+        if((length > 0) && parsePosixZone(rule, &posixZone))
+        {
+            err = expandPosixZone(zone, &capacity, &posixZone);
+        }
+    }
+
+    return err;
+}
+
+static HORO_ERROR
+readZoneFile(const char* path, unsigned char** oBytes, size_t* oSize)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    FILE* file = NULL;
+    unsigned char* bytes = NULL;
+    size_t size = 0;
+
+    file = fopen(path, "rb");
+    if(file == NULL)
+    {
+        return HORO_ERROR_IO;
+    }
+
+    bytes = (unsigned char*)malloc(ZONE_MAX_FILE_SIZE);
+    if(bytes == NULL)
+    {
+        ret = HORO_ERROR_NO_MEM;
+        goto DONE;
+    }
+
+    size = fread(bytes, 1, ZONE_MAX_FILE_SIZE, file);
+    if(ferror(file) || (size == ZONE_MAX_FILE_SIZE))
+    {
+        ret = HORO_ERROR_IO;
+        goto DONE;
+    }
+
+    *oBytes = bytes;
+    *oSize = size;
+    bytes = NULL;
+
+DONE:
+    free(bytes);
+    fclose(file);
+    return ret;
+}
+
+HORO_ERROR
+horoZone_load(const char* name, horoZone_t** oZone)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    horoZone_t* zone = NULL;
+    const char* directory = getenv("TZDIR");
+    unsigned char* bytes = NULL;
+    char* path = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+
+    //Zone names are relative paths below the zoneinfo directory
+    if((name[0] == '\0') || (name[0] == '/') || (strstr(name, "..") != NULL))
+    {
+        return HORO_ERROR_ILLEGAL_ARG;
+    }
+    if((directory == NULL) || (directory[0] == '\0'))
+    {
+        directory = ZONE_DEFAULT_DIR;
+    }
+
+    zone = (horoZone_t*)calloc(1, sizeof(horoZone_t));
+    path = (char*)malloc(strlen(directory) + strlen(name) + 2);
+    if((zone == NULL) || (path == NULL))
+    {
+        ret = HORO_ERROR_NO_MEM;
+        goto DONE;
+    }
+
+    zone->name = (char*)malloc(strlen(name) + 1);
+    if(zone->name == NULL)
+    {
+        ret = HORO_ERROR_NO_MEM;
+        goto DONE;
+    }
+    strcpy(zone->name, name);
+
+    sprintf(path, "%s/%s", directory, name);
+    ret = readZoneFile(path, &bytes, &size);
+    if(ret && (strcmp(name, "UTC") == 0))
+    {
+        ret = addTransition(zone, &capacity, INT64_MIN, 0, 0);
+    }
+    else if(!ret)
+    {
+        ret = parseTzif(zone, bytes, size);
+    }
+
+DONE:
+    if(ret)
+    {
+        horoZone_free(zone);
+    }
+    else
+    {
+        *oZone = zone;
+    }
+    free(bytes);
+    free(path);
+    return ret;
+}
+
+void
+horoZone_free(horoZone_t* zone)
+{
+    if(zone == NULL) return;
+
+    free(zone->name);
+    free(zone->transitions);
+    free(zone);
+}
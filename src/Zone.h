@@ -0,0 +1,65 @@
+/**
+ * December 19, 2013
+ * The author disclaims copyright to this source code.
+ */
+
+#ifndef ZONE_H
+#define ZONE_H
+
+#include "horo.h"
+
+/*The UTC offset of a zone from 'at' until the next transition*/
+typedef struct
+{
+    int64_t at; /*UTC seconds, the first transition starts at INT64_MIN*/
+    int32_t offset; /*Seconds east of UTC*/
+    int32_t isDst;
+}horoZoneTransition_t;
+
+/*
+ * An IANA time zone loaded from the system's compiled zoneinfo files.
+ * Transitions described by the POSIX TZ rule at the end of the file are
+ * expanded into the table up to HORO_ZONE_LAST_YEAR, later times keep the
+ * last offset.
+ */
+typedef struct
+{
+    char* name;
+    horoZoneTransition_t* transitions;
+    size_t numTransitions;
+
+    /*Index of the transition found by the last lookup*/
+    size_t cursor;
+}horoZone_t;
+
+#define HORO_ZONE_LAST_YEAR 2199
+
+/*
+ * Loads "$TZDIR/<name>" (default /usr/share/zoneinfo).  "UTC" is always
+ * available.
+ */
+HORO_INTERNAL HORO_ERROR
+horoZone_load(const char* name, horoZone_t** oZone);
+
+HORO_INTERNAL void
+horoZone_free(horoZone_t* zone);
+
+/*Index of the transition in effect at 'utc'*/
+HORO_INTERNAL size_t
+horoZone_find(horoZone_t* zone, int64_t utc);
+
+/*Local time fields of 'utc' in a zone that is 'offset' seconds east of UTC*/
+HORO_INTERNAL void
+horoZone_breakDownOffset(int64_t utc, int32_t offset, horo_time_t* oTimeVals);
+
+HORO_INTERNAL void
+horoZone_breakDown(horoZone_t* zone, int64_t utc, horo_time_t* oTimeVals);
+
+/*
+ * Seconds the wall clock jumps at transition 'index', positive when it
+ * springs forward and negative when it falls back.
+ */
+HORO_INTERNAL int32_t
+horoZone_shift(horoZone_t const* zone, size_t index);
+
+#endif
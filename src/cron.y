@@ -9,7 +9,7 @@
 %extra_argument {CronVals* cronVals}
 
 %syntax_error {
-    fprintf(stderr, "Error!!\n");
+    cronVals->error = HORO_ERROR_PARSER_ILLEGAL_FIELD;
 }
 
 %name horoParser
@@ -92,6 +92,30 @@ cronstring ::= cronfield(CF1) SPACE cronfield(CF2) SPACE cronfield(CF3)
         }
 }
 
+cronstring ::= cronfield(CF0) SPACE cronfield(CF1) SPACE cronfield(CF2) SPACE
+               cronfield(CF3) SPACE cronfield(CF4) SPACE cronfield(CF5). {
+
+        if((cronVals->error = setCronFieldValues(&CF0, HORO_POSITION_SECOND)) ||
+           (cronVals->error = setCronFieldValues(&CF1, HORO_POSITION_MINUTE)) ||
+           (cronVals->error = setCronFieldValues(&CF2, HORO_POSITION_HOUR)) ||
+           (cronVals->error = setCronFieldValues(&CF3, HORO_POSITION_DOM)) ||
+           (cronVals->error = setCronFieldValues(&CF4, HORO_POSITION_MONTH)) ||
+           (cronVals->error = setCronFieldValues(&CF5, HORO_POSITION_DOW)))
+        {
+            /*do nothing*/
+        }
+        else
+        {
+            cronVals->second = CF0.val;
+            cronVals->minute = CF1.val;
+            cronVals->hour = CF2.val;
+            cronVals->dayOfMonth = CF3.val;
+            cronVals->month = CF4.val;
+            cronVals->dayOfWeek = CF5.val;
+            cronVals->error = validateCronVals(cronVals);
+        }
+}
+
 %type cronfield {CronField}
 
 cronfield(CF) ::= ASTERISK. {
@@ -101,43 +125,9 @@ cronfield(CF) ::= ASTERISK. {
     CF.typeVal.asteriskStep = 1;
 }
 
-cronfield(CF) ::= list(L) COMMA rangelist(RL). {
-
-    memset(&CF, 0, sizeof(CF));
-    CF.type = HORO_FIELD_TYPE_LIST | HORO_FIELD_TYPE_RANGELIST;
-    memcpy(&CF.typeVal.list, &L, sizeof(L));
-    memcpy(&CF.typeVal.range, &RL, sizeof(RL));
-    //    cronFieldFromList(&L, &CF);
-    //    cronFieldFromRangeList(&RL, &CF); 
-} 
-
-cronfield(CF) ::= list(L) COMMA range(R). {
-
-    memset(&CF, 0, sizeof(CF));
-    CF.type = HORO_FIELD_TYPE_LIST | HORO_FIELD_TYPE_RANGE;
-    memcpy(&CF.typeVal.list, &L, sizeof(L));
-    memcpy(&CF.typeVal.range, &R, sizeof(R));
-    //    cronFieldFromList(&L, &CF);
-    //    cronFieldFromRange(&R, &CF); 
-}
-
-cronfield(CF) ::= list(L) COMMA step(S). {
-
-    memset(&CF, 0, sizeof(CF));
-    CF.type = HORO_FIELD_TYPE_LIST | HORO_FIELD_TYPE_RANGE;
-    memcpy(&CF.typeVal.list, &L, sizeof(L));
-    memcpy(&CF.typeVal.range, &S, sizeof(S));
-    //    cronFieldFromList(&L, &CF);
-    //    cronFieldFromRange(&S, &CF); 
-}
-
- 
-cronfield(CF) ::= list(L). {
+cronfield(CF) ::= fieldlist(FL). {
 
-    memset(&CF, 0, sizeof(CF));
-    CF.type = HORO_FIELD_TYPE_LIST;
-    memcpy(&CF.typeVal.list, &L, sizeof(L));
-    //    cronFieldFromList(&L, &CF);
+    CF = FL;
 }
 
 cronfield(CF) ::= asteriskstep(AS). {
@@ -154,13 +144,6 @@ cronfield(CF) ::= step(S). {
     memcpy(&CF.typeVal.range, &S, sizeof(S));
     //    cronFieldFromRange(&S, &CF);
 }
-cronfield(CF) ::= rangelist(RL). {
-
-    memset(&CF, 0, sizeof(CF));
-    CF.type = HORO_FIELD_TYPE_RANGELIST;
-    memcpy(&CF.typeVal.rangeList, &RL, sizeof(RL));
-    //    cronFieldFromRangeList(&RL, &CF);
-}
 
 cronfield(CF) ::= range(R). {
 
@@ -178,41 +161,36 @@ cronfield(CF) ::= number(N). {
     //    CF.val = (1 << N);
 }
 
-%type rangelist {RangeList}
-rangelist(RL) ::= rangelist(RL2) COMMA step(S). {
-
-    RL2.ranges[RL2.numRanges++] = S;
-    RL = RL2;  
-}
+%type fieldlist {CronField}
+fieldlist(FL) ::= fieldlist(FL2) COMMA listitem(I). {
 
-rangelist(RL) ::= rangelist(RL2) COMMA range(R). {
-        
-    RL2.ranges[RL2.numRanges++] = R;
-    RL = RL2;
+    FL = FL2;
+    addFieldListItem(&FL, &I);
 }
 
-rangelist(RL) ::= step(S1) COMMA step(S2). {
+fieldlist(FL) ::= listitem(I1) COMMA listitem(I2). {
 
-    RL.ranges[RL.numRanges++] = S1;
-    RL.ranges[RL.numRanges++] = S2;
+    memset(&FL, 0, sizeof(FL));
+    addFieldListItem(&FL, &I1);
+    addFieldListItem(&FL, &I2);
 }
 
-rangelist(RL) ::= step(S) COMMA range(R). {
+%type listitem {Range}
+listitem(I) ::= number(N). {
 
-    RL.ranges[RL.numRanges++] = S;
-    RL.ranges[RL.numRanges++] = R;
-} 
+    I.start = N;
+    I.stop = N;
+    I.step = 1;
+}
 
-rangelist(RL) ::= range(R) COMMA step(S). {
+listitem(I) ::= range(R). {
 
-    RL.ranges[RL.numRanges++] = R;
-    RL.ranges[RL.numRanges++] = S;
+    I = R;
 }
 
-rangelist(RL) ::= range(R1) COMMA range(R2). {
+listitem(I) ::= step(S). {
 
-    RL.ranges[RL.numRanges++] = R1;
-    RL.ranges[RL.numRanges++] = R2;
+    I = S;
 }
 
 %type asteriskstep {Range}
@@ -230,19 +208,6 @@ step(S) ::= range(R) STEP number(N). {
     S.step = N;
 }
 
-%type list {List}
-list(L) ::= list(L2) COMMA number(N). {
-
-    L2.listNums[L2.numCount++] = N;
-    L = L2;
-}
-
-list(L) ::= number(N1) COMMA number(N2). {
-        
-    L.listNums[L.numCount++] = N1;
-    L.listNums[L.numCount++] = N2;    
-}
-
 %type range {Range}
 range(R) ::= number(START) DASH number(STOP). {
         
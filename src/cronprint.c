@@ -87,6 +87,7 @@ main(int argc, char** argv)
 
 
         horoTime.dayOfWeek = timeinfo->tm_wday;
+        horoTime.second = timeinfo->tm_sec;
         err = horo_process(clock, &horoTime);
         delay();
     }
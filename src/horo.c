@@ -6,16 +6,26 @@
 #include "horo.h" /*Use <> so that horo.h can
                        *reside in a different directory from the source.*/
 #include "Parser.h"
+#include "Histogram.h"
+#include "Trace.h"
+#include "Zone.h"
   
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
   
 #define RETURN_ILLEGAL_IF(statement) if((statement)) return HORO_ERROR_ILLEGAL_ARG
 
-#define VALIDATE_RANGE_OR_RETURN(var, min, max)  \
-    if(((var) < (min)) || ((var) > (max))) return HORO_ERROR_OUT_OF_RANGE
-
 #define IS_INITIALIZED(container) ((container)->initKey == INITIALIZED_KEY)
 
 #define RETURN_IF_NOT_INITIALIZED(container) if(!IS_INITIALIZED((container))) return HORO_ERROR_NOT_INITIALIZED
@@ -44,7 +54,6 @@ typedef struct horoContainer
     size_t numElements;
 }horoContainer_t;
 
-typedef HORO_ERROR (*horoList_forEachFunc)(void *data, void *userp);
 typedef horoContainer_t horoList_t;
 
 static HORO_ERROR
@@ -188,95 +197,65 @@ END:
     return ret;
 }
 
-static HORO_ERROR
-horoList_size(horoContainer_t *list, size_t *sizeReturn)
-{
-    RETURN_ILLEGAL_IF(list == NULL);
-    RETURN_IF_NOT_INITIALIZED(list);
-    RETURN_ILLEGAL_IF(sizeReturn == NULL);
-    *sizeReturn = list->numElements;
-
-    return HORO_SUCCESS;
-}
-
-static HORO_ERROR
-horoList_remove(horoContainer_t *list, int index)
+static void
+unlinkListNode(horoContainer_t *list, horoContainerNode_t *node)
 {
-    HORO_ERROR ret = HORO_SUCCESS;
-    int count = 0;
-    horoContainerNode_t *currNode = list->head;
-
-
-    RETURN_ILLEGAL_IF(list == NULL);
-    RETURN_IF_NOT_INITIALIZED(list);
-    RETURN_ILLEGAL_IF(list->head == NULL);
-    RETURN_ILLEGAL_IF(index < 0);
-
-    if(index > (list->numElements - 1))
-    {
-        ret = HORO_ERROR_ILLEGAL_ARG;
-        goto DONE;
-    }
-
-    while((count != index))
-    {
-        if(currNode != NULL)
-        {
-            currNode = currNode->next;
-        }
-        count++;
-    }
-
-    if(currNode == NULL)
-    {
-        ret = HORO_ERROR_CORRUPT;
-        goto DONE;
-    }
-
-    if(currNode == list->head)
+    if(node == list->head)
     {
-        list->head = currNode->next;
+        list->head = node->next;
     }
-    if(currNode == list->tail)
+    if(node == list->tail)
     {
-        list->tail = currNode->prev;
+        list->tail = node->prev;
     }
-    if(currNode->prev != NULL)
+    if(node->prev != NULL)
     {
-        currNode->prev->next = currNode->next;
+        node->prev->next = node->next;
     }
-    if(currNode->next != NULL)
+    if(node->next != NULL)
     {
-        currNode->next->prev = currNode->prev;
+        node->next->prev = node->prev;
     }
 
-    freeListNode(currNode);
+    freeListNode(node);
     --list->numElements;
-DONE:
-    return ret;
 }
 
 static HORO_ERROR
-horoList_forEach(const horoContainer_t *list,
-                  horoList_forEachFunc callBack,
-                  void *userp)
+horoList_removeNode(horoContainer_t *list, horoContainerNode_t *node)
 {
+    RETURN_ILLEGAL_IF(list == NULL);
+    RETURN_IF_NOT_INITIALIZED(list);
+    RETURN_ILLEGAL_IF(node == NULL);
 
-    HORO_ERROR err = HORO_SUCCESS;
-    horoContainerNode_t *currNode = list->head;
+    unlinkListNode(list, node);
+    return HORO_SUCCESS;
+}
+
+typedef int (*horoList_matchFunc)(void *data, void *userp);
+
+/*
+ * Removes every element for which 'match' returns nonzero in a single walk.
+ * 'match' is called before the element is freed.
+ */
+static HORO_ERROR
+horoList_removeEach(horoContainer_t *list, horoList_matchFunc match, void *userp)
+{
+    horoContainerNode_t *currNode = NULL;
+    horoContainerNode_t *nextNode = NULL;
 
     RETURN_ILLEGAL_IF(list == NULL);
     RETURN_IF_NOT_INITIALIZED(list);
 
-    while(currNode != NULL)
+    for(currNode = list->head; currNode != NULL; currNode = nextNode)
     {
-        err = (*callBack)(currNode->data, userp);
-        if(err) break;
+        nextNode = currNode->next;
+        if(!(*match)(currNode->data, userp)) continue;
 
-        currNode = currNode->next;
+        unlinkListNode(list, currNode);
     }
 
-    return err;
+    return HORO_SUCCESS;
 }
 
 static void
@@ -298,236 +277,4226 @@ horoList_destroyNodes(horoContainer_t *list)
     horoList_init(list);
 }
 
+typedef struct
+{
+    horoHistogram_t lateness;
+    horoHistogram_t duration;
+}horoActionStats_t;
+
+/*The fields of an entry that most actions never use, see entryExtra()*/
+typedef struct
+{
+    /*Allocated the first time the action executes with stats enabled*/
+    horoActionStats_t* stats;
+
+    /*Stable name set by horo_setActionKey()*/
+    char* key;
+
+    /*Slot in the checkpoint file that mirrors lastRunStamp*/
+    volatile uint32_t* checkpointStamp;
+}horoEntryExtra_t;
+
+#define ENTRY_STATS(entry) \
+    (((entry)->extra != NULL) ? (entry)->extra->stats : NULL)
+#define ENTRY_KEY(entry) \
+    (((entry)->extra != NULL) ? (entry)->extra->key : NULL)
+#define ENTRY_CHECKPOINT(entry) \
+    (((entry)->extra != NULL) ? (entry)->extra->checkpointStamp : NULL)
+
 struct horo_entry
 {
     uint64_t id;
     
-    CronVals scheduleVals;    
-
-    horo_time_t lastRuntime;
+    PackedCronVals scheduleVals;    
   
     horo_actionFunc action;
     void *actionData;
+
+    /*Allocated on first use, NULL for most entries*/
+    horoEntryExtra_t* extra;
+
+    /*
+     * Entries with a seconds field cache whether their minute level fields
+     * match the minute of 'matchStamp' so that they are evaluated once per
+     * minute instead of once per second.
+     */
+    uint32_t matchStamp;
+
+    /*packRuntime() of the last run, 0 if the action has not run*/
+    uint32_t lastRunStamp;
+
+    /*
+     * Position in its group's minuteEntries, and in the plan's dense or
+     * pending array, so that it is removed without a search
+     */
+    uint32_t minuteIndex;
+    uint32_t planIndex;
+
+    /*Index of the zone group in horo_clock::groups*/
+    uint16_t group;
+
+    /*Index + 1 in horo_clock::limitGroups, 0 if not in a group*/
+    uint16_t limitGroup;
+    uint8_t priority;
+
+    /*A HORO_DST_POLICY*/
+    uint8_t dstPolicy;
+
+    /*Where the entry is in its group's day plan, see horoDayPlan_t*/
+    uint8_t planState;
+
+    /*The flags are 0 or 1, they are kept in one byte*/
+    unsigned minuteMatch : 1;
+
+    /*lastRunStamp was seen in the hour repeated after falling back*/
+    unsigned lastRunRepeated : 1;
+
+    /*Marked for removal, see removeMarkedEntries()*/
+    unsigned removed : 1;
+
+    /*Scheduled by an action callback, runs from the next tick on*/
+    unsigned deferred : 1;
+
+    /*Unscheduled after it runs once*/
+    unsigned oneShot : 1;
+
+    /*Skipped by the matcher, see horo_setActionEnabled()*/
+    unsigned disabled : 1;
+
+    /*Waiting in the queue of a group*/
+    unsigned queued : 1;
 };
 typedef struct horo_entry horo_entry_t;
 
+#define SECONDS_PER_MINUTE 60
+#define MINUTES_PER_DAY (24 * 60)
+
+/*A growable array of entry pointers*/
+typedef struct
+{
+    horo_entry_t** entries;
+    size_t numEntries;
+    size_t capacity;
+}horoEntryArray_t;
+
+/*
+ * Open addressing map from action ids to the list nodes of their entries,
+ * so that an action is found and removed without walking the entry list.
+ */
+typedef struct
+{
+    horoContainerNode_t** slots;
+    size_t capacity;
+    size_t numNodes;
+}horoEntryIndex_t;
+
+/*A schedule set by an action callback, swapped in when the tick is done*/
+typedef struct
+{
+    horo_entry_t* entry;
+    PackedCronVals scheduleVals;
+}horoReschedule_t;
+
+enum
+{
+    PLAN_NOT_TODAY,
+    PLAN_SPARSE,
+    PLAN_DENSE,
+    PLAN_PENDING
+};
+
+/*Entries that fire more often than this per day are not spread over the plan*/
+#define PLAN_DENSE_FIRES 24
+
+/*Entries added since the plan was built before it is rebuilt*/
+#define PLAN_MAX_PENDING 64
+
+/*
+ * The entries without a seconds field that run on one day, so that the
+ * month, day of month and day of week of an entry are evaluated once per
+ * day instead of once per minute.
+ *
+ * Entries that fire at most PLAN_DENSE_FIRES times a day are listed under
+ * every minute of the day they fire at.  The entries of minute of day M are
+ * fired[minuteStart[M]] up to fired[minuteStart[M + 1]], removed entries
+ * leave a NULL behind.  Entries that fire more often are in 'dense' and
+ * still have their minute and hour checked.  Entries added after the plan
+ * was built are in 'pending' and are checked like entries without a plan.
+ */
+typedef struct
+{
+    int valid;
+    int dayOfMonth;
+    int month;
+    int dayOfWeek;
+
+    uint32_t minuteStart[MINUTES_PER_DAY + 1];
+    horo_entry_t** fired;
+    size_t firedCapacity;
+
+    horoEntryArray_t dense;
+    horoEntryArray_t pending;
+}horoDayPlan_t;
+
+/*
+ * The entries that share a time zone, so that the local time fields of a
+ * tick are computed once per zone instead of once per entry.
+ *
+ * Entries with a seconds field are only reachable through the wheel slots
+ * of their seconds, so a tick only visits the slot of its second.  Entries
+ * without one are only walked when the minute changes or entries were
+ * added since the last walk.
+ */
+typedef struct
+{
+    /*NULL for the local time passed to horo_process()*/
+    horoZone_t* zone;
+
+    horoEntryArray_t minuteEntries;
+    horoEntryArray_t secondsWheel[SECONDS_PER_MINUTE];
+    uint32_t lastMinuteStamp;
+    int entriesAdded;
+
+    /*
+     * Number of entries whose schedule includes each minute, hour and month.
+     * A tick whose minute, hour or month is not included by any entry can
+     * not run anything.
+     */
+    uint32_t minuteCounts[60];
+    uint32_t hourCounts[24];
+    uint32_t monthCounts[13];
+
+    /*Entries with a seconds field, the only ones that look at the second*/
+    uint32_t secondsEntries;
+
+    /*The arrays that hold entries marked for removal, see markRemoved()*/
+    int minuteRemovals;
+    uint64_t secondsRemovals;
+
+    /*UTC time of the previous horo_processUtc() tick of a zone group*/
+    int64_t lastUtc;
+    int haveLastUtc;
+
+    horoDayPlan_t plan;
+}horoZoneGroup_t;
+
+#define LOCAL_GROUP 0
+
+/*Action ids waiting in one priority level of a limit group, a ring buffer*/
+typedef struct
+{
+    int* ids;
+    size_t head;
+    size_t count;
+    size_t capacity;
+}horoGroupQueue_t;
+
+/*
+ * A group of actions that share admission limits, see horo_setGroupLimits().
+ * A tick queues every fire of a grouped action, the queues are drained
+ * into the free slots when the tick is done so that priorities apply to
+ * everything that fired in the tick.
+ */
+typedef struct
+{
+    int id;
+    horo_group_limits_t limits;
+
+    /*Only levels[0] is used by HORO_GROUP_FIFO groups*/
+    horoGroupQueue_t levels[HORO_GROUP_MAX_PRIORITY + 1];
+    int numPending;
+
+    /*Everything but 'pending', which is numPending*/
+    horo_group_stats_t stats;
+}horoLimitGroup_t;
 
 struct horo_clock
 {
     horoList_t entries;
+    horoEntryIndex_t entryIndex;
 
     horo_time_t lastTick;
     uint64_t nextActionID;
+
+    int statsEnabled;
+
+    /*Lateness of the current tick at the moment tickStart was sampled*/
+    uint64_t tickLateness;
+    uint64_t tickStart;
+
+    horo_traceFunc traceBegin;
+    horo_traceFunc traceEnd;
+    void* traceUserp;
+
+    struct horoCheckpoint* checkpoint;
+
+    /*
+     * groups[LOCAL_GROUP] always exists, zones are added on first use.  The
+     * groups are allocated one by one so that a zone loaded by an action
+     * callback does not move the group that is being processed.
+     */
+    horoZoneGroup_t** groups;
+    size_t numGroups;
+
+    /*Allocated one by one for the same reason as the zone groups*/
+    horoLimitGroup_t** limitGroups;
+    size_t numLimitGroups;
+
+    /*
+     * Set while a tick runs actions.  Entries scheduled by the actions are
+     * collected in deferredAdds, entries they unschedule are only marked and
+     * schedules they change are collected in deferredReschedules, all are
+     * applied when the tick is done.
+     */
+    int processing;
+    int removalsPending;
+    horoEntryArray_t deferredAdds;
+    horoReschedule_t* deferredReschedules;
+    size_t numDeferredReschedules;
+    size_t deferredReschedulesCapacity;
 };
 
-HORO_ERROR
-horo_scheduleAction(horo_clock_t* clock, const char *scheduleString, 
-                     horo_actionFunc action, void *actionData,
-                     int* oActionID)
+#ifdef _WIN32
+static uint64_t
+monotonicMicros()
 {
-    HORO_ERROR err = HORO_SUCCESS;
-    horo_entry_t newEntry;
-    CronVals cronVals;
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
 
-    RETURN_ILLEGAL_IF(scheduleString == NULL);
-    RETURN_ILLEGAL_IF(action == NULL);
-    RETURN_ILLEGAL_IF(oActionID == NULL);
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
 
-    err = processCronString(scheduleString, &cronVals);
-    if(err) goto DONE;
-        
-    newEntry.id = clock->nextActionID++;
-    newEntry.scheduleVals.minute = cronVals.minute;
-    newEntry.scheduleVals.hour = cronVals.hour;
-    newEntry.scheduleVals.dayOfMonth = cronVals.dayOfMonth;
-    newEntry.scheduleVals.month = cronVals.month;
-    newEntry.scheduleVals.dayOfWeek = cronVals.dayOfWeek;
+    return ((uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000) +
+        (((uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000) /
+         frequency.QuadPart);
+}
 
-    memset(&newEntry.lastRuntime, 0, sizeof(newEntry.lastRuntime));
-    
-    newEntry.action = action;
-    newEntry.actionData = actionData;
+static uint64_t
+wallMicrosIntoMinute(int* oWallMinute)
+{
+    SYSTEMTIME localTime;
 
-    err = horoList_add(&clock->entries, &newEntry, sizeof(newEntry)); 
-    if(err) goto DONE;
+    GetLocalTime(&localTime);
+    *oWallMinute = localTime.wMinute;
+    return ((uint64_t)localTime.wSecond * 1000000) +
+        ((uint64_t)localTime.wMilliseconds * 1000);
+}
 
-    *oActionID = newEntry.id;
-DONE:
-    return err;
+#else
+static uint64_t
+monotonicMicros()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)now.tv_sec * 1000000) + ((uint64_t)now.tv_nsec / 1000);
 }
 
-typedef struct
+static uint64_t
+wallMicrosIntoMinute(int* oWallMinute)
 {
-    horo_clock_t* clock;
-    horo_time_t const* userTime;
-}checkEntryData_t;
+    struct timespec now;
+    struct tm localTime;
 
-static int
-checkDOMWithDOW(uint64_t dayOfMonth, uint64_t dayOfWeek, 
-                horo_time_t const* timeVals)
+    clock_gettime(CLOCK_REALTIME, &now);
+    localtime_r(&now.tv_sec, &localTime);
+    *oWallMinute = localTime.tm_min;
+    return ((uint64_t)localTime.tm_sec * 1000000) + ((uint64_t)now.tv_nsec / 1000);
+}
+#endif
+
+/*
+ * Sample the wall clock once per tick.  The lateness of each action is
+ * then derived from the monotonic clock so that dispatching does not
+ * require a call to localtime().  The tick is due at its second, which is
+ * 0 unless the clock has schedules with a seconds field.
+ */
+static void
+startTickStats(horo_clock_t* clock, horo_time_t const* userTime)
 {
-    if((dayOfMonth == HORO_ASTERISK) &&
-       (dayOfWeek == HORO_ASTERISK))
-    {
-        return 1;
-    }
+    int wallMinute = 0;
+    uint64_t intoMinute = wallMicrosIntoMinute(&wallMinute);
+    int minutesLate = ((wallMinute - userTime->minute) + 60) % 60;
+    uint64_t late = ((uint64_t)minutesLate * 60 * 1000000) + intoMinute;
+    uint64_t due = (uint64_t)userTime->second * 1000000;
 
-    if((dayOfMonth != HORO_ASTERISK) &&
-       (dayOfWeek != HORO_ASTERISK))
+    clock->tickStart = monotonicMicros();
+    clock->tickLateness = (late > due) ? late - due : 0;
+}
+
+static void
+callTraceHook(horo_clock_t* clock, horo_traceFunc hook, HORO_TRACE_TYPE type,
+              horo_time_t const* timeVals, horo_entry_t const* entry,
+              const char* scheduleString, size_t scheduleLength,
+              CronVals const* cronVals, HORO_ERROR error)
+{
+    horo_trace_event_t event;
+    CronVals entryVals;
+
+    memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.timeVals = timeVals;
+    event.scheduleString = scheduleString;
+    event.scheduleLength = scheduleLength;
+    event.error = error;
+
+    if(entry != NULL)
     {
-        if((dayOfWeek & ((uint64_t)1 << timeVals->dayOfWeek)) &&
-           (dayOfMonth & ((uint64_t)1 << timeVals->dayOfMonth)))
-        {
-            return 1;
-        }
+        event.actionID = (int)entry->id;
+        unpackCronVals(&entry->scheduleVals, &entryVals);
+        cronVals = &entryVals;
     }
 
-    if(dayOfMonth == HORO_ASTERISK)
+    if(cronVals != NULL)
     {
-        if(dayOfWeek & ((uint64_t)1 << timeVals->dayOfWeek))
-        {
-            return 1;
-        }
+        event.minuteMask = cronVals->minute;
+        event.hourMask = cronVals->hour;
+        event.dayOfMonthMask = cronVals->dayOfMonth;
+        event.monthMask = cronVals->month;
+        event.dayOfWeekMask = cronVals->dayOfWeek;
+        event.secondMask = cronVals->second;
     }
 
-    if(dayOfWeek == HORO_ASTERISK)
+    hook(clock->traceUserp, &event);
+}
+
+/*Returns the extra fields of an entry, allocating them, NULL if out of memory*/
+static horoEntryExtra_t*
+entryExtra(horo_entry_t* entry)
+{
+    if(entry->extra == NULL)
     {
-        if(dayOfMonth & ((uint64_t)1 << timeVals->dayOfMonth))
-        {
-            return 1;
-        }
+        entry->extra = (horoEntryExtra_t*)calloc(1, sizeof(horoEntryExtra_t));
     }
-
-    return 0;
+    return entry->extra;
 }
 
-static HORO_ERROR
-checkEachEntry(horo_entry_t* entry, checkEntryData_t* checkEntryData)
+static void
+dispatchWithStats(horo_clock_t* clock, horo_entry_t* entry)
 {
-    horo_time_t const* lastRuntime = NULL;
-    horo_time_t const* userTime = checkEntryData->userTime;
-    
-    if((entry->scheduleVals.minute & ((uint64_t)1 << userTime->minute)) &&
-       (entry->scheduleVals.hour & ((uint64_t)1 << userTime->hour)) && 
-       (entry->scheduleVals.month & ((uint64_t)1 << userTime->month)) &&
-       checkDOMWithDOW(entry->scheduleVals.dayOfMonth,
-                       entry->scheduleVals.dayOfWeek,
-                       userTime))
-    {
-        lastRuntime = &entry->lastRuntime;
-        if((lastRuntime->minute != userTime->minute) ||
-           (lastRuntime->hour != userTime->hour) ||
-           (lastRuntime->dayOfMonth != userTime->dayOfMonth) ||
-           (lastRuntime->month != userTime->month) ||
-           (lastRuntime->dayOfWeek != userTime->dayOfWeek))
+    horoActionStats_t* stats = ENTRY_STATS(entry);
+    uint64_t start = 0;
+
+    if(stats == NULL)
+    {
+        if(entryExtra(entry) != NULL)
+        {
+            stats = (horoActionStats_t*)malloc(sizeof(horoActionStats_t));
+        }
+        if(stats == NULL)
         {
             entry->action(entry->actionData);
-            entry->lastRuntime = *userTime;
+            return;
         }
+        horoHistogram_init(&stats->lateness);
+        horoHistogram_init(&stats->duration);
+        entry->extra->stats = stats;
     }
 
-    return HORO_SUCCESS;
+    start = monotonicMicros();
+    horoHistogram_record(&stats->lateness,
+                         clock->tickLateness + (start - clock->tickStart));
+
+    entry->action(entry->actionData);
+
+    horoHistogram_record(&stats->duration, monotonicMicros() - start);
 }
 
-HORO_ERROR
-horo_init(horo_clock_t** oClock)
+static void
+dispatchEntry(horo_clock_t* clock, horo_entry_t* entry,
+              horo_time_t const* userTime)
 {
-    RETURN_ILLEGAL_IF(oClock == NULL);
+    HORO_PROBE_ACTION_BEGIN(entry->id, &entry->scheduleVals);
+    if(clock->traceBegin != NULL)
+    {
+        callTraceHook(clock, clock->traceBegin, HORO_TRACE_ACTION, userTime,
+                      entry, NULL, 0, NULL, HORO_SUCCESS);
+    }
 
-    //TODO: Add callback for memory allocation
-    *oClock = malloc(sizeof(horo_clock_t));
-    if(*oClock == NULL)
+    if(clock->statsEnabled)
     {
-        return HORO_ERROR_NO_MEM;
+        dispatchWithStats(clock, entry);
     }
-    
-    memset(&(*oClock)->lastTick, 0, sizeof((*oClock)->lastTick));
-    (*oClock)->nextActionID=0;
-    return horoList_init(&(*oClock)->entries);
+    else
+    {
+        entry->action(entry->actionData);
+    }
+
+    if(clock->traceEnd != NULL)
+    {
+        callTraceHook(clock, clock->traceEnd, HORO_TRACE_ACTION, userTime,
+                      entry, NULL, 0, NULL, HORO_SUCCESS);
+    }
+    HORO_PROBE_ACTION_END(entry->id);
 }
 
-HORO_ERROR
-horo_process(horo_clock_t* clock, horo_time_t const* userTime)
+#define CHECKPOINT_MAGIC "HOROCKPT"
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_MIN_CAPACITY 16
+
+typedef struct
 {
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;
 
-    size_t numEntries = 0;
-    HORO_ERROR ret = HORO_SUCCESS;
+    /*Incremented every time the file is opened*/
+    uint32_t generation;
 
-    VALIDATE_RANGE_OR_RETURN(userTime->minute, 0, 59);
-    VALIDATE_RANGE_OR_RETURN(userTime->hour, 0, 23);
-    VALIDATE_RANGE_OR_RETURN(userTime->dayOfMonth, 1, 31);
-    VALIDATE_RANGE_OR_RETURN(userTime->month, 1, 12);
-    VALIDATE_RANGE_OR_RETURN(userTime->dayOfWeek, 0, 7);
+    /*Slots in use*/
+    uint32_t numSlots;
+}checkpointHeader_t;
 
-    ret = horoList_size(&clock->entries, &numEntries);
-    if(ret)
-    {
-        return ret;
-    }
+/*An open addressed slot.  keyHash 0 marks an unused slot.*/
+typedef struct
+{
+    uint64_t keyHash;
+    uint32_t stamp;
 
-    if(numEntries > 0)
-    {
-        checkEntryData_t entryCheck;
-        entryCheck.clock = clock;
-        entryCheck.userTime = userTime;
+    /*The last generation in which an action had the key*/
+    uint32_t generation;
+}checkpointSlot_t;
 
-        //TODO: check return
-        horoList_forEach((horoContainer_t*)&clock->entries,
-                          (horoList_forEachFunc)checkEachEntry,
-                          &entryCheck);
+/*
+ * Slots are never removed one by one.  When the table gets 3/4 full it is
+ * rebuilt into a new file that keeps the keys of the current actions and
+ * the keys seen in the previous generation, which a restarted process may
+ * not have set again yet.  Keys of actions that went away are dropped, so
+ * a long running process that keeps changing keys does not fill the file.
+ */
+struct horoCheckpoint
+{
+    void* base;
+    size_t size;
+    char* path;
+    uint32_t capacity;
+    uint32_t generation;
+    checkpointHeader_t* header;
+    checkpointSlot_t* slots;
 
-        clock->lastTick = *userTime;
-    }
+    /*Actions linked to each slot, kept in memory only*/
+    uint32_t* refs;
+};
 
-    return ret;
+static uint32_t
+checkpointSlotIndex(struct horoCheckpoint const* checkpoint,
+                    volatile uint32_t const* stamp)
+{
+    return (uint32_t)(((char const*)stamp - (char const*)checkpoint->slots) /
+                      sizeof(checkpointSlot_t));
 }
 
-HORO_ERROR
-horo_unscheduleAction(horo_clock_t* clock, int actionID)
+/*Unlinks an entry from its checkpoint slot, the slot may be dropped later*/
+static void
+detachCheckpoint(horo_clock_t* clock, horo_entry_t* entry)
 {
-    int found = 0;
-    int index = 0;
-    HORO_ERROR ret = HORO_ERROR_UNKNOWN_ACTION;
-    horoContainerNode_t *node = NULL;
-
-    RETURN_ILLEGAL_IF(clock == NULL);
+    if(entry->extra == NULL) return;
 
-    node = clock->entries.head;
-    while(node != NULL)
+    if((clock->checkpoint != NULL) && (entry->extra->checkpointStamp != NULL))
     {
-        horo_entry_t* entry = (horo_entry_t*)node->data;
-        if(entry->id == actionID)
-        {
-            found = 1;
-            break;
-        }
-        index++;
-        node = node->next;
+        clock->checkpoint->refs[checkpointSlotIndex(clock->checkpoint,
+                                                    entry->extra->checkpointStamp)]--;
     }
-    
-    if(found)
+    entry->extra->checkpointStamp = NULL;
+}
+
+static void
+releaseEntry(horo_entry_t* entry)
+{
+    if(entry->extra != NULL)
     {
-        ret = horoList_remove(&clock->entries, index);
+        free(entry->extra->stats);
+        free(entry->extra->key);
+        free(entry->extra);
+        entry->extra = NULL;
     }
-
-    return ret;
 }
 
-HORO_ERROR
-horo_actionCount(horo_clock_t* clock, int* oActionCount)
+static size_t
+entryIndex_home(horoEntryIndex_t const* index, uint64_t id)
 {
-    RETURN_ILLEGAL_IF(clock == NULL);
-    RETURN_ILLEGAL_IF(oActionCount == NULL);
-
-    *oActionCount = clock->entries.numElements;
-    return HORO_SUCCESS;
+    return (size_t)((id * 0x9E3779B97F4A7C15ULL) >> 32) & (index->capacity - 1);
 }
 
-HORO_ERROR
-horo_destroy(horo_clock_t* clock)
+static void
+entryIndex_insert(horoEntryIndex_t* index, horoContainerNode_t* node)
+{
+    size_t slot = entryIndex_home(index, ((horo_entry_t*)node->data)->id);
+
+    while(index->slots[slot] != NULL)
+    {
+        slot = (slot + 1) & (index->capacity - 1);
+    }
+    index->slots[slot] = node;
+    index->numNodes++;
+}
+
+static HORO_ERROR
+entryIndex_add(horoEntryIndex_t* index, horoContainerNode_t* node)
+{
+    //Kept at most three quarters full
+    if((index->numNodes + 1) * 4 > index->capacity * 3)
+    {
+        horoEntryIndex_t grown;
+        size_t i = 0;
+
+        grown.capacity = (index->capacity == 0) ? 16 : index->capacity * 2;
+        grown.numNodes = 0;
+        grown.slots = (horoContainerNode_t**)calloc(grown.capacity,
+                                                    sizeof(horoContainerNode_t*));
+        if(grown.slots == NULL)
+        {
+            return HORO_ERROR_NO_MEM;
+        }
+
+        for(; i < index->capacity; i++)
+        {
+            if(index->slots[i] != NULL) entryIndex_insert(&grown, index->slots[i]);
+        }
+        free(index->slots);
+        *index = grown;
+    }
+
+    entryIndex_insert(index, node);
+    return HORO_SUCCESS;
+}
+
+static horoContainerNode_t*
+entryIndex_find(horoEntryIndex_t const* index, uint64_t id)
+{
+    size_t slot = 0;
+
+    if(index->capacity == 0) return NULL;
+
+    for(slot = entryIndex_home(index, id); index->slots[slot] != NULL;
+        slot = (slot + 1) & (index->capacity - 1))
+    {
+        if(((horo_entry_t*)index->slots[slot]->data)->id == id)
+        {
+            return index->slots[slot];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Removes the node of 'entry'.  The nodes after it in its probe run are
+ * shifted back into the hole so that lookups need no tombstones.
+ */
+static void
+entryIndex_remove(horoEntryIndex_t* index, horo_entry_t const* entry)
+{
+    size_t mask = index->capacity - 1;
+    size_t slot = 0;
+    size_t next = 0;
+
+    if(index->capacity == 0) return;
+
+    for(slot = entryIndex_home(index, entry->id); index->slots[slot] != NULL;
+        slot = (slot + 1) & mask)
+    {
+        if(index->slots[slot]->data == entry) break;
+    }
+    if(index->slots[slot] == NULL) return;
+
+    for(next = (slot + 1) & mask; index->slots[next] != NULL; next = (next + 1) & mask)
+    {
+        size_t home = entryIndex_home(index, ((horo_entry_t*)index->slots[next]->data)->id);
+
+        //A node can fill the hole unless its home lies between the hole and the node
+        if(((next - home) & mask) >= ((next - slot) & mask))
+        {
+            index->slots[slot] = index->slots[next];
+            slot = next;
+        }
+    }
+
+    index->slots[slot] = NULL;
+    index->numNodes--;
+}
+
+static horoContainerNode_t*
+findEntryNode(horo_clock_t* clock, int actionID)
+{
+    horoContainerNode_t* node = NULL;
+
+    if(actionID < 0) return NULL;
+
+    node = entryIndex_find(&clock->entryIndex, (uint64_t)actionID);
+    if((node == NULL) || ((horo_entry_t*)node->data)->removed) return NULL;
+
+    return node;
+}
+
+static horo_entry_t*
+findEntry(horo_clock_t* clock, int actionID)
+{
+    horoContainerNode_t* node = findEntryNode(clock, actionID);
+
+    return (node != NULL) ? (horo_entry_t*)node->data : NULL;
+}
+
+static HORO_ERROR
+entryArray_add(horoEntryArray_t* array, horo_entry_t* entry)
+{
+    if(array->numEntries == array->capacity)
+    {
+        size_t capacity = (array->capacity == 0) ? 8 : array->capacity * 2;
+        horo_entry_t** grown = NULL;
+
+        grown = (horo_entry_t**)realloc(array->entries, capacity * sizeof(horo_entry_t*));
+        if(grown == NULL)
+        {
+            return HORO_ERROR_NO_MEM;
+        }
+        array->entries = grown;
+        array->capacity = capacity;
+    }
+
+    array->entries[array->numEntries++] = entry;
+    return HORO_SUCCESS;
+}
+
+static HORO_ERROR
+entryArray_reserve(horoEntryArray_t* array, size_t extra)
+{
+    horo_entry_t** grown = NULL;
+    size_t capacity = array->numEntries + extra;
+
+    if(capacity <= array->capacity) return HORO_SUCCESS;
+
+    grown = (horo_entry_t**)realloc(array->entries, capacity * sizeof(horo_entry_t*));
+    if(grown == NULL)
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+    array->entries = grown;
+    array->capacity = capacity;
+    return HORO_SUCCESS;
+}
+
+/*
+ * Removes the marked entries while keeping the order of the others.
+ * Returns the number of removed entries.
+ */
+static size_t
+entryArray_compact(horoEntryArray_t* array)
+{
+    size_t kept = 0;
+    size_t i = 0;
+
+    for(; i < array->numEntries; i++)
+    {
+        if(!array->entries[i]->removed)
+        {
+            array->entries[kept++] = array->entries[i];
+        }
+    }
+
+    i = array->numEntries - kept;
+    array->numEntries = kept;
+    return i;
+}
+
+/*
+ * Removes the entry at 'index' by moving the last entry into its place.
+ * Returns the moved entry so that the caller can update its position.
+ */
+static horo_entry_t*
+entryArray_swapRemove(horoEntryArray_t* array, size_t index)
+{
+    horo_entry_t* moved = array->entries[--array->numEntries];
+
+    array->entries[index] = moved;
+    return moved;
+}
+
+static void
+entryArray_remove(horoEntryArray_t* array, horo_entry_t* entry)
+{
+    size_t i = 0;
+
+    for(; i < array->numEntries; i++)
+    {
+        if(array->entries[i] == entry)
+        {
+            entryArray_swapRemove(array, i);
+            return;
+        }
+    }
+}
+
+static void
+countEntry(horoZoneGroup_t* group, horo_entry_t const* entry, int delta)
+{
+    int value = 0;
+
+    if(entry->scheduleVals.second != 0)
+    {
+        group->secondsEntries += delta;
+    }
+    for(value = 0; value < 60; value++)
+    {
+        if(entry->scheduleVals.minute & ((uint64_t)1 << value))
+        {
+            group->minuteCounts[value] += delta;
+        }
+    }
+    for(value = 0; value < 24; value++)
+    {
+        if(entry->scheduleVals.hour & ((uint64_t)1 << value))
+        {
+            group->hourCounts[value] += delta;
+        }
+    }
+    for(value = 1; value < 13; value++)
+    {
+        if(entry->scheduleVals.month & ((uint64_t)1 << value))
+        {
+            group->monthCounts[value] += delta;
+        }
+    }
+}
+
+static void
+unlinkFromGroup(horoZoneGroup_t* group, horo_entry_t* entry)
+{
+    int second = 0;
+
+    if(entry->scheduleVals.second == 0)
+    {
+        entryArray_swapRemove(&group->minuteEntries, entry->minuteIndex)->minuteIndex =
+            entry->minuteIndex;
+        return;
+    }
+
+    //An entry is in up to 60 slots, a position for each is not worth keeping
+    for(; second < SECONDS_PER_MINUTE; second++)
+    {
+        if(entry->scheduleVals.second & ((uint64_t)1 << second))
+        {
+            entryArray_remove(&group->secondsWheel[second], entry);
+        }
+    }
+}
+
+/*Removes the entries of the plan that point to 'entry'*/
+static void
+removeFromPlan(horoDayPlan_t* plan, horo_entry_t* entry)
+{
+    int hour = 0;
+    int minute = 0;
+    uint32_t i = 0;
+
+    if(!plan->valid) return;
+
+    switch(entry->planState)
+    {
+    case PLAN_DENSE:
+        entryArray_swapRemove(&plan->dense, entry->planIndex)->planIndex =
+            entry->planIndex;
+        break;
+    case PLAN_PENDING:
+        entryArray_swapRemove(&plan->pending, entry->planIndex)->planIndex =
+            entry->planIndex;
+        break;
+    case PLAN_SPARSE:
+        for(hour = 0; hour < 24; hour++)
+        {
+            if(!(entry->scheduleVals.hour & ((uint64_t)1 << hour))) continue;
+
+            for(minute = 0; minute < 60; minute++)
+            {
+                int minuteOfDay = (hour * 60) + minute;
+
+                if(!(entry->scheduleVals.minute & ((uint64_t)1 << minute))) continue;
+
+                for(i = plan->minuteStart[minuteOfDay];
+                    i < plan->minuteStart[minuteOfDay + 1]; i++)
+                {
+                    if(plan->fired[i] == entry) plan->fired[i] = NULL;
+                }
+            }
+        }
+        break;
+    }
+}
+
+static void
+removeFromGroup(horoZoneGroup_t* group, horo_entry_t* entry)
+{
+    if(entry->scheduleVals.second == 0)
+    {
+        removeFromPlan(&group->plan, entry);
+    }
+    unlinkFromGroup(group, entry);
+    countEntry(group, entry, -1);
+}
+
+static HORO_ERROR
+addToGroup(horoZoneGroup_t* group, horo_entry_t* entry)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    uint64_t seconds = entry->scheduleVals.second;
+    int second = 0;
+
+    if(seconds == 0)
+    {
+        entry->minuteIndex = (uint32_t)group->minuteEntries.numEntries;
+        err = entryArray_add(&group->minuteEntries, entry);
+        if(!err && group->plan.valid)
+        {
+            entry->planIndex = (uint32_t)group->plan.pending.numEntries;
+            err = entryArray_add(&group->plan.pending, entry);
+            if(err)
+            {
+                group->minuteEntries.numEntries--;
+                return err;
+            }
+            entry->planState = PLAN_PENDING;
+        }
+        if(err) return err;
+    }
+
+    for(; (seconds != 0) && !err; seconds >>= 1, second++)
+    {
+        if(seconds & 1)
+        {
+            err = entryArray_add(&group->secondsWheel[second], entry);
+        }
+    }
+
+    if(err)
+    {
+        unlinkFromGroup(group, entry);
+        return err;
+    }
+
+    countEntry(group, entry, 1);
+    group->entriesAdded = 1;
+    return HORO_SUCCESS;
+}
+
+/*
+ * Grows the arrays of 'group' that 'scheduleVals' goes into by 'extra'
+ * entries.  The plan's pending array is grown even without a plan, a plan
+ * can be built before a deferred reschedule is applied.
+ */
+static HORO_ERROR
+reserveSchedule(horoZoneGroup_t* group, PackedCronVals const* scheduleVals,
+                size_t extra)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    uint64_t seconds = scheduleVals->second;
+    int second = 0;
+
+    if(seconds == 0)
+    {
+        err = entryArray_reserve(&group->minuteEntries, extra);
+        if(!err)
+        {
+            err = entryArray_reserve(&group->plan.pending, extra);
+        }
+    }
+    for(; (seconds != 0) && !err; seconds >>= 1, second++)
+    {
+        if(seconds & 1)
+        {
+            err = entryArray_reserve(&group->secondsWheel[second], extra);
+        }
+    }
+    return err;
+}
+
+/*
+ * Swaps the schedule of an entry that is in 'group'.  The arrays the new
+ * schedule goes into are grown first, so the entry is never left out of its
+ * group.
+ */
+static HORO_ERROR
+swapSchedule(horoZoneGroup_t* group, horo_entry_t* entry,
+             PackedCronVals const* scheduleVals)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+
+    err = reserveSchedule(group, scheduleVals, 1);
+    if(err) return err;
+
+    removeFromGroup(group, entry);
+    entry->scheduleVals = *scheduleVals;
+    entry->matchStamp = 0;
+    entry->minuteMatch = 0;
+    entry->planState = PLAN_NOT_TODAY;
+    return addToGroup(group, entry);
+}
+
+static void
+clearGroup(horoZoneGroup_t* group)
+{
+    int second = 0;
+
+    free(group->minuteEntries.entries);
+    for(; second < SECONDS_PER_MINUTE; second++)
+    {
+        free(group->secondsWheel[second].entries);
+    }
+
+    memset(&group->minuteEntries, 0, sizeof(group->minuteEntries));
+    memset(group->secondsWheel, 0, sizeof(group->secondsWheel));
+    memset(group->minuteCounts, 0, sizeof(group->minuteCounts));
+    memset(group->hourCounts, 0, sizeof(group->hourCounts));
+    memset(group->monthCounts, 0, sizeof(group->monthCounts));
+    group->secondsEntries = 0;
+    group->minuteRemovals = 0;
+    group->secondsRemovals = 0;
+
+    free(group->plan.fired);
+    free(group->plan.dense.entries);
+    free(group->plan.pending.entries);
+    memset(&group->plan, 0, sizeof(group->plan));
+}
+
+/*
+ * Finds the group of a zone, loading the zone the first time it is used.
+ * A NULL zone name is the local group.
+ */
+static HORO_ERROR
+findGroup(horo_clock_t* clock, const char* zoneName, size_t* oGroup)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    horoZoneGroup_t** groups = NULL;
+    horoZoneGroup_t* group = NULL;
+    horoZone_t* zone = NULL;
+    size_t i = 0;
+
+    if(zoneName == NULL)
+    {
+        *oGroup = LOCAL_GROUP;
+        return HORO_SUCCESS;
+    }
+
+    for(i = LOCAL_GROUP + 1; i < clock->numGroups; i++)
+    {
+        if(strcmp(clock->groups[i]->zone->name, zoneName) == 0)
+        {
+            *oGroup = i;
+            return HORO_SUCCESS;
+        }
+    }
+
+    //horo_entry::group is 16 bits
+    if(clock->numGroups > UINT16_MAX) return HORO_ERROR_NO_MEM;
+
+    err = horoZone_load(zoneName, &zone);
+    if(err == HORO_ERROR_IO) return HORO_ERROR_UNKNOWN_ZONE;
+    if(err) return err;
+
+    group = (horoZoneGroup_t*)calloc(1, sizeof(horoZoneGroup_t));
+    groups = (horoZoneGroup_t**)realloc(clock->groups,
+                                        (clock->numGroups + 1) * sizeof(horoZoneGroup_t*));
+    if(groups != NULL)
+    {
+        clock->groups = groups;
+    }
+    if((group == NULL) || (groups == NULL))
+    {
+        free(group);
+        horoZone_free(zone);
+        return HORO_ERROR_NO_MEM;
+    }
+
+    group->zone = zone;
+    groups[clock->numGroups] = group;
+    *oGroup = clock->numGroups++;
+
+    return HORO_SUCCESS;
+}
+
+/*
+ * Marks an entry for removal and notes which arrays of its group hold it, so
+ * that only those are compacted
+ */
+static void
+markRemoved(horo_clock_t* clock, horo_entry_t* entry)
+{
+    horoZoneGroup_t* group = clock->groups[entry->group];
+
+    entry->removed = 1;
+    if(entry->scheduleVals.second == 0)
+    {
+        group->minuteRemovals = 1;
+    }
+    group->secondsRemovals |= entry->scheduleVals.second;
+}
+
+static int
+releaseIfRemoved(void* data, void* userp)
+{
+    horo_entry_t* entry = (horo_entry_t*)data;
+    horo_clock_t* clock = (horo_clock_t*)userp;
+
+    if(!entry->removed) return 0;
+
+    countEntry(clock->groups[entry->group], entry, -1);
+    entryIndex_remove(&clock->entryIndex, entry);
+    detachCheckpoint(clock, entry);
+    releaseEntry(entry);
+    return 1;
+}
+
+/*
+ * Takes the entries marked 'removed' out of the group arrays markRemoved()
+ * noted, with one compaction pass over each.  Day plans that lost entries
+ * are rebuilt on their next tick.
+ */
+static void
+compactGroups(horo_clock_t* clock)
+{
+    size_t i = 0;
+    size_t j = 0;
+    int second = 0;
+
+    for(i = 0; i < clock->numGroups; i++)
+    {
+        horoZoneGroup_t* group = clock->groups[i];
+        uint64_t seconds = group->secondsRemovals;
+
+        if(group->minuteRemovals &&
+           (entryArray_compact(&group->minuteEntries) > 0))
+        {
+            group->plan.valid = 0;
+            for(j = 0; j < group->minuteEntries.numEntries; j++)
+            {
+                group->minuteEntries.entries[j]->minuteIndex = (uint32_t)j;
+            }
+        }
+        for(second = 0; seconds != 0; seconds >>= 1, second++)
+        {
+            if(seconds & 1) entryArray_compact(&group->secondsWheel[second]);
+        }
+
+        group->minuteRemovals = 0;
+        group->secondsRemovals = 0;
+    }
+}
+
+/*Removes every entry marked 'removed' with one walk of the entry list*/
+static void
+removeMarkedEntries(horo_clock_t* clock)
+{
+    compactGroups(clock);
+    horoList_removeEach(&clock->entries, releaseIfRemoved, clock);
+}
+
+/*
+ * Removes the marked entries, unless actions are running in which case the
+ * removal waits for the end of the tick.
+ */
+static void
+commitRemovals(horo_clock_t* clock)
+{
+    if(clock->processing)
+    {
+        clock->removalsPending = 1;
+        return;
+    }
+
+    removeMarkedEntries(clock);
+}
+
+/*Applies what the actions of a tick scheduled, rescheduled and unscheduled*/
+static void
+applyDeferredOps(horo_clock_t* clock)
+{
+    size_t i = 0;
+
+    //Cannot fail, deferReschedule() grew the arrays
+    for(; i < clock->numDeferredReschedules; i++)
+    {
+        horoReschedule_t* reschedule = &clock->deferredReschedules[i];
+        horo_entry_t* entry = reschedule->entry;
+
+        if(entry->removed) continue;
+        swapSchedule(clock->groups[entry->group], entry, &reschedule->scheduleVals);
+    }
+    clock->numDeferredReschedules = 0;
+
+    for(i = 0; i < clock->deferredAdds.numEntries; i++)
+    {
+        clock->deferredAdds.entries[i]->deferred = 0;
+    }
+    clock->deferredAdds.numEntries = 0;
+
+    if(clock->removalsPending)
+    {
+        clock->removalsPending = 0;
+        removeMarkedEntries(clock);
+    }
+}
+
+/*
+ * Adds a fully initialized entry to the clock and to its group.  The entry
+ * is copied, the copy is returned through 'oEntry'.
+ */
+static HORO_ERROR
+addEntry(horo_clock_t* clock, horo_entry_t const* newEntry, horo_entry_t** oEntry)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    horoContainerNode_t* node = NULL;
+    horo_entry_t* entry = NULL;
+
+    err = horoList_add(&clock->entries, newEntry, sizeof(*newEntry));
+    if(err) return err;
+
+    node = clock->entries.tail;
+    entry = (horo_entry_t*)node->data;
+    err = entryIndex_add(&clock->entryIndex, node);
+    if(err)
+    {
+        horoList_removeNode(&clock->entries, node);
+        return err;
+    }
+
+    err = addToGroup(clock->groups[entry->group], entry);
+    if(err)
+    {
+        entryIndex_remove(&clock->entryIndex, entry);
+        horoList_removeNode(&clock->entries, node);
+        return err;
+    }
+
+    if(oEntry != NULL) *oEntry = entry;
+    return HORO_SUCCESS;
+}
+
+/*Parses a schedule, reporting it to the trace hooks*/
+static HORO_ERROR
+parseSchedule(horo_clock_t* clock, const char *scheduleString,
+              size_t scheduleLength, PackedCronVals* oScheduleVals)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    CronVals cronVals;
+
+    if(clock->traceBegin != NULL)
+    {
+        callTraceHook(clock, clock->traceBegin, HORO_TRACE_PARSE, NULL, NULL,
+                      scheduleString, scheduleLength, NULL, HORO_SUCCESS);
+    }
+
+    err = parseCronString(scheduleString, scheduleLength, &cronVals, NULL);
+
+    if(clock->traceEnd != NULL)
+    {
+        callTraceHook(clock, clock->traceEnd, HORO_TRACE_PARSE, NULL, NULL,
+                      scheduleString, scheduleLength, &cronVals, err);
+    }
+    if(!err)
+    {
+        packCronVals(&cronVals, oScheduleVals);
+    }
+
+    return err;
+}
+
+/*
+ * Parses a schedule and fills in a new entry, everything but its id.  The
+ * entry is not added to the clock.
+ */
+static HORO_ERROR
+prepareEntry(horo_clock_t* clock, const char *scheduleString,
+             size_t scheduleLength, const char* zoneName, horo_actionFunc action,
+             void *actionData, horo_entry_t* oEntry)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    size_t group = LOCAL_GROUP;
+
+    RETURN_ILLEGAL_IF(scheduleString == NULL);
+    RETURN_ILLEGAL_IF(action == NULL);
+
+    err = parseSchedule(clock, scheduleString, scheduleLength,
+                        &oEntry->scheduleVals);
+    if(err) goto DONE;
+
+    err = findGroup(clock, zoneName, &group);
+    if(err) goto DONE;
+        
+    oEntry->lastRunStamp = 0;
+    
+    oEntry->action = action;
+    oEntry->actionData = actionData;
+    oEntry->extra = NULL;
+    oEntry->matchStamp = 0;
+    oEntry->minuteMatch = 0;
+    oEntry->group = (uint16_t)group;
+    oEntry->dstPolicy = HORO_DST_RUN_ONCE;
+    oEntry->lastRunRepeated = 0;
+    oEntry->planState = PLAN_NOT_TODAY;
+    oEntry->removed = 0;
+    oEntry->deferred = 0;
+    oEntry->oneShot = 0;
+    oEntry->disabled = 0;
+    oEntry->limitGroup = 0;
+    oEntry->priority = 0;
+    oEntry->queued = 0;
+DONE:
+    return err;
+}
+
+static HORO_ERROR
+scheduleInZone(horo_clock_t* clock, const char *scheduleString,
+               size_t scheduleLength, const char* zoneName, horo_actionFunc action,
+               void *actionData, int* oActionID)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_entry_t newEntry;
+    horo_entry_t* entry = NULL;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(oActionID == NULL);
+
+    err = prepareEntry(clock, scheduleString, scheduleLength, zoneName,
+                       action, actionData, &newEntry);
+    if(err) goto DONE;
+
+    newEntry.id = clock->nextActionID++;
+    newEntry.deferred = (clock->processing != 0);
+    err = addEntry(clock, &newEntry, &entry);
+    if(err) goto DONE;
+
+    if(entry->deferred)
+    {
+        err = entryArray_add(&clock->deferredAdds, entry);
+        if(err)
+        {
+            markRemoved(clock, entry);
+            commitRemovals(clock);
+            goto DONE;
+        }
+    }
+
+    *oActionID = newEntry.id;
+DONE:
+    return err;
+}
+
+HORO_ERROR
+horo_scheduleAction(horo_clock_t* clock, const char *scheduleString, 
+                     horo_actionFunc action, void *actionData,
+                     int* oActionID)
+{
+    RETURN_ILLEGAL_IF(scheduleString == NULL);
+
+    return scheduleInZone(clock, scheduleString, strlen(scheduleString), NULL,
+                          action, actionData, oActionID);
+}
+
+HORO_ERROR
+horo_scheduleActionN(horo_clock_t* clock, const char *scheduleString,
+                     size_t scheduleLength, horo_actionFunc action,
+                     void *actionData, int* oActionID)
+{
+    return scheduleInZone(clock, scheduleString, scheduleLength, NULL,
+                          action, actionData, oActionID);
+}
+
+HORO_ERROR
+horo_scheduleActionInZone(horo_clock_t* clock, const char *scheduleString,
+                          const char* zoneName, horo_actionFunc action,
+                          void *actionData, int* oActionID)
+{
+    RETURN_ILLEGAL_IF(scheduleString == NULL);
+    RETURN_ILLEGAL_IF(zoneName == NULL);
+
+    return scheduleInZone(clock, scheduleString, strlen(scheduleString),
+                          zoneName, action, actionData, oActionID);
+}
+
+HORO_ERROR
+horo_scheduleActionInZoneN(horo_clock_t* clock, const char *scheduleString,
+                           size_t scheduleLength, const char* zoneName,
+                           horo_actionFunc action, void *actionData,
+                           int* oActionID)
+{
+    RETURN_ILLEGAL_IF(zoneName == NULL);
+
+    return scheduleInZone(clock, scheduleString, scheduleLength, zoneName,
+                          action, actionData, oActionID);
+}
+
+/*
+ * Grows the arrays of the groups a batch of entries goes into, so that
+ * adding them does not reallocate once per entry.  Day plans that would get
+ * more pending entries than they keep are dropped and rebuilt on their next
+ * tick instead.
+ */
+static HORO_ERROR
+reserveForEntries(horo_clock_t* clock, horo_entry_t const* entries,
+                  size_t numEntries)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    size_t const row = SECONDS_PER_MINUTE + 1;
+    size_t* counts = NULL;
+    size_t i = 0;
+    int second = 0;
+
+    //A row per group, the minute entries and then the entries of each second
+    counts = (size_t*)calloc(clock->numGroups * row, sizeof(size_t));
+    if(counts == NULL)
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+
+    for(i = 0; i < numEntries; i++)
+    {
+        size_t* groupCounts = &counts[entries[i].group * row];
+        uint64_t seconds = entries[i].scheduleVals.second;
+
+        if(seconds == 0) groupCounts[0]++;
+        for(second = 0; seconds != 0; seconds >>= 1, second++)
+        {
+            if(seconds & 1) groupCounts[1 + second]++;
+        }
+    }
+
+    for(i = 0; (i < clock->numGroups) && !err; i++)
+    {
+        horoZoneGroup_t* group = clock->groups[i];
+        size_t* groupCounts = &counts[i * row];
+
+        if(groupCounts[0] > 0)
+        {
+            err = entryArray_reserve(&group->minuteEntries, groupCounts[0]);
+            if(group->plan.valid && !err)
+            {
+                if(group->plan.pending.numEntries + groupCounts[0] > PLAN_MAX_PENDING)
+                {
+                    group->plan.valid = 0;
+                }
+                else
+                {
+                    err = entryArray_reserve(&group->plan.pending, groupCounts[0]);
+                }
+            }
+        }
+
+        for(second = 0; (second < SECONDS_PER_MINUTE) && !err; second++)
+        {
+            if(groupCounts[1 + second] > 0)
+            {
+                err = entryArray_reserve(&group->secondsWheel[second],
+                                         groupCounts[1 + second]);
+            }
+        }
+    }
+
+    free(counts);
+    return err;
+}
+
+HORO_ERROR
+horo_scheduleActions(horo_clock_t* clock, horo_schedule_req_t const* reqs,
+                     size_t numReqs, int* oActionIDs, HORO_ERROR* oErrors)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_entry_t* newEntries = NULL;
+    horoContainerNode_t* node = NULL;
+    uint64_t firstID = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF((numReqs > 0) && ((reqs == NULL) || (oActionIDs == NULL)));
+    if(numReqs == 0) return HORO_SUCCESS;
+
+    newEntries = (horo_entry_t*)malloc(numReqs * sizeof(horo_entry_t));
+    if(newEntries == NULL)
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+
+    for(i = 0; i < numReqs; i++)
+    {
+        const char* scheduleString = reqs[i].scheduleString;
+        size_t length = (scheduleString != NULL) ? strlen(scheduleString) : 0;
+
+        err = prepareEntry(clock, scheduleString, length, reqs[i].zoneName,
+                           reqs[i].action, reqs[i].actionData, &newEntries[i]);
+        if(oErrors != NULL) oErrors[i] = err;
+        if(err && !ret) ret = err;
+    }
+    if(ret) goto DONE;
+
+    ret = reserveForEntries(clock, newEntries, numReqs);
+    if(!ret && clock->processing)
+    {
+        ret = entryArray_reserve(&clock->deferredAdds, numReqs);
+    }
+    if(ret) goto DONE;
+
+    firstID = clock->nextActionID;
+    for(i = 0; i < numReqs; i++)
+    {
+        horo_entry_t* entry = NULL;
+
+        newEntries[i].id = firstID + i;
+        newEntries[i].deferred = (clock->processing != 0);
+        ret = addEntry(clock, &newEntries[i], &entry);
+        if(ret) break;
+
+        if(entry->deferred) entryArray_add(&clock->deferredAdds, entry);
+    }
+
+    //The ids are used up either way, a removed entry keeps its id until the tick ends
+    clock->nextActionID = firstID + numReqs;
+
+    if(ret)
+    {
+        if(oErrors != NULL) oErrors[i] = ret;
+
+        for(j = 0; j < i; j++)
+        {
+            markRemoved(clock, findEntry(clock, (int)(firstID + j)));
+        }
+        if(clock->processing)
+        {
+            clock->removalsPending = 1;
+            goto DONE;
+        }
+
+        compactGroups(clock);
+        for(j = 0; j < i; j++)
+        {
+            node = entryIndex_find(&clock->entryIndex, firstID + j);
+            releaseIfRemoved(node->data, clock);
+            horoList_removeNode(&clock->entries, node);
+        }
+        goto DONE;
+    }
+
+    for(i = 0; i < numReqs; i++)
+    {
+        oActionIDs[i] = (int)(firstID + i);
+    }
+
+DONE:
+    free(newEntries);
+    return ret;
+}
+
+typedef struct
+{
+    int64_t id;
+    size_t index;
+    horoContainerNode_t* node;
+}unscheduleItem_t;
+
+static int
+compareUnscheduleItems(const void* a, const void* b)
+{
+    unscheduleItem_t const* itemA = (unscheduleItem_t const*)a;
+    unscheduleItem_t const* itemB = (unscheduleItem_t const*)b;
+
+    if(itemA->id != itemB->id) return (itemA->id < itemB->id) ? -1 : 1;
+    if(itemA->index != itemB->index) return (itemA->index < itemB->index) ? -1 : 1;
+    return 0;
+}
+
+HORO_ERROR
+horo_unscheduleActions(horo_clock_t* clock, const int* actionIDs, size_t numIDs,
+                       HORO_ERROR* oErrors)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    unscheduleItem_t* items = NULL;
+    size_t failedIndex = numIDs;
+    size_t i = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF((numIDs > 0) && (actionIDs == NULL));
+    if(numIDs == 0) return HORO_SUCCESS;
+
+    items = (unscheduleItem_t*)malloc(numIDs * sizeof(unscheduleItem_t));
+    if(items == NULL)
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+
+    for(i = 0; i < numIDs; i++)
+    {
+        items[i].id = actionIDs[i];
+        items[i].index = i;
+        items[i].node = NULL;
+    }
+    qsort(items, numIDs, sizeof(unscheduleItem_t), compareUnscheduleItems);
+
+    //The first of equal ids reports whether the id was found, the others are duplicates
+    for(i = 0; i < numIDs; i++)
+    {
+        HORO_ERROR err = HORO_SUCCESS;
+
+        if((i > 0) && (items[i - 1].id == items[i].id))
+        {
+            err = HORO_ERROR_ILLEGAL_ARG;
+        }
+        else
+        {
+            horoContainerNode_t* node = findEntryNode(clock, (int)items[i].id);
+
+            //Unscheduled by an action earlier in this tick
+            if((node != NULL) && ((horo_entry_t*)node->data)->removed) node = NULL;
+            items[i].node = node;
+            if(node == NULL) err = HORO_ERROR_UNKNOWN_ACTION;
+        }
+
+        if(oErrors != NULL) oErrors[items[i].index] = err;
+        if(err && (items[i].index < failedIndex))
+        {
+            failedIndex = items[i].index;
+            ret = err;
+        }
+    }
+
+    if(ret) goto DONE;
+
+    //Only the first of equal ids has its node
+    for(i = 0; i < numIDs; i++)
+    {
+        if(items[i].node != NULL)
+        {
+            markRemoved(clock, (horo_entry_t*)items[i].node->data);
+        }
+    }
+
+    if(clock->processing)
+    {
+        clock->removalsPending = 1;
+        goto DONE;
+    }
+
+    //Only the marked groups are compacted, the nodes are known
+    compactGroups(clock);
+    for(i = 0; i < numIDs; i++)
+    {
+        if(items[i].node == NULL) continue;
+
+        releaseIfRemoved(items[i].node->data, clock);
+        horoList_removeNode(&clock->entries, items[i].node);
+    }
+
+DONE:
+
+    free(items);
+    return ret;
+}
+
+/*Returns the index + 1 of the group in horo_clock::limitGroups, 0 if unknown*/
+static size_t
+findLimitGroup(horo_clock_t* clock, int groupID)
+{
+    size_t i = 0;
+
+    for(; i < clock->numLimitGroups; i++)
+    {
+        if(clock->limitGroups[i]->id == groupID) return i + 1;
+    }
+    return 0;
+}
+
+static HORO_ERROR
+groupQueue_push(horoGroupQueue_t* queue, int id)
+{
+    if(queue->count == queue->capacity)
+    {
+        size_t capacity = (queue->capacity == 0) ? 16 : queue->capacity * 2;
+        int* grown = (int*)malloc(capacity * sizeof(int));
+        size_t i = 0;
+
+        if(grown == NULL)
+        {
+            return HORO_ERROR_NO_MEM;
+        }
+        for(; i < queue->count; i++)
+        {
+            grown[i] = queue->ids[(queue->head + i) % queue->capacity];
+        }
+        free(queue->ids);
+        queue->ids = grown;
+        queue->head = 0;
+        queue->capacity = capacity;
+    }
+
+    queue->ids[(queue->head + queue->count) % queue->capacity] = id;
+    queue->count++;
+    return HORO_SUCCESS;
+}
+
+static int
+groupQueue_popFront(horoGroupQueue_t* queue)
+{
+    int id = queue->ids[queue->head];
+
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    return id;
+}
+
+static int
+groupQueue_popBack(horoGroupQueue_t* queue)
+{
+    queue->count--;
+    return queue->ids[(queue->head + queue->count) % queue->capacity];
+}
+
+/*A queued run that is given up, a one-shot action is done with it*/
+static void
+dropQueued(horo_clock_t* clock, horoLimitGroup_t* group, int id)
+{
+    horo_entry_t* entry = findEntry(clock, id);
+
+    group->numPending--;
+    group->stats.dropped++;
+    if((entry == NULL) || !entry->queued) return;
+
+    entry->queued = 0;
+    if(entry->oneShot)
+    {
+        markRemoved(clock, entry);
+        commitRemovals(clock);
+    }
+}
+
+/*Takes the queued run of an entry out of its group's queue*/
+static void
+unqueueEntry(horo_clock_t* clock, horo_entry_t* entry)
+{
+    horoLimitGroup_t* group = clock->limitGroups[entry->limitGroup - 1];
+    int level = 0;
+    size_t i = 0;
+
+    for(; level <= HORO_GROUP_MAX_PRIORITY; level++)
+    {
+        horoGroupQueue_t* queue = &group->levels[level];
+
+        for(i = 0; i < queue->count; i++)
+        {
+            if(queue->ids[(queue->head + i) % queue->capacity] != (int)entry->id)
+            {
+                continue;
+            }
+
+            for(i++; i < queue->count; i++)
+            {
+                queue->ids[(queue->head + i - 1) % queue->capacity] =
+                    queue->ids[(queue->head + i) % queue->capacity];
+            }
+            queue->count--;
+            group->numPending--;
+            entry->queued = 0;
+            return;
+        }
+    }
+}
+
+/*
+ * Queues a fire of a grouped action.  The queue may hold maxPending runs
+ * plus one for every free slot, the overflow policy picks what is dropped.
+ */
+static void
+queueFire(horo_clock_t* clock, horo_entry_t* entry)
+{
+    horoLimitGroup_t* group = clock->limitGroups[entry->limitGroup - 1];
+    int level = (group->limits.order == HORO_GROUP_PRIORITY) ? entry->priority : 0;
+    int freeSlots = group->limits.maxInFlight - group->stats.inFlight;
+    int lowest = 0;
+
+    if(entry->queued)
+    {
+        group->stats.dropped++;
+        return;
+    }
+
+    if(freeSlots < 0) freeSlots = 0;
+    if(group->numPending >= freeSlots)
+    {
+        group->stats.queued++;
+    }
+
+    if(group->numPending >= group->limits.maxPending + freeSlots)
+    {
+        while((lowest <= HORO_GROUP_MAX_PRIORITY) &&
+              (group->levels[lowest].count == 0))
+        {
+            lowest++;
+        }
+
+        //The new run is the only candidate, or the newest one
+        if((lowest > level) ||
+           ((lowest == level) && (group->limits.overflow == HORO_GROUP_DROP_NEWEST)))
+        {
+            group->stats.dropped++;
+            return;
+        }
+
+        dropQueued(clock, group,
+                   (group->limits.overflow == HORO_GROUP_DROP_OLDEST) ?
+                   groupQueue_popFront(&group->levels[lowest]) :
+                   groupQueue_popBack(&group->levels[lowest]));
+    }
+
+    if(groupQueue_push(&group->levels[level], (int)entry->id) != HORO_SUCCESS)
+    {
+        group->stats.dropped++;
+        return;
+    }
+    group->numPending++;
+    entry->queued = 1;
+}
+
+/*Calls queued actions of a group while it has free slots*/
+static int
+dispatchQueued(horo_clock_t* clock, horoLimitGroup_t* group,
+               horo_time_t const* userTime)
+{
+    horo_entry_t* entry = NULL;
+    int dispatched = 0;
+    int level = HORO_GROUP_MAX_PRIORITY;
+    int id = 0;
+
+    while((group->numPending > 0) &&
+          (group->stats.inFlight < group->limits.maxInFlight))
+    {
+        while(group->levels[level].count == 0) level--;
+
+        id = groupQueue_popFront(&group->levels[level]);
+        group->numPending--;
+
+        //Unscheduled or paused while it waited
+        entry = findEntry(clock, id);
+        if((entry == NULL) || !entry->queued) continue;
+        entry->queued = 0;
+        if(entry->removed || entry->disabled) continue;
+
+        //The run stands for the last time the entry was due
+        if(ENTRY_CHECKPOINT(entry) != NULL)
+        {
+            *entry->extra->checkpointStamp = entry->lastRunStamp;
+        }
+        group->stats.inFlight++;
+        group->stats.dispatched++;
+        dispatchEntry(clock, entry, userTime);
+        dispatched = 1;
+
+        if(entry->oneShot)
+        {
+            markRemoved(clock, entry);
+            clock->removalsPending = 1;
+        }
+    }
+
+    return dispatched;
+}
+
+/*
+ * Runs queued actions until no group has both a queued action and a free
+ * slot.  An action may free slots of a group that was already drained, so
+ * the groups are walked again.
+ */
+static void
+drainLimitGroups(horo_clock_t* clock, horo_time_t const* userTime)
+{
+    size_t i = 0;
+    int dispatched = 0;
+
+    do
+    {
+        dispatched = 0;
+        for(i = 0; i < clock->numLimitGroups; i++)
+        {
+            dispatched |= dispatchQueued(clock, clock->limitGroups[i], userTime);
+        }
+    }while(dispatched);
+}
+
+typedef struct
+{
+    horo_clock_t* clock;
+    horo_time_t const* userTime;
+
+    /*The tick is in the hour repeated after falling back*/
+    int repeated;
+}checkEntryData_t;
+
+/*
+ * Calls an entry or queues it in its group.  'stamp' goes to the checkpoint
+ * when the entry is called, a queued run is checkpointed by dispatchQueued().
+ */
+static void
+fireEntry(horo_clock_t* clock, horo_entry_t* entry, horo_time_t const* userTime,
+          uint32_t stamp)
+{
+    if(entry->limitGroup != 0)
+    {
+        queueFire(clock, entry);
+    }
+    else
+    {
+        if(ENTRY_CHECKPOINT(entry) != NULL)
+        {
+            *entry->extra->checkpointStamp = stamp;
+        }
+        dispatchEntry(clock, entry, userTime);
+    }
+
+    //A queued one-shot action is removed once it ran or was dropped
+    if(entry->oneShot && !entry->queued)
+    {
+        markRemoved(clock, entry);
+        clock->removalsPending = 1;
+    }
+}
+
+/*
+ * Runs an entry whose schedule matches 'userTime' unless it already ran at
+ * that wall clock time.  In the repeated hour after falling back only
+ * HORO_DST_RUN_TWICE entries run, the time they ran before the fall back
+ * does not count.
+ */
+static void
+runIfDue(horo_clock_t* clock, horo_entry_t* entry, horo_time_t const* userTime,
+         int compareSecond, int repeated)
+{
+    uint32_t stamp = packRuntime(userTime);
+    int sameTime = compareSecond ? (entry->lastRunStamp == stamp) :
+        (RUNTIME_STAMP_MINUTE(entry->lastRunStamp) == RUNTIME_STAMP_MINUTE(stamp));
+
+    if(entry->removed || entry->deferred || entry->disabled) return;
+
+    if(repeated)
+    {
+        if(entry->dstPolicy != HORO_DST_RUN_TWICE) return;
+        if(sameTime && entry->lastRunRepeated) return;
+    }
+    else if(sameTime)
+    {
+        return;
+    }
+
+    fireEntry(clock, entry, userTime, stamp);
+    entry->lastRunStamp = stamp;
+    entry->lastRunRepeated = (repeated != 0);
+}
+
+static HORO_ERROR
+checkEachEntry(horo_entry_t* entry, checkEntryData_t* checkEntryData)
+{
+    horo_time_t const* userTime = checkEntryData->userTime;
+    
+    if(matchPackedCronVals(&entry->scheduleVals, userTime))
+    {
+        runIfDue(checkEntryData->clock, entry, userTime, 0,
+                 checkEntryData->repeated);
+    }
+
+    return HORO_SUCCESS;
+}
+
+static void
+checkWheelSlot(horo_clock_t* clock, horoEntryArray_t const* slot,
+               horo_time_t const* userTime, uint32_t minuteStamp, int repeated)
+{
+    size_t i = 0;
+
+    for(; i < slot->numEntries; i++)
+    {
+        horo_entry_t* entry = slot->entries[i];
+
+        if(entry->matchStamp != minuteStamp)
+        {
+            entry->minuteMatch = (matchPackedCronVals(&entry->scheduleVals, userTime) != 0);
+            entry->matchStamp = minuteStamp;
+        }
+        if(!entry->minuteMatch) continue;
+
+        runIfDue(clock, entry, userTime, 1, repeated);
+    }
+}
+
+/*
+ * Runs a HORO_DST_RUN_ONCE entry once if its schedule matches any of the
+ * wall clock minutes skipped when its zone sprang forward 'shift' seconds
+ * at 'at'.  'offset' is the zone's offset before the jump.
+ */
+static void
+runSkippedMinutes(horo_clock_t* clock, horo_entry_t* entry, int64_t at,
+                  int32_t offset, int32_t shift, horo_time_t const* userTime)
+{
+    int64_t skipped = 0;
+
+    if((entry->dstPolicy != HORO_DST_RUN_ONCE) || entry->removed ||
+       entry->deferred || entry->disabled) return;
+
+    for(; skipped < shift; skipped += SECONDS_PER_MINUTE)
+    {
+        horo_time_t skippedTime;
+
+        horoZone_breakDownOffset(at + skipped, offset, &skippedTime);
+        if(matchPackedCronVals(&entry->scheduleVals, &skippedTime))
+        {
+            //The run stands for the skipped time, a match of the tick still runs
+            uint32_t stamp = packRuntime(&skippedTime);
+
+            fireEntry(clock, entry, userTime, stamp);
+            entry->lastRunStamp = stamp;
+            entry->lastRunRepeated = 0;
+            return;
+        }
+    }
+}
+
+/*
+ * Looks up the transition of a zone group's tick.  The first tick after the
+ * wall clock sprang forward runs the entries that missed their time.
+ * Returns nonzero while the wall clock repeats the times it showed before
+ * falling back.
+ */
+static int
+checkZoneTransition(horo_clock_t* clock, horoZoneGroup_t* group, int64_t utc,
+                    horo_time_t const* zoneTime)
+{
+    horoZone_t* zone = group->zone;
+    size_t index = horoZone_find(zone, utc);
+    int64_t at = zone->transitions[index].at;
+    int32_t shift = horoZone_shift(zone, index);
+    int crossed = group->haveLastUtc && (group->lastUtc < at);
+    size_t i = 0;
+    int second = 0;
+
+    group->lastUtc = utc;
+    group->haveLastUtc = 1;
+
+    if((shift > 0) && crossed)
+    {
+        int32_t offset = zone->transitions[index - 1].offset;
+
+        for(i = 0; i < group->minuteEntries.numEntries; i++)
+        {
+            runSkippedMinutes(clock, group->minuteEntries.entries[i], at, offset,
+                              shift, zoneTime);
+        }
+
+        //Entries with seconds are in several slots, visit them in their first
+        for(second = 0; second < SECONDS_PER_MINUTE; second++)
+        {
+            horoEntryArray_t const* slot = &group->secondsWheel[second];
+
+            for(i = 0; i < slot->numEntries; i++)
+            {
+                horo_entry_t* entry = slot->entries[i];
+
+                if((entry->scheduleVals.second & (((uint64_t)1 << second) - 1)) == 0)
+                {
+                    runSkippedMinutes(clock, entry, at, offset, shift, zoneTime);
+                }
+            }
+        }
+    }
+
+    return (shift < 0) && (utc < at - shift);
+}
+
+static int
+lowestBit(uint64_t value)
+{
+    int bit = 0;
+    while(!(value & 1))
+    {
+        value >>= 1;
+        bit++;
+    }
+    return bit;
+}
+
+static uint32_t
+countBits(uint64_t mask)
+{
+    uint32_t bits = 0;
+
+    for(; mask != 0; mask &= mask - 1)
+    {
+        bits++;
+    }
+    return bits;
+}
+
+/*
+ * Builds the plan of a group for the day of 'userTime'.  If memory runs out
+ * the plan stays invalid and the group's entries are checked one by one.
+ */
+static void
+buildDayPlan(horoZoneGroup_t* group, horo_time_t const* userTime)
+{
+    horoDayPlan_t* plan = &group->plan;
+    uint32_t fill[MINUTES_PER_DAY];
+    uint64_t const minuteBits = ((uint64_t)1 << 60) - 1;
+    uint64_t const hourBits = ((uint64_t)1 << 24) - 1;
+    size_t numFired = 0;
+    size_t i = 0;
+    int minuteOfDay = 0;
+
+    plan->valid = 0;
+    plan->dense.numEntries = 0;
+    plan->pending.numEntries = 0;
+    memset(plan->minuteStart, 0, sizeof(plan->minuteStart));
+
+    //Count the fires of every minute of the day, minuteStart is shifted by one
+    for(i = 0; i < group->minuteEntries.numEntries; i++)
+    {
+        horo_entry_t* entry = group->minuteEntries.entries[i];
+        uint64_t minutes = entry->scheduleVals.minute & minuteBits;
+        uint64_t hours = entry->scheduleVals.hour & hourBits;
+
+        entry->planState = PLAN_NOT_TODAY;
+        if(!(entry->scheduleVals.month & ((uint64_t)1 << userTime->month)) ||
+           !checkPackedDOMWithDOW(&entry->scheduleVals, userTime))
+        {
+            continue;
+        }
+
+        if((countBits(minutes) * countBits(hours)) > PLAN_DENSE_FIRES)
+        {
+            entry->planIndex = (uint32_t)plan->dense.numEntries;
+            if(entryArray_add(&plan->dense, entry)) return;
+            entry->planState = PLAN_DENSE;
+            continue;
+        }
+
+        entry->planState = PLAN_SPARSE;
+        for(; hours != 0; hours &= hours - 1)
+        {
+            uint64_t minute = minutes;
+
+            for(; minute != 0; minute &= minute - 1)
+            {
+                plan->minuteStart[(lowestBit(hours) * 60) + lowestBit(minute) + 1]++;
+                numFired++;
+            }
+        }
+    }
+
+    if(numFired > plan->firedCapacity)
+    {
+        horo_entry_t** fired = (horo_entry_t**)realloc(plan->fired,
+                                                       numFired * sizeof(horo_entry_t*));
+        if(fired == NULL) return;
+
+        plan->fired = fired;
+        plan->firedCapacity = numFired;
+    }
+
+    for(minuteOfDay = 0; minuteOfDay < MINUTES_PER_DAY; minuteOfDay++)
+    {
+        plan->minuteStart[minuteOfDay + 1] += plan->minuteStart[minuteOfDay];
+        fill[minuteOfDay] = plan->minuteStart[minuteOfDay];
+    }
+
+    for(i = 0; i < group->minuteEntries.numEntries; i++)
+    {
+        horo_entry_t* entry = group->minuteEntries.entries[i];
+        uint64_t hours = entry->scheduleVals.hour & hourBits;
+
+        if(entry->planState != PLAN_SPARSE) continue;
+
+        for(; hours != 0; hours &= hours - 1)
+        {
+            uint64_t minute = entry->scheduleVals.minute & minuteBits;
+
+            for(; minute != 0; minute &= minute - 1)
+            {
+                plan->fired[fill[(lowestBit(hours) * 60) + lowestBit(minute)]++] = entry;
+            }
+        }
+    }
+
+    plan->dayOfMonth = userTime->dayOfMonth;
+    plan->month = userTime->month;
+    plan->dayOfWeek = userTime->dayOfWeek;
+    plan->valid = 1;
+}
+
+/*Runs the entries of the plan that are due at the minute of 'entryCheck'*/
+static void
+runDayPlan(horoDayPlan_t const* plan, checkEntryData_t* entryCheck)
+{
+    horo_time_t const* userTime = entryCheck->userTime;
+    int minuteOfDay = (userTime->hour * 60) + userTime->minute;
+    uint32_t i = 0;
+    size_t j = 0;
+
+    for(i = plan->minuteStart[minuteOfDay]; i < plan->minuteStart[minuteOfDay + 1]; i++)
+    {
+        if(plan->fired[i] != NULL)
+        {
+            runIfDue(entryCheck->clock, plan->fired[i], userTime, 0, entryCheck->repeated);
+        }
+    }
+
+    for(j = 0; j < plan->dense.numEntries; j++)
+    {
+        horo_entry_t* entry = plan->dense.entries[j];
+
+        if((entry->scheduleVals.minute & ((uint64_t)1 << userTime->minute)) &&
+           (entry->scheduleVals.hour & ((uint64_t)1 << userTime->hour)))
+        {
+            runIfDue(entryCheck->clock, entry, userTime, 0, entryCheck->repeated);
+        }
+    }
+
+    for(j = 0; j < plan->pending.numEntries; j++)
+    {
+        checkEachEntry(plan->pending.entries[j], entryCheck);
+    }
+}
+
+static void
+processGroup(horo_clock_t* clock, horoZoneGroup_t* group,
+             horo_time_t const* userTime, int repeated)
+{
+    horoDayPlan_t* plan = &group->plan;
+
+    uint32_t minuteStamp = RUNTIME_STAMP_MINUTE(packRuntime(userTime));
+    size_t i = 0;
+
+    if((group->minuteCounts[userTime->minute] == 0) ||
+       (group->hourCounts[userTime->hour] == 0) ||
+       (group->monthCounts[userTime->month] == 0))
+    {
+        group->entriesAdded = 0;
+        group->lastMinuteStamp = minuteStamp;
+        return;
+    }
+
+    if(group->entriesAdded || (minuteStamp != group->lastMinuteStamp))
+    {
+        checkEntryData_t entryCheck;
+        entryCheck.clock = clock;
+        entryCheck.userTime = userTime;
+        entryCheck.repeated = repeated;
+
+        group->entriesAdded = 0;
+        group->lastMinuteStamp = minuteStamp;
+
+        if(!plan->valid || (plan->dayOfMonth != userTime->dayOfMonth) ||
+           (plan->month != userTime->month) || (plan->dayOfWeek != userTime->dayOfWeek) ||
+           (plan->pending.numEntries > PLAN_MAX_PENDING))
+        {
+            buildDayPlan(group, userTime);
+        }
+
+        if(plan->valid)
+        {
+            runDayPlan(plan, &entryCheck);
+        }
+        else
+        {
+            for(; i < group->minuteEntries.numEntries; i++)
+            {
+                checkEachEntry(group->minuteEntries.entries[i], &entryCheck);
+            }
+        }
+    }
+
+    checkWheelSlot(clock, &group->secondsWheel[userTime->second], userTime,
+                   minuteStamp, repeated);
+}
+
+HORO_ERROR
+horo_init(horo_clock_t** oClock)
+{
+    RETURN_ILLEGAL_IF(oClock == NULL);
+
+    //TODO: Add callback for memory allocation
+    *oClock = (horo_clock_t*)malloc(sizeof(horo_clock_t));
+    if(*oClock == NULL)
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+
+    (*oClock)->groups = (horoZoneGroup_t**)malloc(sizeof(horoZoneGroup_t*));
+    if((*oClock)->groups != NULL)
+    {
+        (*oClock)->groups[LOCAL_GROUP] =
+            (horoZoneGroup_t*)calloc(1, sizeof(horoZoneGroup_t));
+    }
+    if(((*oClock)->groups == NULL) || ((*oClock)->groups[LOCAL_GROUP] == NULL))
+    {
+        free((*oClock)->groups);
+        free(*oClock);
+        *oClock = NULL;
+        return HORO_ERROR_NO_MEM;
+    }
+    (*oClock)->numGroups = 1;
+    (*oClock)->limitGroups = NULL;
+    (*oClock)->numLimitGroups = 0;
+    
+    memset(&(*oClock)->lastTick, 0, sizeof((*oClock)->lastTick));
+    (*oClock)->nextActionID=0;
+    (*oClock)->statsEnabled = 0;
+    (*oClock)->tickLateness = 0;
+    (*oClock)->tickStart = 0;
+    (*oClock)->traceBegin = NULL;
+    (*oClock)->traceEnd = NULL;
+    (*oClock)->traceUserp = NULL;
+    (*oClock)->checkpoint = NULL;
+    (*oClock)->processing = 0;
+    (*oClock)->removalsPending = 0;
+    memset(&(*oClock)->deferredAdds, 0, sizeof((*oClock)->deferredAdds));
+    (*oClock)->deferredReschedules = NULL;
+    (*oClock)->numDeferredReschedules = 0;
+    (*oClock)->deferredReschedulesCapacity = 0;
+    memset(&(*oClock)->entryIndex, 0, sizeof((*oClock)->entryIndex));
+    return horoList_init(&(*oClock)->entries);
+}
+
+/*Whether any group has entries with a seconds field*/
+static int
+hasSecondsEntries(horo_clock_t* clock)
+{
+    size_t i = 0;
+
+    for(; i < clock->numGroups; i++)
+    {
+        if(clock->groups[i]->secondsEntries > 0) return 1;
+    }
+    return 0;
+}
+
+/*
+ * Runs the local group at 'userTime' and, if 'utc' is given, every zone
+ * group at its local time of 'utc'.
+ */
+static HORO_ERROR
+processTick(horo_clock_t* clock, horo_time_t const* userTime, int64_t const* utc)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    horo_time_t tickTime;
+    size_t i = 0;
+
+    HORO_PROBE_PROCESS_BEGIN(userTime);
+    if(clock->traceBegin != NULL)
+    {
+        callTraceHook(clock, clock->traceBegin, HORO_TRACE_PROCESS, userTime,
+                      NULL, NULL, 0, NULL, HORO_SUCCESS);
+    }
+
+    //Callers that only drive five field schedules may leave 'second' unset
+    tickTime = *userTime;
+    if(!hasSecondsEntries(clock))
+    {
+        tickTime.second = 0;
+    }
+    else if(tickTime.second == 60)
+    {
+        tickTime.second = 59;
+    }
+
+    ret = validateHoroTime(&tickTime);
+    if(ret) goto DONE;
+
+    if(clock->entries.numElements > 0)
+    {
+        if(clock->statsEnabled)
+        {
+            startTickStats(clock, &tickTime);
+        }
+
+        clock->processing = 1;
+        processGroup(clock, clock->groups[LOCAL_GROUP], &tickTime, 0);
+
+        for(i = LOCAL_GROUP + 1; (utc != NULL) && (i < clock->numGroups); i++)
+        {
+            horoZoneGroup_t* group = clock->groups[i];
+            horo_time_t zoneTime;
+            int repeated = 0;
+
+            horoZone_breakDown(group->zone, *utc, &zoneTime);
+            repeated = checkZoneTransition(clock, group, *utc, &zoneTime);
+            processGroup(clock, group, &zoneTime, repeated);
+        }
+        drainLimitGroups(clock, &tickTime);
+        clock->processing = 0;
+        applyDeferredOps(clock);
+
+        clock->lastTick = tickTime;
+    }
+
+DONE:
+    if(clock->traceEnd != NULL)
+    {
+        callTraceHook(clock, clock->traceEnd, HORO_TRACE_PROCESS, userTime,
+                      NULL, NULL, 0, NULL, ret);
+    }
+    HORO_PROBE_PROCESS_END(ret);
+    return ret;
+}
+
+HORO_ERROR
+horo_process(horo_clock_t* clock, horo_time_t const* userTime)
+{
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(userTime == NULL);
+    RETURN_ILLEGAL_IF(clock->processing);
+
+    return processTick(clock, userTime, NULL);
+}
+
+#ifdef _WIN32
+#define breakDownLocalTime(timep, result) (localtime_s((result), (timep)) == 0)
+#else
+#define breakDownLocalTime(timep, result) (localtime_r((timep), (result)) != NULL)
+#endif
+
+static void
+horoTimeFromTm(struct tm const* localTime, horo_time_t* oTimeVals)
+{
+    oTimeVals->minute = localTime->tm_min;
+    oTimeVals->hour = localTime->tm_hour;
+    oTimeVals->dayOfMonth = localTime->tm_mday;
+    oTimeVals->month = localTime->tm_mon + 1;
+    oTimeVals->dayOfWeek = localTime->tm_wday;
+
+    //Leap seconds are folded into the last second of the minute
+    oTimeVals->second = (localTime->tm_sec < 60) ? localTime->tm_sec : 59;
+}
+
+HORO_ERROR
+horo_processUtc(horo_clock_t* clock, int64_t utcSeconds)
+{
+    time_t now = (time_t)utcSeconds;
+    struct tm localTime;
+    horo_time_t timeVals;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(clock->processing);
+    if(((int64_t)now != utcSeconds) || !breakDownLocalTime(&now, &localTime))
+    {
+        return HORO_ERROR_OUT_OF_RANGE;
+    }
+
+    horoTimeFromTm(&localTime, &timeVals);
+    return processTick(clock, &timeVals, &utcSeconds);
+}
+
+HORO_ERROR
+horo_setActionOneShot(horo_clock_t* clock, int actionID, int oneShot)
+{
+    horo_entry_t* entry = NULL;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+
+    entry = findEntry(clock, actionID);
+    if(entry == NULL)
+    {
+        return HORO_ERROR_UNKNOWN_ACTION;
+    }
+
+    entry->oneShot = (oneShot != 0);
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_setActionDstPolicy(horo_clock_t* clock, int actionID,
+                        HORO_DST_POLICY policy)
+{
+    horo_entry_t* entry = NULL;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF((policy != HORO_DST_RUN_ONCE) && (policy != HORO_DST_SKIP) &&
+                      (policy != HORO_DST_RUN_TWICE));
+
+    entry = findEntry(clock, actionID);
+    if(entry == NULL)
+    {
+        return HORO_ERROR_UNKNOWN_ACTION;
+    }
+
+    entry->dstPolicy = (uint8_t)policy;
+    return HORO_SUCCESS;
+}
+
+/*
+ * Queues a reschedule made during a tick.  The group's arrays are grown for
+ * it and for every earlier reschedule in the group, so applying them after
+ * the tick cannot run out of memory.
+ */
+static HORO_ERROR
+deferReschedule(horo_clock_t* clock, horo_entry_t* entry,
+                PackedCronVals const* scheduleVals)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    size_t extra = 1;
+    size_t i = 0;
+
+    for(; i < clock->numDeferredReschedules; i++)
+    {
+        if(clock->deferredReschedules[i].entry->group == entry->group)
+        {
+            extra++;
+        }
+    }
+    err = reserveSchedule(clock->groups[entry->group], scheduleVals, extra);
+    if(err) return err;
+
+    if(clock->numDeferredReschedules == clock->deferredReschedulesCapacity)
+    {
+        size_t capacity = (clock->deferredReschedulesCapacity == 0) ? 8 :
+            clock->deferredReschedulesCapacity * 2;
+        horoReschedule_t* grown = NULL;
+
+        grown = (horoReschedule_t*)realloc(clock->deferredReschedules,
+                                           capacity * sizeof(horoReschedule_t));
+        if(grown == NULL)
+        {
+            return HORO_ERROR_NO_MEM;
+        }
+        clock->deferredReschedules = grown;
+        clock->deferredReschedulesCapacity = capacity;
+    }
+
+    clock->deferredReschedules[clock->numDeferredReschedules].entry = entry;
+    clock->deferredReschedules[clock->numDeferredReschedules].scheduleVals = *scheduleVals;
+    clock->numDeferredReschedules++;
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_rescheduleAction(horo_clock_t* clock, int actionID, const char* scheduleString)
+{
+    RETURN_ILLEGAL_IF(scheduleString == NULL);
+
+    return horo_rescheduleActionN(clock, actionID, scheduleString,
+                                  strlen(scheduleString));
+}
+
+HORO_ERROR
+horo_rescheduleActionN(horo_clock_t* clock, int actionID,
+                       const char* scheduleString, size_t scheduleLength)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    PackedCronVals scheduleVals;
+    horo_entry_t* entry = NULL;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(scheduleString == NULL);
+
+    entry = findEntry(clock, actionID);
+    if(entry == NULL)
+    {
+        return HORO_ERROR_UNKNOWN_ACTION;
+    }
+
+    err = parseSchedule(clock, scheduleString, scheduleLength, &scheduleVals);
+    if(err) return err;
+
+    if(clock->processing)
+    {
+        return deferReschedule(clock, entry, &scheduleVals);
+    }
+    return swapSchedule(clock->groups[entry->group], entry, &scheduleVals);
+}
+
+HORO_ERROR
+horo_setActionEnabled(horo_clock_t* clock, int actionID, int enabled)
+{
+    horo_entry_t* entry = NULL;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+
+    entry = findEntry(clock, actionID);
+    if(entry == NULL)
+    {
+        return HORO_ERROR_UNKNOWN_ACTION;
+    }
+
+    entry->disabled = (enabled == 0);
+
+    //A resumed action still runs in the current minute
+    if(!entry->disabled)
+    {
+        clock->groups[entry->group]->entriesAdded = 1;
+    }
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_setGroupLimits(horo_clock_t* clock, int groupID,
+                    horo_group_limits_t const* limits)
+{
+    horoLimitGroup_t** grown = NULL;
+    horoLimitGroup_t* group = NULL;
+    size_t index = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(groupID <= 0);
+    RETURN_ILLEGAL_IF(limits == NULL);
+    RETURN_ILLEGAL_IF((limits->maxInFlight < 1) || (limits->maxPending < 0));
+    RETURN_ILLEGAL_IF((limits->order != HORO_GROUP_FIFO) &&
+                      (limits->order != HORO_GROUP_PRIORITY));
+    RETURN_ILLEGAL_IF((limits->overflow != HORO_GROUP_DROP_NEWEST) &&
+                      (limits->overflow != HORO_GROUP_DROP_OLDEST));
+
+    index = findLimitGroup(clock, groupID);
+    if(index == 0)
+    {
+        //horo_entry::limitGroup is 16 bits
+        if(clock->numLimitGroups >= UINT16_MAX)
+        {
+            return HORO_ERROR_NO_MEM;
+        }
+
+        grown = (horoLimitGroup_t**)realloc(clock->limitGroups,
+            (clock->numLimitGroups + 1) * sizeof(horoLimitGroup_t*));
+        if(grown == NULL)
+        {
+            return HORO_ERROR_NO_MEM;
+        }
+        clock->limitGroups = grown;
+
+        group = (horoLimitGroup_t*)calloc(1, sizeof(horoLimitGroup_t));
+        if(group == NULL)
+        {
+            return HORO_ERROR_NO_MEM;
+        }
+        group->id = groupID;
+        index = ++clock->numLimitGroups;
+        clock->limitGroups[index - 1] = group;
+    }
+
+    //Runs queued at another order stay in their level until they run
+    clock->limitGroups[index - 1]->limits = *limits;
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_setActionGroup(horo_clock_t* clock, int actionID, int groupID,
+                    int priority)
+{
+    horoLimitGroup_t* group = NULL;
+    horo_entry_t* entry = NULL;
+    size_t index = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(groupID < 0);
+    RETURN_ILLEGAL_IF((priority < 0) || (priority > HORO_GROUP_MAX_PRIORITY));
+
+    entry = findEntry(clock, actionID);
+    if(entry == NULL)
+    {
+        return HORO_ERROR_UNKNOWN_ACTION;
+    }
+
+    if(groupID != 0)
+    {
+        index = findLimitGroup(clock, groupID);
+        if(index == 0)
+        {
+            return HORO_ERROR_UNKNOWN_GROUP;
+        }
+    }
+
+    if(!entry->queued)
+    {
+        entry->limitGroup = (uint16_t)index;
+        entry->priority = (uint8_t)priority;
+        return HORO_SUCCESS;
+    }
+
+    if(index == entry->limitGroup)
+    {
+        group = clock->limitGroups[index - 1];
+        if((group->limits.order != HORO_GROUP_PRIORITY) ||
+           (priority == entry->priority))
+        {
+            entry->priority = (uint8_t)priority;
+            return HORO_SUCCESS;
+        }
+
+        //The queued run moves to the end of its new priority level
+        unqueueEntry(clock, entry);
+        entry->priority = (uint8_t)priority;
+        if(groupQueue_push(&group->levels[priority], (int)entry->id) == HORO_SUCCESS)
+        {
+            group->numPending++;
+            entry->queued = 1;
+        }
+        else
+        {
+            group->stats.dropped++;
+        }
+    }
+    else
+    {
+        //The queued run moves along, without a group there is no queue for it
+        unqueueEntry(clock, entry);
+        if(index == 0)
+        {
+            clock->limitGroups[entry->limitGroup - 1]->stats.dropped++;
+        }
+        entry->limitGroup = (uint16_t)index;
+        entry->priority = (uint8_t)priority;
+        if(index != 0)
+        {
+            queueFire(clock, entry);
+        }
+    }
+
+    if(entry->oneShot && !entry->queued)
+    {
+        markRemoved(clock, entry);
+        commitRemovals(clock);
+    }
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_groupActionDone(horo_clock_t* clock, int groupID)
+{
+    horoLimitGroup_t* group = NULL;
+    size_t index = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+
+    index = findLimitGroup(clock, groupID);
+    if(index == 0)
+    {
+        return HORO_ERROR_UNKNOWN_GROUP;
+    }
+    group = clock->limitGroups[index - 1];
+    RETURN_ILLEGAL_IF(group->stats.inFlight == 0);
+
+    group->stats.inFlight--;
+
+    //Called by an action, the tick drains the queues when it is done
+    if(clock->processing || (group->numPending == 0))
+    {
+        return HORO_SUCCESS;
+    }
+
+    clock->processing = 1;
+    drainLimitGroups(clock, &clock->lastTick);
+    clock->processing = 0;
+    applyDeferredOps(clock);
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_getGroupStats(horo_clock_t* clock, int groupID,
+                   horo_group_stats_t* oStats)
+{
+    horoLimitGroup_t* group = NULL;
+    size_t index = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(oStats == NULL);
+
+    index = findLimitGroup(clock, groupID);
+    if(index == 0)
+    {
+        return HORO_ERROR_UNKNOWN_GROUP;
+    }
+    group = clock->limitGroups[index - 1];
+
+    *oStats = group->stats;
+    oStats->pending = group->numPending;
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_unscheduleAction(horo_clock_t* clock, int actionID)
+{
+    HORO_ERROR ret = HORO_ERROR_UNKNOWN_ACTION;
+    horoContainerNode_t* node = NULL;
+    horo_entry_t* entry = NULL;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+
+    node = findEntryNode(clock, actionID);
+    entry = (node != NULL) ? (horo_entry_t*)node->data : NULL;
+    if((entry != NULL) && clock->processing)
+    {
+        markRemoved(clock, entry);
+        commitRemovals(clock);
+        ret = HORO_SUCCESS;
+    }
+    else if(entry != NULL)
+    {
+        removeFromGroup(clock->groups[entry->group], entry);
+        entryIndex_remove(&clock->entryIndex, entry);
+        detachCheckpoint(clock, entry);
+        releaseEntry(entry);
+        ret = horoList_removeNode(&clock->entries, node);
+    }
+
+    return ret;
+}
+
+HORO_ERROR
+horo_actionCount(horo_clock_t* clock, int* oActionCount)
+{
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(oActionCount == NULL);
+
+    *oActionCount = clock->entries.numElements;
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_validate(const char* scheduleString, size_t length,
+              horo_validation_t* oValidation)
+{
+    CronVals cronVals;
+
+    RETURN_ILLEGAL_IF((scheduleString == NULL) && (length > 0));
+    RETURN_ILLEGAL_IF(oValidation == NULL);
+
+    return parseCronString(scheduleString, length, &cronVals, oValidation);
+}
+
+HORO_ERROR
+horo_canonicalizeSchedule(const char* scheduleString, char* oCanonical,
+                          size_t canonicalSize, uint64_t* oFingerprint)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    CronVals cronVals;
+    CronVals canonical;
+
+    RETURN_ILLEGAL_IF(scheduleString == NULL);
+    RETURN_ILLEGAL_IF((oCanonical == NULL) && (canonicalSize > 0));
+
+    err = processCronString(scheduleString, &cronVals);
+    if(err) return err;
+
+    canonicalCronVals(&cronVals, &canonical);
+    if((oCanonical != NULL) &&
+       (formatCronVals(&canonical, oCanonical, canonicalSize) >= canonicalSize))
+    {
+        return HORO_ERROR_ILLEGAL_ARG;
+    }
+    if(oFingerprint != NULL)
+    {
+        *oFingerprint = fingerprintCronVals(&canonical);
+    }
+
+    return HORO_SUCCESS;
+}
+
+static uint64_t
+hashMix(uint64_t hash, uint64_t value)
+{
+    hash ^= value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+    hash ^= hash >> 31;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+    hash ^= hash >> 27;
+    return hash;
+}
+
+static uint64_t
+hashSchedule(PackedCronVals const* cronVals)
+{
+    uint64_t hash = 0;
+
+    hash = hashMix(hash, cronVals->minute);
+    hash = hashMix(hash, cronVals->hour);
+    hash = hashMix(hash, cronVals->dayOfMonth);
+    hash = hashMix(hash, cronVals->month);
+    hash = hashMix(hash, cronVals->dayOfWeek);
+    hash = hashMix(hash, cronVals->second);
+    return hash;
+}
+
+static int
+sameSchedule(PackedCronVals const* a, PackedCronVals const* b)
+{
+    return (a->minute == b->minute) && (a->hour == b->hour) &&
+        (a->dayOfMonth == b->dayOfMonth) && (a->month == b->month) &&
+        (a->dayOfWeek == b->dayOfWeek) && (a->second == b->second) &&
+        (a->asterisks == b->asterisks);
+}
+
+/*
+ * A distinct schedule and the number of fires per matching minute of the
+ * entries that use it.
+ */
+typedef struct
+{
+    PackedCronVals const* scheduleVals;
+    uint32_t members;
+}internedSchedule_t;
+
+static uint32_t
+firesPerMinute(PackedCronVals const* scheduleVals)
+{
+    uint32_t fires = countBits(scheduleVals->second);
+
+    return (fires != 0) ? fires : 1;
+}
+
+/*
+ * Collapse the entries of a zone group into their distinct schedules.  The
+ * returned array must be freed by the caller.
+ */
+static HORO_ERROR
+internSchedules(horo_clock_t* clock, size_t group,
+                internedSchedule_t** oSchedules, size_t* oNumSchedules)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    size_t capacity = 16;
+    size_t numSchedules = 0;
+    internedSchedule_t* table = NULL;
+    internedSchedule_t* schedules = NULL;
+    horoContainerNode_t* node = NULL;
+    size_t i = 0;
+
+    while(capacity < (clock->entries.numElements * 2))
+    {
+        capacity *= 2;
+    }
+
+    table = (internedSchedule_t*)calloc(capacity, sizeof(internedSchedule_t));
+    if(table == NULL)
+    {
+        ret = HORO_ERROR_NO_MEM;
+        goto DONE;
+    }
+
+    for(node = clock->entries.head; node != NULL; node = node->next)
+    {
+        horo_entry_t const* entry = (horo_entry_t*)node->data;
+        PackedCronVals const* scheduleVals = &entry->scheduleVals;
+        size_t slot = (size_t)hashSchedule(scheduleVals) & (capacity - 1);
+
+        if((entry->group != group) || entry->removed || entry->deferred ||
+           entry->disabled) continue;
+
+        while((table[slot].scheduleVals != NULL) &&
+              !sameSchedule(table[slot].scheduleVals, scheduleVals))
+        {
+            slot = (slot + 1) & (capacity - 1);
+        }
+
+        if(table[slot].scheduleVals == NULL)
+        {
+            table[slot].scheduleVals = scheduleVals;
+            numSchedules++;
+        }
+        table[slot].members += firesPerMinute(scheduleVals);
+    }
+
+    schedules = (internedSchedule_t*)malloc((numSchedules + 1) * sizeof(internedSchedule_t));
+    if(schedules == NULL)
+    {
+        ret = HORO_ERROR_NO_MEM;
+        goto DONE;
+    }
+
+    numSchedules = 0;
+    for(i = 0; i < capacity; i++)
+    {
+        if(table[i].scheduleVals != NULL)
+        {
+            schedules[numSchedules++] = table[i];
+        }
+    }
+
+    *oSchedules = schedules;
+    *oNumSchedules = numSchedules;
+DONE:
+    free(table);
+    return ret;
+}
+
+/*
+ * Number of fires in every minute of the day described by 'day'.  Only the
+ * month and day fields of 'day' are used.
+ */
+static void
+planDayCounts(internedSchedule_t const* schedules, size_t numSchedules,
+              horo_time_t const* day, uint32_t* dayCounts)
+{
+    uint32_t everyMinute[24];
+    uint64_t const allMinutes = ((uint64_t)1 << 60) - 1;
+    size_t i = 0;
+    int hour = 0;
+    int minute = 0;
+
+    memset(everyMinute, 0, sizeof(everyMinute));
+    memset(dayCounts, 0, MINUTES_PER_DAY * sizeof(uint32_t));
+
+    for(i = 0; i < numSchedules; i++)
+    {
+        PackedCronVals const* scheduleVals = schedules[i].scheduleVals;
+        uint64_t hours = scheduleVals->hour & (((uint64_t)1 << 24) - 1);
+
+        if(!(scheduleVals->month & ((uint64_t)1 << day->month)) ||
+           !checkPackedDOMWithDOW(scheduleVals, day))
+        {
+            continue;
+        }
+
+        for(; hours != 0; hours &= hours - 1)
+        {
+            uint64_t minutes = scheduleVals->minute & allMinutes;
+
+            hour = lowestBit(hours);
+            if(minutes == allMinutes)
+            {
+                everyMinute[hour] += schedules[i].members;
+                continue;
+            }
+
+            for(; minutes != 0; minutes &= minutes - 1)
+            {
+                dayCounts[(hour * 60) + lowestBit(minutes)] += schedules[i].members;
+            }
+        }
+    }
+
+    for(hour = 0; hour < 24; hour++)
+    {
+        if(everyMinute[hour] == 0) continue;
+        for(minute = 0; minute < 60; minute++)
+        {
+            dayCounts[(hour * 60) + minute] += everyMinute[hour];
+        }
+    }
+}
+
+static HORO_ERROR
+breakDownGroupTime(horo_clock_t* clock, size_t group, int64_t utc,
+                   horo_time_t* oTimeVals)
+{
+    if(group == LOCAL_GROUP)
+    {
+        time_t now = (time_t)utc;
+        struct tm localTime;
+
+        if(((int64_t)now != utc) || !breakDownLocalTime(&now, &localTime))
+        {
+            return HORO_ERROR_OUT_OF_RANGE;
+        }
+        horoTimeFromTm(&localTime, oTimeVals);
+    }
+    else
+    {
+        horoZone_breakDown(clock->groups[group]->zone, utc, oTimeVals);
+    }
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_forecast(horo_clock_t* clock, time_t from, time_t to,
+              uint32_t* oPerMinuteCounts)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    internedSchedule_t* schedules = NULL;
+    size_t numSchedules = 0;
+    uint32_t* dayCounts = NULL;
+    size_t numMinutes = 0;
+    size_t group = 0;
+    size_t i = 0;
+    time_t start = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(oPerMinuteCounts == NULL);
+    RETURN_ILLEGAL_IF(to < from);
+
+    //Rounds down before 1970 too, where % is negative
+    start = from - (((from % 60) + 60) % 60);
+    numMinutes = (size_t)((to - start + 59) / 60);
+    memset(oPerMinuteCounts, 0, numMinutes * sizeof(uint32_t));
+
+    dayCounts = (uint32_t*)malloc(MINUTES_PER_DAY * sizeof(uint32_t));
+    if(dayCounts == NULL)
+    {
+        ret = HORO_ERROR_NO_MEM;
+        goto DONE;
+    }
+
+    for(group = 0; group < clock->numGroups; group++)
+    {
+        time_t minuteStart = start;
+        horo_time_t planned;
+
+        free(schedules);
+        schedules = NULL;
+        ret = internSchedules(clock, group, &schedules, &numSchedules);
+        if(ret) goto DONE;
+        if(numSchedules == 0) continue;
+
+        memset(&planned, 0, sizeof(planned));
+        for(i = 0; i < numMinutes; i++, minuteStart += 60)
+        {
+            horo_time_t timeVals;
+
+            ret = breakDownGroupTime(clock, group, (int64_t)minuteStart, &timeVals);
+            if(ret) goto DONE;
+
+            //Only the day fields are used to plan a day
+            if((timeVals.dayOfMonth != planned.dayOfMonth) ||
+               (timeVals.month != planned.month) ||
+               (timeVals.dayOfWeek != planned.dayOfWeek))
+            {
+                planDayCounts(schedules, numSchedules, &timeVals, dayCounts);
+                planned = timeVals;
+            }
+
+            oPerMinuteCounts[i] += dayCounts[(timeVals.hour * 60) + timeVals.minute];
+        }
+    }
+
+DONE:
+    free(schedules);
+    free(dayCounts);
+    return ret;
+}
+
+/*A local hour of a zone group that overlaps a query window*/
+typedef struct
+{
+    int64_t start;
+    horo_time_t localTime;
+}windowHour_t;
+
+typedef struct
+{
+    int64_t fireTime;
+    horo_entry_t* entry;
+
+    /*The windowHour_t of fireTime in the hours of the entry's group*/
+    size_t hour;
+}windowFire_t;
+
+/*
+ * Lists the local hours of a group from the one 'from' is in up to 'to'.
+ * A time is broken down once per hour, the hours skipped or repeated by a
+ * daylight saving time jump are skipped or listed twice.
+ */
+static HORO_ERROR
+listWindowHours(horo_clock_t* clock, size_t group, int64_t from, int64_t to,
+                windowHour_t** oHours, size_t* oNumHours)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    windowHour_t* hours = NULL;
+    size_t capacity = (size_t)((to - from) / 3600) + 2;
+    size_t numHours = 0;
+    int64_t utc = from;
+
+    hours = (windowHour_t*)malloc(capacity * sizeof(windowHour_t));
+    if(hours == NULL)
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+
+    while(utc < to)
+    {
+        windowHour_t* hour = NULL;
+
+        if(numHours == capacity)
+        {
+            windowHour_t* grown = (windowHour_t*)realloc(hours,
+                                                         capacity * 2 * sizeof(windowHour_t));
+            if(grown == NULL)
+            {
+                err = HORO_ERROR_NO_MEM;
+                break;
+            }
+            hours = grown;
+            capacity *= 2;
+        }
+
+        hour = &hours[numHours++];
+        err = breakDownGroupTime(clock, group, utc, &hour->localTime);
+        if(err) break;
+
+        hour->start = utc - (hour->localTime.minute * 60) - hour->localTime.second;
+        utc = hour->start + 3600;
+    }
+
+    if(err)
+    {
+        free(hours);
+        return err;
+    }
+
+    *oHours = hours;
+    *oNumHours = numHours;
+    return HORO_SUCCESS;
+}
+
+/*
+ * The first second of the hour at or after 'offset' seconds into the hour
+ * that matches the minute and second fields, -1 if there is none.
+ */
+static int
+nextOffsetInHour(PackedCronVals const* scheduleVals, int offset)
+{
+    int minute = offset / 60;
+    uint64_t seconds = (scheduleVals->second != 0) ? scheduleVals->second : 1;
+    uint64_t later = 0;
+
+    if((scheduleVals->minute >> minute) & 1)
+    {
+        later = seconds & (~(uint64_t)0 << (offset % 60));
+        if(later != 0) return (minute * 60) + lowestBit(later);
+    }
+
+    later = scheduleVals->minute & (~(uint64_t)0 << (minute + 1));
+    if(later == 0) return -1;
+
+    return (lowestBit(later) * 60) + lowestBit(seconds);
+}
+
+/*
+ * Finds the first time at or after 'notBefore' that the entry fires,
+ * starting with hour fire->hour.  Returns 0 if it does not fire before the
+ * last hour ends.
+ */
+static int
+nextWindowFire(windowHour_t const* hours, size_t numHours, int64_t notBefore,
+               windowFire_t* fire)
+{
+    PackedCronVals const* scheduleVals = &fire->entry->scheduleVals;
+
+    for(; fire->hour < numHours; fire->hour++)
+    {
+        windowHour_t const* hour = &hours[fire->hour];
+        int64_t offset = (notBefore > hour->start) ? (notBefore - hour->start) : 0;
+
+        if(offset >= 3600) continue;
+        if(!((scheduleVals->hour >> hour->localTime.hour) & 1) ||
+           !((scheduleVals->month >> hour->localTime.month) & 1) ||
+           !checkPackedDOMWithDOW(scheduleVals, &hour->localTime))
+        {
+            continue;
+        }
+
+        offset = nextOffsetInHour(scheduleVals, (int)offset);
+        if(offset >= 0)
+        {
+            fire->fireTime = hour->start + offset;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int
+windowFireBefore(windowFire_t const* a, windowFire_t const* b)
+{
+    if(a->fireTime != b->fireTime) return a->fireTime < b->fireTime;
+    return a->entry->id < b->entry->id;
+}
+
+static void
+windowHeap_siftDown(windowFire_t* heap, size_t numFires, size_t i)
+{
+    for(;;)
+    {
+        size_t smallest = i;
+        size_t child = (2 * i) + 1;
+        windowFire_t swap;
+
+        if((child < numFires) && windowFireBefore(&heap[child], &heap[smallest]))
+        {
+            smallest = child;
+        }
+        if((child + 1 < numFires) && windowFireBefore(&heap[child + 1], &heap[smallest]))
+        {
+            smallest = child + 1;
+        }
+        if(smallest == i) return;
+
+        swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+HORO_ERROR
+horo_queryWindow(horo_clock_t* clock, time_t from, time_t to,
+                 horo_windowFunc callback, void* userp)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    windowHour_t** hours = NULL;
+    size_t* numHours = NULL;
+    windowFire_t* heap = NULL;
+    size_t numFires = 0;
+    horoContainerNode_t* node = NULL;
+    size_t group = 0;
+    size_t i = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(callback == NULL);
+    RETURN_ILLEGAL_IF(to < from);
+    if((to == from) || (clock->entries.numElements == 0)) return HORO_SUCCESS;
+
+    hours = (windowHour_t**)calloc(clock->numGroups, sizeof(windowHour_t*));
+    numHours = (size_t*)calloc(clock->numGroups, sizeof(size_t));
+    heap = (windowFire_t*)malloc(clock->entries.numElements * sizeof(windowFire_t));
+    if((hours == NULL) || (numHours == NULL) || (heap == NULL))
+    {
+        ret = HORO_ERROR_NO_MEM;
+        goto DONE;
+    }
+
+    for(group = 0; group < clock->numGroups; group++)
+    {
+        ret = listWindowHours(clock, group, (int64_t)from, (int64_t)to,
+                              &hours[group], &numHours[group]);
+        if(ret) goto DONE;
+    }
+
+    for(node = clock->entries.head; node != NULL; node = node->next)
+    {
+        windowFire_t* fire = &heap[numFires];
+
+        fire->entry = (horo_entry_t*)node->data;
+        fire->hour = 0;
+        if(fire->entry->removed || fire->entry->deferred ||
+           fire->entry->disabled) continue;
+
+        group = fire->entry->group;
+        if(nextWindowFire(hours[group], numHours[group], (int64_t)from, fire))
+        {
+            numFires++;
+        }
+    }
+
+    for(i = numFires / 2; i > 0; i--)
+    {
+        windowHeap_siftDown(heap, numFires, i - 1);
+    }
+
+    //The earliest fire is reported and replaced by the next fire of its entry
+    while((numFires > 0) && (heap[0].fireTime < (int64_t)to))
+    {
+        windowFire_t* fire = &heap[0];
+
+        ret = callback(userp, (int)fire->entry->id, (time_t)fire->fireTime);
+        if(ret) goto DONE;
+
+        group = fire->entry->group;
+        if(!nextWindowFire(hours[group], numHours[group], fire->fireTime + 1, fire))
+        {
+            heap[0] = heap[--numFires];
+        }
+        windowHeap_siftDown(heap, numFires, 0);
+    }
+
+DONE:
+    for(group = 0; (hours != NULL) && (group < clock->numGroups); group++)
+    {
+        free(hours[group]);
+    }
+    free(hours);
+    free(numHours);
+    free(heap);
+    return ret;
+}
+
+HORO_ERROR
+horo_enableActionStats(horo_clock_t* clock, int enable)
+{
+    RETURN_ILLEGAL_IF(clock == NULL);
+
+    clock->statsEnabled = (enable != 0);
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_getActionStats(horo_clock_t* clock, int actionID,
+                    horo_action_stats_t* oStats)
+{
+    horo_entry_t* entry = NULL;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(oStats == NULL);
+
+    entry = findEntry(clock, actionID);
+    if(entry == NULL)
+    {
+        return HORO_ERROR_UNKNOWN_ACTION;
+    }
+
+    memset(oStats, 0, sizeof(*oStats));
+    if(ENTRY_STATS(entry) != NULL)
+    {
+        horoHistogram_summarize(&entry->extra->stats->lateness, &oStats->lateness);
+        horoHistogram_summarize(&entry->extra->stats->duration, &oStats->duration);
+    }
+
+    return HORO_SUCCESS;
+}
+
+static uint64_t
+hashString(const char* string)
+{
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for(; *string != '\0'; string++)
+    {
+        hash ^= (unsigned char)*string;
+        hash *= 0x100000001B3ULL;
+    }
+
+    return (hash != 0) ? hash : 1;
+}
+
+/*Returns the slot of 'keyHash' or the unused slot where it would go*/
+static uint32_t
+probeCheckpoint(checkpointSlot_t const* slots, uint32_t capacity, uint64_t keyHash)
+{
+    uint32_t index = (uint32_t)keyHash & (capacity - 1);
+
+    //The load factor stays below 1, an unused slot is always found
+    while((slots[index].keyHash != keyHash) && (slots[index].keyHash != 0))
+    {
+        index = (index + 1) & (capacity - 1);
+    }
+    return index;
+}
+
+static int
+keepCheckpointSlot(struct horoCheckpoint const* checkpoint, uint32_t index)
+{
+    checkpointSlot_t const* slot = &checkpoint->slots[index];
+
+    if(slot->keyHash == 0) return 0;
+    if(checkpoint->refs[index] > 0) return 1;
+
+    //Seen by the previous process but not yet by this one
+    return (slot->generation + 1 == checkpoint->generation);
+}
+
+#ifndef _WIN32
+/*
+ * Maps a checkpoint file of 'capacity' slots.  The header is written, the
+ * slots are zero.
+ */
+static HORO_ERROR
+createCheckpointFile(const char* path, uint32_t capacity, uint32_t generation,
+                     void** oBase, size_t* oSize)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    checkpointHeader_t* header = NULL;
+    size_t size = sizeof(checkpointHeader_t) + (capacity * sizeof(checkpointSlot_t));
+    void* base = MAP_FAILED;
+    int fd = -1;
+
+    fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if((fd < 0) || (ftruncate(fd, (off_t)size) != 0))
+    {
+        ret = HORO_ERROR_IO;
+        goto DONE;
+    }
+
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(base == MAP_FAILED)
+    {
+        ret = HORO_ERROR_IO;
+        goto DONE;
+    }
+
+    header = (checkpointHeader_t*)base;
+    header->version = CHECKPOINT_VERSION;
+    header->capacity = capacity;
+    header->generation = generation;
+    header->numSlots = 0;
+    memcpy(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic));
+
+    *oBase = base;
+    *oSize = size;
+
+DONE:
+    if(fd >= 0) close(fd);
+    return ret;
+}
+
+/*
+ * Rebuilds the table with room for 'extra' more keys at no more than half
+ * load.  The new table is written next to the file and renamed over it, a
+ * crash leaves either the old or the new table.
+ */
+static HORO_ERROR
+rebuildCheckpoint(horo_clock_t* clock, uint32_t extra)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    struct horoCheckpoint* checkpoint = clock->checkpoint;
+    checkpointSlot_t* slots = NULL;
+    horoContainerNode_t* node = NULL;
+    uint32_t* refs = NULL;
+    uint32_t* moved = NULL;
+    char* tempPath = NULL;
+    void* base = MAP_FAILED;
+    size_t size = 0;
+    uint32_t capacity = CHECKPOINT_MIN_CAPACITY;
+    uint32_t numKept = 0;
+    uint32_t i = 0;
+
+    for(i = 0; i < checkpoint->capacity; i++)
+    {
+        numKept += keepCheckpointSlot(checkpoint, i);
+    }
+    while(capacity < 2 * ((uint64_t)numKept + extra))
+    {
+        if(capacity >= ((uint32_t)1 << 30)) return HORO_ERROR_NO_MEM;
+        capacity *= 2;
+    }
+
+    tempPath = (char*)malloc(strlen(checkpoint->path) + sizeof(".tmp"));
+    refs = (uint32_t*)calloc(capacity, sizeof(uint32_t));
+    moved = (uint32_t*)malloc(checkpoint->capacity * sizeof(uint32_t));
+    if((tempPath == NULL) || (refs == NULL) || (moved == NULL))
+    {
+        ret = HORO_ERROR_NO_MEM;
+        goto DONE;
+    }
+    strcpy(tempPath, checkpoint->path);
+    strcat(tempPath, ".tmp");
+
+    ret = createCheckpointFile(tempPath, capacity, checkpoint->generation,
+                               &base, &size);
+    if(ret) goto DONE;
+
+    slots = (checkpointSlot_t*)((checkpointHeader_t*)base + 1);
+    for(i = 0; i < checkpoint->capacity; i++)
+    {
+        uint32_t index = 0;
+
+        if(!keepCheckpointSlot(checkpoint, i)) continue;
+
+        index = probeCheckpoint(slots, capacity, checkpoint->slots[i].keyHash);
+        slots[index] = checkpoint->slots[i];
+        refs[index] = checkpoint->refs[i];
+        moved[i] = index;
+    }
+    ((checkpointHeader_t*)base)->numSlots = numKept;
+
+    if(rename(tempPath, checkpoint->path) != 0)
+    {
+        ret = HORO_ERROR_IO;
+        goto DONE;
+    }
+
+    for(node = clock->entries.head; node != NULL; node = node->next)
+    {
+        horo_entry_t* entry = (horo_entry_t*)node->data;
+
+        if(ENTRY_CHECKPOINT(entry) == NULL) continue;
+        i = moved[checkpointSlotIndex(checkpoint, entry->extra->checkpointStamp)];
+        entry->extra->checkpointStamp = &slots[i].stamp;
+    }
+
+    munmap(checkpoint->base, checkpoint->size);
+    free(checkpoint->refs);
+    checkpoint->base = base;
+    checkpoint->size = size;
+    checkpoint->capacity = capacity;
+    checkpoint->header = (checkpointHeader_t*)base;
+    checkpoint->slots = slots;
+    checkpoint->refs = refs;
+    base = MAP_FAILED;
+    refs = NULL;
+
+DONE:
+    if(base != MAP_FAILED)
+    {
+        munmap(base, size);
+        remove(tempPath);
+    }
+    free(tempPath);
+    free(refs);
+    free(moved);
+    return ret;
+}
+#else
+static HORO_ERROR
+rebuildCheckpoint(horo_clock_t* clock, uint32_t extra)
+{
+    return HORO_ERROR_NOT_SUPPORTED;
+}
+#endif
+
+/*Finds or adds the slot of 'key', rebuilding the table when it gets full*/
+static HORO_ERROR
+findCheckpointSlot(horo_clock_t* clock, const char* key, uint32_t* oIndex)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    struct horoCheckpoint* checkpoint = clock->checkpoint;
+    uint64_t keyHash = hashString(key);
+    uint32_t index = probeCheckpoint(checkpoint->slots, checkpoint->capacity, keyHash);
+
+    if(checkpoint->slots[index].keyHash == 0)
+    {
+        if(4 * ((uint64_t)checkpoint->header->numSlots + 1) > 3 * (uint64_t)checkpoint->capacity)
+        {
+            err = rebuildCheckpoint(clock, 1);
+            if(err) return err;
+            checkpoint = clock->checkpoint;
+            index = probeCheckpoint(checkpoint->slots, checkpoint->capacity, keyHash);
+        }
+
+        checkpoint->slots[index].stamp = 0;
+        checkpoint->slots[index].keyHash = keyHash;
+        checkpoint->header->numSlots++;
+    }
+
+    *oIndex = index;
+    return HORO_SUCCESS;
+}
+
+/*
+ * Link an entry to the checkpoint slot of its key and restore its last run
+ * time from the slot.
+ */
+static HORO_ERROR
+attachCheckpoint(horo_clock_t* clock, horo_entry_t* entry)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    checkpointSlot_t* slot = NULL;
+    uint32_t index = 0;
+    uint32_t stamp = 0;
+
+    detachCheckpoint(clock, entry);
+    if((clock->checkpoint == NULL) || (ENTRY_KEY(entry) == NULL))
+    {
+        return HORO_SUCCESS;
+    }
+
+    err = findCheckpointSlot(clock, entry->extra->key, &index);
+    if(err) return err;
+
+    slot = &clock->checkpoint->slots[index];
+    stamp = slot->stamp;
+    if(stamp & RUNTIME_STAMP_VALID)
+    {
+        entry->lastRunStamp = stamp;
+    }
+    slot->generation = clock->checkpoint->generation;
+    clock->checkpoint->refs[index]++;
+    entry->extra->checkpointStamp = &slot->stamp;
+
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_openCheckpoint(horo_clock_t* clock, const char* path, size_t capacity)
+{
+#ifdef _WIN32
+    return HORO_ERROR_NOT_SUPPORTED;
+#else
+    HORO_ERROR ret = HORO_SUCCESS;
+    HORO_ERROR attachError = HORO_SUCCESS;
+    struct horoCheckpoint* checkpoint = NULL;
+    checkpointHeader_t* header = NULL;
+    horoContainerNode_t* node = NULL;
+    struct stat fileStat;
+    uint32_t slots = CHECKPOINT_MIN_CAPACITY;
+    int created = 0;
+    int fd = -1;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(path == NULL);
+    RETURN_ILLEGAL_IF((capacity == 0) || (capacity > ((size_t)1 << 30)));
+
+    horo_closeCheckpoint(clock);
+
+    checkpoint = (struct horoCheckpoint*)calloc(1, sizeof(struct horoCheckpoint));
+    if(checkpoint == NULL)
+    {
+        ret = HORO_ERROR_NO_MEM;
+        goto DONE;
+    }
+    checkpoint->base = MAP_FAILED;
+    checkpoint->path = (char*)malloc(strlen(path) + 1);
+    if(checkpoint->path == NULL)
+    {
+        ret = HORO_ERROR_NO_MEM;
+        goto DONE;
+    }
+    strcpy(checkpoint->path, path);
+
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if((fd < 0) || (fstat(fd, &fileStat) != 0))
+    {
+        ret = HORO_ERROR_IO;
+        goto DONE;
+    }
+
+    if(fileStat.st_size == 0)
+    {
+        //'capacity' keys stay below the load factor that triggers a rebuild
+        while((uint64_t)slots * 3 < (uint64_t)capacity * 4)
+        {
+            slots *= 2;
+        }
+        checkpoint->size = sizeof(checkpointHeader_t) + (slots * sizeof(checkpointSlot_t));
+        if(ftruncate(fd, (off_t)checkpoint->size) != 0)
+        {
+            ret = HORO_ERROR_IO;
+            goto DONE;
+        }
+        created = 1;
+    }
+    else
+    {
+        checkpoint->size = (size_t)fileStat.st_size;
+        if(checkpoint->size < sizeof(checkpointHeader_t))
+        {
+            ret = HORO_ERROR_CORRUPT;
+            goto DONE;
+        }
+    }
+
+    checkpoint->base = mmap(NULL, checkpoint->size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+    if(checkpoint->base == MAP_FAILED)
+    {
+        ret = HORO_ERROR_IO;
+        goto DONE;
+    }
+
+    header = (checkpointHeader_t*)checkpoint->base;
+    if(created)
+    {
+        header->version = CHECKPOINT_VERSION;
+        header->capacity = slots;
+        header->generation = 0;
+        header->numSlots = 0;
+        memcpy(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic));
+    }
+    else if(memcmp(header->magic, CHECKPOINT_MAGIC, sizeof(header->magic)) != 0)
+    {
+        ret = HORO_ERROR_CORRUPT;
+        goto DONE;
+    }
+    else if(header->version != CHECKPOINT_VERSION)
+    {
+        ret = HORO_ERROR_UNSUPPORTED_VERSION;
+        goto DONE;
+    }
+    else if((header->capacity == 0) ||
+            (header->capacity & (header->capacity - 1)) ||
+            (header->numSlots >= header->capacity) ||
+            (checkpoint->size != (sizeof(checkpointHeader_t) +
+                                  (header->capacity * sizeof(checkpointSlot_t)))))
+    {
+        ret = HORO_ERROR_CORRUPT;
+        goto DONE;
+    }
+
+    checkpoint->refs = (uint32_t*)calloc(header->capacity, sizeof(uint32_t));
+    if(checkpoint->refs == NULL)
+    {
+        ret = HORO_ERROR_NO_MEM;
+        goto DONE;
+    }
+
+    header->generation++;
+    checkpoint->generation = header->generation;
+    checkpoint->capacity = header->capacity;
+    checkpoint->header = header;
+    checkpoint->slots = (checkpointSlot_t*)(header + 1);
+    clock->checkpoint = checkpoint;
+
+    for(node = clock->entries.head; node != NULL; node = node->next)
+    {
+        attachError = attachCheckpoint(clock, (horo_entry_t*)node->data);
+        if(attachError && !ret) ret = attachError;
+    }
+
+DONE:
+    if(fd >= 0)
+    {
+        close(fd);
+    }
+    if((clock->checkpoint != checkpoint) && (checkpoint != NULL))
+    {
+        if(checkpoint->base != MAP_FAILED)
+        {
+            munmap(checkpoint->base, checkpoint->size);
+        }
+        free(checkpoint->path);
+        free(checkpoint->refs);
+        free(checkpoint);
+    }
+    return ret;
+#endif
+}
+
+HORO_ERROR
+horo_closeCheckpoint(horo_clock_t* clock)
+{
+    horoContainerNode_t* node = NULL;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    if(clock->checkpoint == NULL)
+    {
+        return HORO_SUCCESS;
+    }
+
+    for(node = clock->entries.head; node != NULL; node = node->next)
+    {
+        horo_entry_t* entry = (horo_entry_t*)node->data;
+
+        if(entry->extra != NULL)
+        {
+            entry->extra->checkpointStamp = NULL;
+        }
+    }
+
+#ifndef _WIN32
+    munmap(clock->checkpoint->base, clock->checkpoint->size);
+#endif
+    free(clock->checkpoint->path);
+    free(clock->checkpoint->refs);
+    free(clock->checkpoint);
+    clock->checkpoint = NULL;
+
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_setActionKey(horo_clock_t* clock, int actionID, const char* key)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_entry_t* entry = NULL;
+    char* keyCopy = NULL;
+    char* oldKey = NULL;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+
+    entry = findEntry(clock, actionID);
+    if(entry == NULL)
+    {
+        return HORO_ERROR_UNKNOWN_ACTION;
+    }
+
+    if(key != NULL)
+    {
+        if(entryExtra(entry) == NULL)
+        {
+            return HORO_ERROR_NO_MEM;
+        }
+        keyCopy = (char*)malloc(strlen(key) + 1);
+        if(keyCopy == NULL)
+        {
+            return HORO_ERROR_NO_MEM;
+        }
+        strcpy(keyCopy, key);
+    }
+
+    //Without extra fields the entry has no key to remove
+    if(entry->extra == NULL)
+    {
+        return HORO_SUCCESS;
+    }
+
+    oldKey = entry->extra->key;
+    entry->extra->key = keyCopy;
+
+    err = attachCheckpoint(clock, entry);
+    if(err)
+    {
+        entry->extra->key = oldKey;
+        attachCheckpoint(clock, entry);
+        free(keyCopy);
+        return err;
+    }
+
+    free(oldKey);
+    return HORO_SUCCESS;
+}
+
+#define SNAPSHOT_MAGIC "HORO"
+#define SNAPSHOT_VERSION 5
+#define SNAPSHOT_BYTE_ORDER 0x0102
+#define SNAPSHOT_BATCH 64
+
+typedef struct
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t byteOrder;
+    uint32_t headerSize;
+    uint32_t recordSize;
+    uint64_t numEntries;
+    uint64_t nextActionID;
+    uint64_t keyTableSize;
+}snapshotHeader_t;
+
+typedef struct
+{
+    uint64_t id;
+    uint64_t minute;
+    uint64_t hour;
+    uint64_t dayOfMonth;
+    uint64_t month;
+    uint64_t dayOfWeek;
+    uint64_t second;
+    int32_t lastRuntime[6];
+    uint32_t keyOffset;
+    uint32_t keyLength;
+
+    /*Zone name in the string table, an empty name is local time*/
+    uint32_t zoneOffset;
+    uint32_t zoneLength;
+
+    uint32_t dstPolicy;
+    uint32_t lastRunRepeated;
+    uint32_t oneShot;
+
+    /*Zero in snapshots written before actions could be disabled*/
+    uint32_t disabled;
+}snapshotRecord_t;
+
+static const char*
+entryZoneName(horo_clock_t* clock, horo_entry_t const* entry)
 {
+    return (entry->group == LOCAL_GROUP) ? "" : clock->groups[entry->group]->zone->name;
+}
+
+HORO_ERROR
+horo_serialize(horo_clock_t* clock, horo_writeFunc writer, void* userp)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    snapshotHeader_t header;
+    snapshotRecord_t records[SNAPSHOT_BATCH];
+    size_t numRecords = 0;
+    uint64_t keyTableSize = 0;
+    horoContainerNode_t* node = NULL;
+    static const char padding[8] = {0};
+
     RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(writer == NULL);
+
+    for(node = clock->entries.head; node != NULL; node = node->next)
+    {
+        horo_entry_t const* entry = (horo_entry_t const*)node->data;
+        keyTableSize += (ENTRY_KEY(entry) ? strlen(entry->extra->key) : 0) + 1;
+        keyTableSize += strlen(entryZoneName(clock, entry)) + 1;
+    }
+    if(keyTableSize > UINT32_MAX)
+    {
+        return HORO_ERROR_OUT_OF_RANGE;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.headerSize = sizeof(snapshotHeader_t);
+    header.recordSize = sizeof(snapshotRecord_t);
+    header.numEntries = clock->entries.numElements;
+    header.nextActionID = clock->nextActionID;
+    header.keyTableSize = keyTableSize;
+
+    ret = writer(userp, &header, sizeof(header));
+    if(ret) goto DONE;
+
+    keyTableSize = 0;
+    for(node = clock->entries.head; node != NULL; node = node->next)
+    {
+        horo_entry_t const* entry = (horo_entry_t const*)node->data;
+        snapshotRecord_t* record = &records[numRecords++];
+        size_t keyLength = ENTRY_KEY(entry) ? strlen(entry->extra->key) : 0;
+        CronVals cronVals;
+        horo_time_t lastRuntime;
+
+        unpackCronVals(&entry->scheduleVals, &cronVals);
+        memset(&lastRuntime, 0, sizeof(lastRuntime));
+        if(entry->lastRunStamp & RUNTIME_STAMP_VALID)
+        {
+            unpackRuntime(entry->lastRunStamp, &lastRuntime);
+        }
+
+        memset(record, 0, sizeof(*record));
+        record->id = entry->id;
+        record->minute = cronVals.minute;
+        record->hour = cronVals.hour;
+        record->dayOfMonth = cronVals.dayOfMonth;
+        record->month = cronVals.month;
+        record->dayOfWeek = cronVals.dayOfWeek;
+        record->second = cronVals.second;
+        record->lastRuntime[0] = lastRuntime.minute;
+        record->lastRuntime[1] = lastRuntime.hour;
+        record->lastRuntime[2] = lastRuntime.dayOfMonth;
+        record->lastRuntime[3] = lastRuntime.month;
+        record->lastRuntime[4] = lastRuntime.dayOfWeek;
+        record->lastRuntime[5] = lastRuntime.second;
+        record->keyOffset = (uint32_t)keyTableSize;
+        record->keyLength = (uint32_t)keyLength;
+        keyTableSize += keyLength + 1;
+        record->zoneOffset = (uint32_t)keyTableSize;
+        record->zoneLength = (uint32_t)strlen(entryZoneName(clock, entry));
+        keyTableSize += record->zoneLength + 1;
+        record->dstPolicy = (uint32_t)entry->dstPolicy;
+        record->lastRunRepeated = (uint32_t)entry->lastRunRepeated;
+        record->oneShot = (uint32_t)entry->oneShot;
+        record->disabled = (uint32_t)entry->disabled;
+
+        if((numRecords == SNAPSHOT_BATCH) || (node->next == NULL))
+        {
+            ret = writer(userp, records, numRecords * sizeof(snapshotRecord_t));
+            if(ret) goto DONE;
+            numRecords = 0;
+        }
+    }
+
+    for(node = clock->entries.head; node != NULL; node = node->next)
+    {
+        horo_entry_t const* entry = (horo_entry_t const*)node->data;
+        const char* key = ENTRY_KEY(entry) ? entry->extra->key : "";
+        const char* zoneName = entryZoneName(clock, entry);
+
+        ret = writer(userp, key, strlen(key) + 1);
+        if(ret) goto DONE;
+        ret = writer(userp, zoneName, strlen(zoneName) + 1);
+        if(ret) goto DONE;
+    }
+
+    if(keyTableSize % 8)
+    {
+        ret = writer(userp, padding, 8 - (keyTableSize % 8));
+    }
+
+DONE:
+    return ret;
+}
+
+static void
+destroyEntries(horo_clock_t* clock)
+{
+    horoContainerNode_t *node = NULL;
+    size_t i = 0;
+
+    for(node = clock->entries.head; node != NULL; node = node->next)
+    {
+        detachCheckpoint(clock, (horo_entry_t*)node->data);
+        releaseEntry((horo_entry_t*)node->data);
+    }
     horoList_destroyNodes(&clock->entries);
+
+    free(clock->entryIndex.slots);
+    memset(&clock->entryIndex, 0, sizeof(clock->entryIndex));
+
+    for(i = 0; i < clock->numGroups; i++)
+    {
+        clearGroup(clock->groups[i]);
+    }
+}
+
+HORO_ERROR
+horo_deserialize(horo_clock_t* clock, const void* snapshot, size_t size,
+                 horo_resolveFunc resolver, horo_releaseFunc release,
+                 void* userp)
+{
+    HORO_ERROR ret = HORO_SUCCESS;
+    horoContainerNode_t* node = NULL;
+    void* pendingData = NULL;
+    int pending = 0;
+    snapshotHeader_t header;
+    const unsigned char* bytes = (const unsigned char*)snapshot;
+    const unsigned char* records = NULL;
+    const char* keyTable = NULL;
+    size_t group = 0;
+    uint64_t i = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+    RETURN_ILLEGAL_IF(snapshot == NULL);
+    RETURN_ILLEGAL_IF(resolver == NULL);
+    RETURN_ILLEGAL_IF(clock->entries.numElements != 0);
+
+    if(size < sizeof(header))
+    {
+        return HORO_ERROR_CORRUPT;
+    }
+    memcpy(&header, bytes, sizeof(header));
+
+    if(memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0)
+    {
+        return HORO_ERROR_CORRUPT;
+    }
+    if((header.version != SNAPSHOT_VERSION) ||
+       (header.byteOrder != SNAPSHOT_BYTE_ORDER) ||
+       (header.headerSize != sizeof(snapshotHeader_t)) ||
+       (header.recordSize != sizeof(snapshotRecord_t)))
+    {
+        return HORO_ERROR_UNSUPPORTED_VERSION;
+    }
+    if((header.numEntries > ((size - sizeof(header)) / sizeof(snapshotRecord_t))) ||
+       (header.keyTableSize > (size - sizeof(header) -
+                               (header.numEntries * sizeof(snapshotRecord_t)))))
+    {
+        return HORO_ERROR_CORRUPT;
+    }
+
+    records = bytes + sizeof(header);
+    keyTable = (const char*)(records + (header.numEntries * sizeof(snapshotRecord_t)));
+
+    for(i = 0; i < header.numEntries; i++)
+    {
+        snapshotRecord_t record;
+        horo_entry_t newEntry;
+        CronVals cronVals;
+        horo_time_t lastRuntime;
+
+        memcpy(&record, records + (i * sizeof(snapshotRecord_t)), sizeof(record));
+        if(((uint64_t)record.keyOffset + record.keyLength >= header.keyTableSize) ||
+           (keyTable[record.keyOffset + record.keyLength] != '\0') ||
+           ((uint64_t)record.zoneOffset + record.zoneLength >= header.keyTableSize) ||
+           (keyTable[record.zoneOffset + record.zoneLength] != '\0') ||
+           (record.dstPolicy > HORO_DST_RUN_TWICE) ||
+           (record.id >= header.nextActionID) ||
+           (entryIndex_find(&clock->entryIndex, record.id) != NULL))
+        {
+            ret = HORO_ERROR_CORRUPT;
+            goto DONE;
+        }
+
+        memset(&newEntry, 0, sizeof(newEntry));
+        ret = resolver(userp, keyTable + record.keyOffset,
+                       &newEntry.action, &newEntry.actionData);
+        if(ret) goto DONE;
+        if(newEntry.action == NULL) continue;
+
+        //Released on error until the entry holds it
+        pendingData = newEntry.actionData;
+        pending = 1;
+
+        newEntry.id = record.id;
+        cronVals.minute = record.minute;
+        cronVals.hour = record.hour;
+        cronVals.dayOfMonth = record.dayOfMonth;
+        cronVals.month = record.month;
+        cronVals.dayOfWeek = record.dayOfWeek;
+        cronVals.second = record.second;
+        packCronVals(&cronVals, &newEntry.scheduleVals);
+
+        lastRuntime.minute = record.lastRuntime[0];
+        lastRuntime.hour = record.lastRuntime[1];
+        lastRuntime.dayOfMonth = record.lastRuntime[2];
+        lastRuntime.month = record.lastRuntime[3];
+        lastRuntime.dayOfWeek = record.lastRuntime[4];
+        lastRuntime.second = record.lastRuntime[5];
+        if(validateHoroTime(&lastRuntime) == HORO_SUCCESS)
+        {
+            newEntry.lastRunStamp = packRuntime(&lastRuntime);
+        }
+        newEntry.dstPolicy = (uint8_t)record.dstPolicy;
+        newEntry.lastRunRepeated = (record.lastRunRepeated != 0);
+        newEntry.oneShot = (record.oneShot != 0);
+        newEntry.disabled = (record.disabled != 0);
+
+        ret = findGroup(clock, (record.zoneLength > 0) ? keyTable + record.zoneOffset : NULL,
+                        &group);
+        if(ret) goto DONE;
+        newEntry.group = (uint16_t)group;
+
+        if(record.keyLength > 0)
+        {
+            if(entryExtra(&newEntry) != NULL)
+            {
+                newEntry.extra->key = (char*)malloc(record.keyLength + 1);
+            }
+            if(ENTRY_KEY(&newEntry) == NULL)
+            {
+                releaseEntry(&newEntry);
+                ret = HORO_ERROR_NO_MEM;
+                goto DONE;
+            }
+            memcpy(newEntry.extra->key, keyTable + record.keyOffset, record.keyLength + 1);
+        }
+
+        ret = attachCheckpoint(clock, &newEntry);
+        if(ret)
+        {
+            releaseEntry(&newEntry);
+            goto DONE;
+        }
+
+        ret = addEntry(clock, &newEntry, NULL);
+        if(ret)
+        {
+            detachCheckpoint(clock, &newEntry);
+            releaseEntry(&newEntry);
+            goto DONE;
+        }
+        pending = 0;
+    }
+
+    clock->nextActionID = header.nextActionID;
+
+DONE:
+    if(ret && (release != NULL))
+    {
+        if(pending) release(userp, pendingData);
+        for(node = clock->entries.head; node != NULL; node = node->next)
+        {
+            release(userp, ((horo_entry_t*)node->data)->actionData);
+        }
+    }
+    if(ret)
+    {
+        destroyEntries(clock);
+    }
+    return ret;
+}
+
+HORO_ERROR
+horo_setTraceHooks(horo_clock_t* clock, horo_traceFunc begin,
+                   horo_traceFunc end, void* userp)
+{
+    RETURN_ILLEGAL_IF(clock == NULL);
+
+    clock->traceBegin = begin;
+    clock->traceEnd = end;
+    clock->traceUserp = userp;
+    return HORO_SUCCESS;
+}
+
+HORO_ERROR
+horo_destroy(horo_clock_t* clock)
+{
+    size_t i = 0;
+
+    RETURN_ILLEGAL_IF(clock == NULL);
+
+    horo_closeCheckpoint(clock);
+    destroyEntries(clock);
+
+    for(i = 0; i < clock->numGroups; i++)
+    {
+        if(i != LOCAL_GROUP) horoZone_free(clock->groups[i]->zone);
+        free(clock->groups[i]);
+    }
+    free(clock->groups);
+
+    for(i = 0; i < clock->numLimitGroups; i++)
+    {
+        int level = 0;
+
+        for(; level <= HORO_GROUP_MAX_PRIORITY; level++)
+        {
+            free(clock->limitGroups[i]->levels[level].ids);
+        }
+        free(clock->limitGroups[i]);
+    }
+    free(clock->limitGroups);
+    free(clock->deferredAdds.entries);
+    free(clock->deferredReschedules);
     free(clock);
 
     return HORO_SUCCESS;
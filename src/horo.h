@@ -6,7 +6,30 @@
 #ifndef HORO_H
 #define HORO_H
 
+#include <stddef.h>
 #include <stdint.h>
+#include <time.h>
+
+/*
+ * Linkage of the public functions.  Defining HORO_STATIC before including
+ * horo-single.h makes them static, see the top of that file.
+ */
+#ifndef HORO_API
+#ifdef HORO_STATIC
+#ifdef __GNUC__
+#define HORO_API static __attribute__((unused))
+#else
+#define HORO_API static
+#endif
+#else
+#define HORO_API extern
+#endif
+#endif
+
+/*Linkage of the library's internal functions, static in horo-single.h*/
+#ifndef HORO_INTERNAL
+#define HORO_INTERNAL
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -55,7 +78,25 @@ typedef enum
 
     /** Returned by horo_unscheduleAction() when the given actionID cannot
      * be found. */
-    HORO_ERROR_UNKNOWN_ACTION = 0xC
+    HORO_ERROR_UNKNOWN_ACTION = 0xC,
+
+    /** A snapshot was written by an incompatible version of libhoro */
+    HORO_ERROR_UNSUPPORTED_VERSION = 0xD,
+
+    /** The operation is not available on this platform */
+    HORO_ERROR_NOT_SUPPORTED = 0xE,
+
+    /** A file could not be opened, mapped or resized */
+    HORO_ERROR_IO = 0xF,
+
+    /** The seconds field of a six field schedule is out of range */
+    HORO_ERROR_PARSER_SECOND_RANGE = 0x10,
+
+    /** The time zone is not known to the system's zoneinfo database */
+    HORO_ERROR_UNKNOWN_ZONE = 0x11,
+
+    /** The group has not been created with horo_setGroupLimits() */
+    HORO_ERROR_UNKNOWN_GROUP = 0x12
 }HORO_ERROR;
 
 
@@ -76,9 +117,46 @@ struct horo_time
     int dayOfMonth; /**< 1-31*/
     int month; /**< 1-12*/
     int dayOfWeek; /**< 0-7 (0 or 7 is Sun)*/
+    int second; /**< 0-60, ignored unless the clock has schedules with a
+                     seconds field.  60 (a leap second) counts as 59.*/
 };
 typedef struct horo_time horo_time_t;
 
+/**
+ * Summary of a log bucketed histogram.  All values are in microseconds.
+ * The percentiles are accurate to within ~2% of the recorded values.
+ */
+struct horo_histogram_summary
+{
+    uint64_t count; /**< Number of recorded values*/
+    uint64_t min;
+    uint64_t max;
+    uint64_t mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+};
+typedef struct horo_histogram_summary horo_histogram_summary_t;
+
+/**
+ * Execution statistics of a single action.
+ *
+ * @see horo_getActionStats()
+ */
+struct horo_action_stats
+{
+    /** Time between the scheduled time (wall clock) and the moment the
+     * action callback was called.  The scheduled time is the start of the
+     * minute, or the second of the tick if the clock has schedules with a
+     * seconds field. */
+    horo_histogram_summary_t lateness;
+
+    /** Time spent inside of the action callback. */
+    horo_histogram_summary_t duration;
+};
+typedef struct horo_action_stats horo_action_stats_t;
+
 /**
  * Type definition for an action callback.  Actions
  * are linked to a horo_clock_t and scheduled for
@@ -86,6 +164,193 @@ typedef struct horo_time horo_time_t;
  */
 typedef void (*horo_actionFunc)(void* actionData);
 
+/**
+ * The kind of work a trace event describes.
+ *
+ * @see horo_setTraceHooks()
+ */
+typedef enum
+{
+    /** A call to horo_process() */
+    HORO_TRACE_PROCESS = 0x0,
+
+    /** The execution of a single action by horo_process() */
+    HORO_TRACE_ACTION = 0x1,
+
+    /** The parsing of a schedule string by horo_scheduleAction() */
+    HORO_TRACE_PARSE = 0x2
+}HORO_TRACE_TYPE;
+
+/**
+ * What an action scheduled in a time zone does when the zone's wall clock
+ * jumps for daylight saving time.  Actions in local time have no policy,
+ * they run whenever the time fields they are given match.
+ *
+ * @see horo_setActionDstPolicy()
+ */
+typedef enum
+{
+    /** Wall clock times skipped by springing forward run once, on the
+     * first tick after the jump.  Wall clock times repeated after falling
+     * back only run the first time they are seen.  The action runs exactly
+     * once for every wall clock time that matches its schedule.  This is
+     * the default. */
+    HORO_DST_RUN_ONCE = 0x0,
+
+    /** Skipped wall clock times do not run.  Repeated wall clock times
+     * only run the first time they are seen. */
+    HORO_DST_SKIP = 0x1,
+
+    /** Skipped wall clock times do not run.  Repeated wall clock times run
+     * both times they are seen, the action follows elapsed time. */
+    HORO_DST_RUN_TWICE = 0x2
+}HORO_DST_POLICY;
+
+/**
+ * The order in which the queued actions of a group run.
+ *
+ * @see horo_setGroupLimits()
+ */
+typedef enum
+{
+    /** In the order they fired, priorities are ignored */
+    HORO_GROUP_FIFO = 0x0,
+
+    /** Highest priority first, in the order they fired within a priority */
+    HORO_GROUP_PRIORITY = 0x1
+}HORO_GROUP_ORDER;
+
+/**
+ * Which action a full group queue gives up.  Of the queued actions and the
+ * one that just fired, only those of the lowest priority are candidates
+ * (with HORO_GROUP_FIFO that is all of them).
+ *
+ * @see horo_setGroupLimits()
+ */
+typedef enum
+{
+    /** The candidate that fired last, so a flood can not push out work
+     * that is already waiting.  This is the default. */
+    HORO_GROUP_DROP_NEWEST = 0x0,
+
+    /** The candidate that fired first, so the queue holds the most recent
+     * work. */
+    HORO_GROUP_DROP_OLDEST = 0x1
+}HORO_GROUP_OVERFLOW;
+
+/** Priorities of actions in a group are 0 (the default) up to this value */
+#define HORO_GROUP_MAX_PRIORITY 7
+
+/**
+ * Admission limits of a group of actions.
+ *
+ * @see horo_setGroupLimits()
+ */
+struct horo_group_limits
+{
+    /** Actions of the group that may be in flight at once, at least 1 */
+    int maxInFlight;
+
+    /** Actions that wait for a free slot, 0 to drop whatever does not fit */
+    int maxPending;
+
+    HORO_GROUP_ORDER order;
+    HORO_GROUP_OVERFLOW overflow;
+};
+typedef struct horo_group_limits horo_group_limits_t;
+
+/**
+ * Counters of a group.
+ *
+ * @see horo_getGroupStats()
+ */
+struct horo_group_stats
+{
+    /** Actions called and not yet reported by horo_groupActionDone() */
+    int inFlight;
+
+    /** Actions waiting for a slot */
+    int pending;
+
+    /** Actions called since the group was created */
+    uint64_t dispatched;
+
+    /** Actions that fired while all slots were taken */
+    uint64_t queued;
+
+    /** Actions dropped by the overflow policy or because they were already
+     * waiting when they fired again */
+    uint64_t dropped;
+};
+typedef struct horo_group_stats horo_group_stats_t;
+
+/**
+ * Passed to the trace hooks.  Fields that do not apply to the event
+ * type are zero.
+ */
+struct horo_trace_event
+{
+    HORO_TRACE_TYPE type;
+
+    /** The action being executed (HORO_TRACE_ACTION) */
+    int actionID;
+
+    /** The time passed to horo_process() (HORO_TRACE_PROCESS, HORO_TRACE_ACTION) */
+    horo_time_t const* timeVals;
+
+    /** The string being parsed (HORO_TRACE_PARSE).  It is not NUL
+     * terminated when it came from one of the ...N() functions, use
+     * scheduleLength. */
+    const char* scheduleString;
+
+    /** The length of scheduleString in bytes (HORO_TRACE_PARSE) */
+    size_t scheduleLength;
+
+    /** Schedule masks of the action (HORO_TRACE_ACTION) or the result of
+     * the parse (end of HORO_TRACE_PARSE). Bit N is set if value N is
+     * part of the schedule. */
+    uint64_t minuteMask;
+    uint64_t hourMask;
+    uint64_t dayOfMonthMask;
+    uint64_t monthMask;
+    uint64_t dayOfWeekMask;
+
+    /** Zero unless the schedule has a seconds field */
+    uint64_t secondMask;
+
+    /** Result of the operation.  Only set for end events. */
+    HORO_ERROR error;
+};
+typedef struct horo_trace_event horo_trace_event_t;
+
+/**
+ * Type definition for a trace hook.  Trace hooks are called
+ * synchronously so they must be cheap.
+ */
+typedef void (*horo_traceFunc)(void* userp, horo_trace_event_t const* event);
+
+/**
+ * Type definition for the output callback of horo_serialize().  It must
+ * consume all 'size' bytes or return an error.
+ */
+typedef HORO_ERROR (*horo_writeFunc)(void* userp, const void* data, size_t size);
+
+/**
+ * Type definition for the callback used by horo_deserialize() to turn the
+ * key of a restored action back into an action callback and its data.
+ * Setting *oAction to NULL skips the action.
+ */
+typedef HORO_ERROR (*horo_resolveFunc)(void* userp, const char* key,
+                                       horo_actionFunc* oAction,
+                                       void** oActionData);
+
+/**
+ * Type definition for the callback that gives back the action data a
+ * horo_resolveFunc returned, for an unscheduled crontab line or for the
+ * actions of a failed horo_deserialize().
+ */
+typedef void (*horo_releaseFunc)(void* userp, void* actionData);
+
 /**
  * Opaque data structure used to manage actions and their
  * schedules.
@@ -100,7 +365,7 @@ typedef struct horo_clock horo_clock_t;
  * resources must be returned to the system using horo_destroy
  * after the horo_clock is no longer needed.
  */
-HORO_ERROR
+HORO_API HORO_ERROR
 horo_init(horo_clock_t** oClock);
 
 /**
@@ -111,7 +376,10 @@ horo_init(horo_clock_t** oClock);
  * be attached.
  *
  * @param[in] scheduleString The cron based schedule string which
- * describes when the action will be executed.
+ * describes when the action will be executed.  An optional sixth, leading
+ * field gives the seconds of the minute, e.g. "0,30 * * * * *" runs twice a
+ * minute.  Schedules without it run once per minute, on the first call
+ * to horo_process() in that minute.
  *
  * @param[in] action The action callback function.
  *
@@ -120,11 +388,256 @@ horo_init(horo_clock_t** oClock);
  * @param[out] oActionID The id of the action so that it can be
  * unscheduled if necessary. 
  */
-HORO_ERROR
+HORO_API HORO_ERROR
 horo_scheduleAction(horo_clock_t* clock, const char *scheduleString, 
                      horo_actionFunc action, void *actionData,
                      int* oActionID);
 
+/**
+ * Like horo_scheduleAction() but for a schedule that is not NUL terminated,
+ * e.g. a slice of a crontab file or of a network buffer.  The schedule is
+ * parsed where it is, it is not copied and not searched for a terminator.
+ *
+ * @param[in] scheduleLength The length of scheduleString in bytes.
+ *
+ * @see horo_scheduleAction() for the other parameters.
+ */
+HORO_API HORO_ERROR
+horo_scheduleActionN(horo_clock_t* clock, const char *scheduleString,
+                     size_t scheduleLength, horo_actionFunc action,
+                     void *actionData, int* oActionID);
+
+/**
+ * Schedule an action in an IANA time zone, e.g. "America/New_York".
+ * Actions in a zone are only executed by horo_processUtc(), which converts
+ * the UTC time once per zone and tick.  Zones are read from the compiled
+ * zoneinfo files in $TZDIR (default /usr/share/zoneinfo) the first time the
+ * clock uses them.
+ *
+ * @param[in] zoneName The IANA name of the zone.
+ *
+ * @return HORO_ERROR_UNKNOWN_ZONE if the zone can not be loaded.
+ *
+ * @see horo_scheduleAction() for the other parameters.
+ */
+HORO_API HORO_ERROR
+horo_scheduleActionInZone(horo_clock_t* clock, const char *scheduleString,
+                          const char* zoneName, horo_actionFunc action,
+                          void *actionData, int* oActionID);
+
+/**
+ * horo_scheduleActionInZone() for a schedule that is not NUL terminated.
+ *
+ * @param[in] scheduleLength The length of scheduleString in bytes.
+ *
+ * @see horo_scheduleActionN()
+ */
+HORO_API HORO_ERROR
+horo_scheduleActionInZoneN(horo_clock_t* clock, const char *scheduleString,
+                           size_t scheduleLength, const char* zoneName,
+                           horo_actionFunc action, void *actionData,
+                           int* oActionID);
+
+/**
+ * One action of a horo_scheduleActions() batch.
+ */
+struct horo_schedule_req
+{
+    const char* scheduleString;
+
+    /** NULL for local time, see horo_scheduleActionInZone() */
+    const char* zoneName;
+
+    horo_actionFunc action;
+    void* actionData;
+};
+typedef struct horo_schedule_req horo_schedule_req_t;
+
+/**
+ * Schedule a batch of actions.  Either every action is scheduled or none
+ * is.  All schedule strings are parsed before anything is added and the
+ * clock's internal arrays grow once for the whole batch.
+ *
+ * @param[in] clock The clock the actions are attached to.
+ *
+ * @param[in] reqs 'numReqs' actions to schedule.
+ *
+ * @param[out] oActionIDs 'numReqs' ids, oActionIDs[i] is the id of reqs[i].
+ *
+ * @param[out] oErrors Optional, 'numReqs' results.  oErrors[i] is the error
+ * of reqs[i], requests that did not fail are HORO_SUCCESS.
+ *
+ * @return The error of the first failed request.
+ */
+HORO_API HORO_ERROR
+horo_scheduleActions(horo_clock_t* clock, horo_schedule_req_t const* reqs,
+                     size_t numReqs, int* oActionIDs, HORO_ERROR* oErrors);
+
+/**
+ * Make an action one-shot: it is unscheduled right after it runs for the
+ * first time.
+ *
+ * @param[in] clock The clock structure that contains the action.
+ *
+ * @param[in] actionID The actionID from horo_scheduleAction.
+ *
+ * @param[in] oneShot Nonzero to unschedule the action after its next run.
+ */
+HORO_API HORO_ERROR
+horo_setActionOneShot(horo_clock_t* clock, int actionID, int oneShot);
+
+/**
+ * Set how an action scheduled with horo_scheduleActionInZone() handles the
+ * daylight saving time jumps of its zone.  horo_processUtc() finds the
+ * jumps in the zone's precomputed transition table, there is no need to
+ * compare the local times of successive ticks.  Actions in local time
+ * (horo_scheduleAction()) see whatever time fields they are given and
+ * ignore the policy.
+ *
+ * @param[in] clock The clock structure that contains the action.
+ *
+ * @param[in] actionID The actionID from horo_scheduleActionInZone.
+ *
+ * @param[in] policy One of the HORO_DST_POLICY values.
+ */
+HORO_API HORO_ERROR
+horo_setActionDstPolicy(horo_clock_t* clock, int actionID,
+                        HORO_DST_POLICY policy);
+
+/**
+ * Attach a stable, user supplied name to an action.  Action callbacks and
+ * action data are process specific, the key is what identifies the action
+ * in a snapshot (see horo_serialize()).
+ *
+ * @param[in] clock The clock structure that contains the action.
+ *
+ * @param[in] actionID The actionID from horo_scheduleAction.
+ *
+ * @param[in] key NUL terminated name.  The string is copied.  Passing NULL
+ * removes the key.
+ */
+HORO_API HORO_ERROR
+horo_setActionKey(horo_clock_t* clock, int actionID, const char* key);
+
+/**
+ * Replace the schedule of an action.  The action keeps its id, action data,
+ * key, statistics and the time it last ran.
+ *
+ * @param[in] clock The clock structure that contains the action.
+ *
+ * @param[in] actionID The actionID from horo_scheduleAction.
+ *
+ * @param[in] scheduleString The new crontab schedule.  On a parse error the
+ * action keeps its schedule.  Called from an action the new schedule is
+ * swapped in when the tick is done; HORO_ERROR_NO_MEM is returned here, the
+ * swap itself cannot fail.
+ */
+HORO_API HORO_ERROR
+horo_rescheduleAction(horo_clock_t* clock, int actionID, const char* scheduleString);
+
+/**
+ * horo_rescheduleAction() for a schedule that is not NUL terminated.
+ *
+ * @param[in] scheduleLength The length of scheduleString in bytes.
+ */
+HORO_API HORO_ERROR
+horo_rescheduleActionN(horo_clock_t* clock, int actionID,
+                       const char* scheduleString, size_t scheduleLength);
+
+/**
+ * Pause or resume an action.  A disabled action stays scheduled but is not
+ * executed and is left out of horo_forecast().
+ *
+ * @param[in] clock The clock structure that contains the action.
+ *
+ * @param[in] actionID The actionID from horo_scheduleAction.
+ *
+ * @param[in] enabled Zero to pause the action, nonzero to resume it.
+ */
+HORO_API HORO_ERROR
+horo_setActionEnabled(horo_clock_t* clock, int actionID, int enabled);
+
+/**
+ * Create a group of actions or change its limits.  An action in a group
+ * takes one of the group's maxInFlight slots when it is called and holds
+ * it until horo_groupActionDone() is called for the group, so a slot can
+ * follow work the action started, e.g. a child process.
+ *
+ * Actions of a group that fire while every slot is taken wait in the
+ * group's queue, of at most maxPending actions, and are called by
+ * horo_groupActionDone() as slots become free.  An action is in the queue
+ * at most once; firing again while it waits counts as a drop.  Actions of
+ * groups run after the ungrouped actions of their tick, in the order of
+ * the group.  Slots freed by those actions do not admit more of the tick's
+ * actions than maxPending.
+ *
+ * A checkpoint (see horo_openCheckpoint()) records a queued action when it
+ * is called, with the last time it fired; dropped runs are not recorded.
+ *
+ * Groups are not part of snapshots.  Lowering the limits does not drop
+ * queued actions or interrupt actions in flight.
+ *
+ * @param[in] clock The clock the group belongs to.
+ *
+ * @param[in] groupID A user chosen id, greater than 0.
+ *
+ * @param[in] limits The limits, copied.
+ */
+HORO_API HORO_ERROR
+horo_setGroupLimits(horo_clock_t* clock, int groupID,
+                    horo_group_limits_t const* limits);
+
+/**
+ * Put an action in a group.
+ *
+ * @param[in] clock The clock structure that contains the action.
+ *
+ * @param[in] actionID The actionID from horo_scheduleAction.
+ *
+ * @param[in] groupID A group created by horo_setGroupLimits(), or 0 to
+ * take the action out of its group.  A queued run of the action moves to
+ * the end of the new group's queue, it is dropped if the action is taken
+ * out of its group.  In a HORO_GROUP_PRIORITY group a new priority moves
+ * the queued run to the end of the runs of that priority.
+ *
+ * @param[in] priority 0 to HORO_GROUP_MAX_PRIORITY, higher runs first in
+ * HORO_GROUP_PRIORITY groups.
+ *
+ * @return HORO_ERROR_UNKNOWN_GROUP if the group does not exist.
+ */
+HORO_API HORO_ERROR
+horo_setActionGroup(horo_clock_t* clock, int actionID, int groupID,
+                    int priority);
+
+/**
+ * Free a slot of a group.  Call it once for every call of an action in the
+ * group, also for actions that finish within their callback, and also if
+ * the action has been unscheduled since.  Queued actions of the group are
+ * called before it returns unless it is called from an action, then they
+ * are called before horo_process() returns.
+ *
+ * @param[in] clock The clock the group belongs to.
+ *
+ * @param[in] groupID The group of the action that finished.
+ *
+ * @return HORO_ERROR_ILLEGAL_ARG if no action of the group is in flight.
+ */
+HORO_API HORO_ERROR
+horo_groupActionDone(horo_clock_t* clock, int groupID);
+
+/**
+ * Retrieve the counters of a group.
+ *
+ * @param[in] clock The clock the group belongs to.
+ *
+ * @param[in] groupID The group.
+ *
+ * @param[out] oStats Filled in with the group's counters.
+ */
+HORO_API HORO_ERROR
+horo_getGroupStats(horo_clock_t* clock, int groupID,
+                   horo_group_stats_t* oStats);
+
 /**
  * Unschedule an action.
  *
@@ -132,9 +645,27 @@ horo_scheduleAction(horo_clock_t* clock, const char *scheduleString,
  *
  * @param[in] actionID The actionID from horo_scheduleAction.
  */                     
-HORO_ERROR
+HORO_API HORO_ERROR
 horo_unscheduleAction(horo_clock_t* clock, int actionID);
 
+/**
+ * Unschedule a batch of actions with a single pass over the clock.  Either
+ * every action is unscheduled or none is.
+ *
+ * @param[in] clock The clock structure that contains the actions.
+ *
+ * @param[in] actionIDs 'numIDs' ids from horo_scheduleAction().
+ *
+ * @param[out] oErrors Optional, 'numIDs' results.  oErrors[i] is
+ * HORO_ERROR_UNKNOWN_ACTION if actionIDs[i] is not scheduled and
+ * HORO_ERROR_ILLEGAL_ARG if it is listed twice.
+ *
+ * @return The error of the first failed id.
+ */
+HORO_API HORO_ERROR
+horo_unscheduleActions(horo_clock_t* clock, const int* actionIDs, size_t numIDs,
+                       HORO_ERROR* oErrors);
+
 /**
  * The number of actions that are scheduled to be executed by 'clock'.
  *
@@ -142,9 +673,145 @@ horo_unscheduleAction(horo_clock_t* clock, int actionID);
  *
  * @param[out] oActionCount The number of actions attached to the clock.
  */
-HORO_ERROR
+HORO_API HORO_ERROR
 horo_actionCount(horo_clock_t* clock, int* oActionCount);
 
+/**
+ * Forecast how many actions will be executed in each minute of a time
+ * window.  The forecast is computed from the schedules of the attached
+ * actions, no actions are executed and the clock is not modified.
+ *
+ * Local time is broken down with localtime(), the same way the example
+ * driver loop of horo_process() does, actions scheduled in a zone use the
+ * zone's transition table.  Every minute in which a schedule matches is
+ * counted; the suppression of a repeated local minute during a daylight
+ * saving time fall back is not modelled.  Disabled actions are left out, as
+ * are actions scheduled by an action until horo_process() returns.
+ *
+ * @param[in] clock A clock structure to which the actions are attached.
+ *
+ * @param[in] from The start of the window.  It is rounded down to the start
+ * of its minute, also for times before 1970.
+ *
+ * @param[in] to The end of the window (exclusive).
+ *
+ * @param[out] oPerMinuteCounts Array of (to - start + 59) / 60 elements,
+ * where start is 'from' rounded down to its minute.  Element N receives the
+ * number of actions scheduled for the Nth minute of the window.
+ */
+HORO_API HORO_ERROR
+horo_forecast(horo_clock_t* clock, time_t from, time_t to,
+              uint32_t* oPerMinuteCounts);
+
+/**
+ * The result of horo_validate().
+ */
+typedef struct
+{
+    /** HORO_SUCCESS or the error horo_scheduleAction() would return */
+    HORO_ERROR error;
+
+    /** Byte offset of the field the error is in.  A missing field is
+     * reported at the end of the string with a length of 0. */
+    size_t offset;
+
+    /** Length of that field in bytes */
+    size_t length;
+}horo_validation_t;
+
+/**
+ * Check a schedule without scheduling it.  Only the parser and its range
+ * checks run: no clock is needed and nothing is allocated, which makes it
+ * cheap enough to lint large sets of schedules.
+ *
+ * !!NOTE: Like horo_scheduleAction() this is not thread safe, the parser is
+ * shared.
+ *
+ * @param[in] scheduleString The crontab schedule.  It does not need to be
+ * NUL terminated.
+ *
+ * @param[in] length The length of scheduleString in bytes.
+ *
+ * @param[out] oValidation Receives the error and, if there is one, where
+ * it is in scheduleString.
+ *
+ * @return The same as oValidation->error, or HORO_ERROR_ILLEGAL_ARG.
+ */
+HORO_API HORO_ERROR
+horo_validate(const char* scheduleString, size_t length,
+              horo_validation_t* oValidation);
+
+/**
+ * Size of a buffer that holds any schedule written by
+ * horo_canonicalizeSchedule(), including the NUL terminator.
+ */
+#define HORO_CANONICAL_SCHEDULE_MAX 512
+
+/**
+ * Rewrite a schedule in canonical form and fingerprint it.  Schedules that
+ * match the same times have the same canonical form and fingerprint, for
+ * example "0,15,30,45 * * * *" and "0-59/15 * * * *" are the same
+ * schedule and "@daily" becomes "0 0 * * *".  Fields that cover
+ * every value are written as '*', evenly spaced values as a range with a
+ * step, runs of three or more values as ranges and the other values as
+ * numbers.  Sunday is written as 0, a day of week of 7 has the canonical
+ * form and fingerprint of 0.  The canonical form parses back to the same
+ * schedule, apart from 7 turning into 0.
+ *
+ * The fingerprint is the 64-bit FNV-1a hash of the canonical minute, hour,
+ * day of month, month, day of week and seconds masks, in that order and as
+ * little endian bytes.  It is the same in every process and on every
+ * platform, so it can be used as a persistent key.
+ *
+ * @param[in] scheduleString The crontab schedule.
+ *
+ * @param[out] oCanonical Optional, receives the NUL terminated canonical form.
+ *
+ * @param[in] canonicalSize The size of oCanonical.
+ * HORO_CANONICAL_SCHEDULE_MAX is always enough.
+ *
+ * @param[out] oFingerprint Optional, receives the fingerprint.
+ *
+ * @return HORO_ERROR_ILLEGAL_ARG if the canonical form does not fit in
+ * oCanonical, else the result of parsing the schedule.
+ */
+HORO_API HORO_ERROR
+horo_canonicalizeSchedule(const char* scheduleString, char* oCanonical,
+                          size_t canonicalSize, uint64_t* oFingerprint);
+
+/**
+ * Type definition for the callback of horo_queryWindow().  Returning an
+ * error stops the query, horo_queryWindow() returns that error.
+ */
+typedef HORO_ERROR (*horo_windowFunc)(void* userp, int actionID, time_t fireTime);
+
+/**
+ * List the times at which the attached actions fire in a time window, in
+ * chronological order.  Actions firing at the same time are listed by
+ * increasing id.  The times are found from the schedules, no actions are
+ * executed and the clock is not modified.  The cost grows with the number
+ * of actions and of times listed, not with the length of the window.
+ *
+ * Local time is broken down with localtime() once per hour of the window,
+ * zones use their transition tables.  The rules of horo_forecast() apply:
+ * every wall clock time that matches is listed, including both passes
+ * through a repeated hour, and disabled actions and actions scheduled by a
+ * running action are left out.
+ *
+ * @param[in] clock A clock structure to which the actions are attached.
+ *
+ * @param[in] from The start of the window.
+ *
+ * @param[in] to The end of the window (exclusive).
+ *
+ * @param[in] callback Called once per (action, time) pair.
+ *
+ * @param[in] userp Passed to 'callback'.
+ */
+HORO_API HORO_ERROR
+horo_queryWindow(horo_clock_t* clock, time_t from, time_t to,
+                 horo_windowFunc callback, void* userp);
+
 /**
  * The asynchronous interface to libhoro. This function must be called at least
  * every minute.  If it is not called at least every minute than any action scheduled
@@ -154,6 +821,18 @@ horo_actionCount(horo_clock_t* clock, int* oActionCount);
  * !!NOTE: libhoro knows nothing about threads and is not thread safe.
  * horo_process() must always be called by the same thread.
  *
+ * Actions with a seconds field are only executed if horo_process() is called
+ * in their second, so clocks that have them must be processed every second.
+ * Each tick only looks at the actions due in its second; actions without a
+ * seconds field are only inspected once per minute.
+ *
+ * Actions may schedule and unschedule actions, including themselves.  Actions
+ * they schedule get their id right away but do not run before the next
+ * call.  Actions they unschedule do not run anymore and are removed when
+ * the call returns.  Schedules they change with horo_rescheduleAction() are
+ * swapped in when the call returns.  Calling horo_process() from an action
+ * returns HORO_ERROR_ILLEGAL_ARG.
+ *
  * @param[in] clock A clock structure to which the actions are attached.
  *
  * @param[in] timeVals A horo_time_t structure that is used by the scheduler as the
@@ -191,22 +870,395 @@ horo_actionCount(horo_clock_t* clock, int* oActionCount);
  *
  *
  *       horoTime.dayOfWeek = timeinfo->tm_wday;
+ *       horoTime.second = timeinfo->tm_sec;
  *       err = horo_process(clock, &horoTime);
  *       
  *       //Do other stuff that takes less than 1 minute.
  *   }
  */
-HORO_ERROR
+HORO_API HORO_ERROR
 horo_process(horo_clock_t* clock, horo_time_t const* timeVals);
 
+/**
+ * Drive a clock from a UTC epoch instead of local time fields.  Actions
+ * scheduled with horo_scheduleAction() see the process' local time of
+ * 'utcSeconds', actions scheduled with horo_scheduleActionInZone() see the
+ * local time of their zone.  The same calling rules as for horo_process()
+ * apply.  Only actions in a zone follow a HORO_DST_POLICY, actions in the
+ * process' local time are matched against its local time like with
+ * horo_process(), times skipped by springing forward do not run.
+ *
+ * @param[in] clock The clock.
+ *
+ * @param[in] utcSeconds Seconds since 1970-01-01 00:00:00 UTC, e.g. time(NULL).
+ */
+HORO_API HORO_ERROR
+horo_processUtc(horo_clock_t* clock, int64_t utcSeconds);
+
+/**
+ * Enable or disable the collection of per action execution statistics.
+ * Statistics are disabled by default.  When enabled, every action that is
+ * called by horo_process() records its dispatch lateness and its run duration
+ * into a pair of histograms.  They take 1664 bytes per action, 24 more for
+ * an action without a key, allocated the first time the action executes,
+ * e.g. 67MB for 40000 actions.  Percentiles
+ * are within ~3% of the recorded values up to ~4.5 minutes, longer values
+ * count as 4.5 minutes.  min, max and mean are exact.
+ *
+ * Lateness is measured against the local wall clock, so it is only
+ * meaningful when horo_process() is driven with the current local time.
+ *
+ * @param[in] clock The clock for which statistics will be collected.
+ *
+ * @param[in] enable Non-zero to enable statistics, zero to disable them.
+ * Disabling statistics does not discard the values already recorded.
+ */
+HORO_API HORO_ERROR
+horo_enableActionStats(horo_clock_t* clock, int enable);
+
+/**
+ * Retrieve the execution statistics of an action.
+ *
+ * @param[in] clock The clock structure that contains the action.
+ *
+ * @param[in] actionID The actionID from horo_scheduleAction.
+ *
+ * @param[out] oStats Filled in with the action's statistics.  The counts
+ * are zero if the action has not executed while statistics were enabled.
+ */
+HORO_API HORO_ERROR
+horo_getActionStats(horo_clock_t* clock, int actionID,
+                    horo_action_stats_t* oStats);
+
+/**
+ * Install trace hooks on a clock.  'begin' is called before and 'end' after
+ * every horo_process() call, every action execution and every schedule
+ * string parse performed by the clock.  Either hook may be NULL.
+ *
+ * libhoro also provides USDT probes (provider "libhoro") for the same
+ * events when built with HORO_ENABLE_USDT.
+ *
+ * @param[in] clock The clock to trace.
+ *
+ * @param[in] begin Called when an operation starts.
+ *
+ * @param[in] end Called when an operation finishes.
+ *
+ * @param[in] userp Passed to the hooks unchanged.
+ */
+HORO_API HORO_ERROR
+horo_setTraceHooks(horo_clock_t* clock, horo_traceFunc begin,
+                   horo_traceFunc end, void* userp);
+
+/**
+ * Write a binary snapshot of the clock.  The snapshot contains the schedule
+ * masks, the ID, the last run time and the key of every action, so it can be
+ * restored without parsing any schedule strings and without executing
+ * actions a second time in the current minute.
+ *
+ * The format is versioned and uses native byte order.  It consists of a
+ * fixed size header, an array of fixed size 8 byte aligned entry records and
+ * a table of NUL terminated keys, so it can be used directly from an mmap()ed
+ * file.
+ *
+ * @param[in] clock The clock to save.
+ *
+ * @param[in] writer Called with consecutive pieces of the snapshot.
+ *
+ * @param[in] userp Passed to 'writer' unchanged.
+ */
+HORO_API HORO_ERROR
+horo_serialize(horo_clock_t* clock, horo_writeFunc writer, void* userp);
+
+/**
+ * Restore the actions of a snapshot created by horo_serialize() into a
+ * clock that has no actions attached.  Restored actions keep their IDs,
+ * keys and last run times.
+ *
+ * @param[in] clock An empty clock.
+ *
+ * @param[in] snapshot The snapshot bytes.
+ *
+ * @param[in] size Size of the snapshot in bytes.
+ *
+ * @param[in] resolver Called once for every action in the snapshot to
+ * provide the action callback and action data for the action's key.  An
+ * action without a key is passed an empty string.
+ *
+ * @param[in] release On error, called with the action data of every action
+ * 'resolver' provided, skipped actions excepted.  May be NULL.
+ *
+ * @param[in] userp Passed to 'resolver' and 'release' unchanged.
+ *
+ * @return HORO_ERROR_CORRUPT if the snapshot is malformed or lists an ID
+ * twice, HORO_ERROR_UNSUPPORTED_VERSION if it was written by an
+ * incompatible version, or the first error returned by 'resolver'.  On
+ * error the clock is left empty.
+ */
+HORO_API HORO_ERROR
+horo_deserialize(horo_clock_t* clock, const void* snapshot, size_t size,
+                 horo_resolveFunc resolver, horo_releaseFunc release,
+                 void* userp);
+
+/**
+ * Persist the last run time of every keyed action (see horo_setActionKey())
+ * in a memory mapped file so that a restarted process does not execute
+ * actions again in the minute in which they already ran.
+ *
+ * When the checkpoint is opened, and whenever a key is set afterwards, the
+ * action's last run time is restored from the file.  Every time an action
+ * is executed its run time is recorded with a single 32 bit store *before*
+ * the action callback is called.  Actions that wait in a group are recorded
+ * when they are called.  The file is never synced by libhoro; the
+ * shared mapping survives a crash of the process but not of the machine.
+ *
+ * POSIX only, HORO_ERROR_NOT_SUPPORTED is returned on other platforms.
+ *
+ * @param[in] clock The clock whose actions will be checkpointed.
+ *
+ * @param[in] path The checkpoint file.  It is created if it does not exist.
+ *
+ * The file grows as keys are added.  When it fills up it is rebuilt, by
+ * writing "<path>.tmp" and renaming it over the file.  The rebuild keeps the
+ * keys of the current actions and the keys the previous process had.  Keys
+ * of unscheduled actions, or of actions whose key changed, are dropped.
+ *
+ * @param[in] capacity The number of keys the file is sized for if it is
+ * created.  An existing file keeps its size until it is rebuilt.
+ */
+HORO_API HORO_ERROR
+horo_openCheckpoint(horo_clock_t* clock, const char* path, size_t capacity);
+
+/**
+ * Unmap the checkpoint file opened with horo_openCheckpoint().  This is done
+ * automatically by horo_destroy().
+ *
+ * @param[in] clock The clock whose checkpoint will be closed.
+ */
+HORO_API HORO_ERROR
+horo_closeCheckpoint(horo_clock_t* clock);
+
 /**
  * Return clock's resources to the system.
  *
  * @param[in] clock The clock structure to be destroyed.
  */
-HORO_ERROR
+HORO_API HORO_ERROR
 horo_destroy(horo_clock_t* clock);
 
+/**
+ * Opaque data structure for a clock whose action table lives in a POSIX
+ * shared memory segment.  One process (the writer) schedules and unschedules
+ * actions, any number of processes call horo_sharedProcess().  Every action
+ * is executed by exactly one of the processes in each minute it is scheduled
+ * for: processes claim an action with an atomic compare-and-swap on its
+ * "last claimed minute" before executing it.
+ *
+ * Function pointers are not meaningful across processes, so a shared action
+ * is described by a user defined 64 bit tag that is handed to the dispatch
+ * callback of the process that claims it.
+ *
+ * Shared clocks are only available on POSIX systems, the functions return
+ * HORO_ERROR_NOT_SUPPORTED elsewhere.
+ */
+typedef struct horo_shared_clock horo_shared_clock_t;
+
+/**
+ * Type definition for the dispatch callback of horo_sharedProcess().
+ */
+typedef void (*horo_sharedActionFunc)(void* userp, int actionID, uint64_t tag);
+
+/**
+ * Create a shared clock segment and attach to it as the writer.  Processes
+ * forked after this call may use the returned clock directly; unrelated
+ * processes attach with horo_sharedAttach().
+ *
+ * If the segment already exists, e.g. when the writer restarts, it is
+ * attached like horo_sharedAttach() does and keeps its actions and its
+ * capacity.  A segment that is not a valid shared clock is left alone and
+ * reported with the error of horo_sharedAttach(); remove it with
+ * horo_sharedUnlink().
+ *
+ * @param[in] name The POSIX shared memory name, e.g. "/myapp-clock".
+ *
+ * @param[in] capacity The maximum number of actions.
+ *
+ * @param[out] oClock Receives the clock.  Release it with horo_sharedDetach().
+ */
+HORO_API HORO_ERROR
+horo_sharedCreate(const char* name, size_t capacity, horo_shared_clock_t** oClock);
+
+/**
+ * Attach to an existing shared clock segment as a reader.
+ *
+ * @param[in] name The name passed to horo_sharedCreate().
+ *
+ * @param[out] oClock Receives the clock.  Release it with horo_sharedDetach().
+ */
+HORO_API HORO_ERROR
+horo_sharedAttach(const char* name, horo_shared_clock_t** oClock);
+
+/**
+ * Schedule an action on a shared clock.  Must only be called by the writer.
+ *
+ * @param[in] clock The shared clock.
+ *
+ * @param[in] scheduleString The cron based schedule string.
+ *
+ * @param[in] tag Passed to the dispatch callback when the action executes.
+ *
+ * @param[out] oActionID The id of the action.  IDs of unscheduled actions
+ * are reused.
+ */
+HORO_API HORO_ERROR
+horo_sharedScheduleAction(horo_shared_clock_t* clock, const char* scheduleString,
+                          uint64_t tag, int* oActionID);
+
+/**
+ * Unschedule an action of a shared clock.  Must only be called by the writer.
+ *
+ * @param[in] clock The shared clock.
+ *
+ * @param[in] actionID The actionID from horo_sharedScheduleAction().
+ */
+HORO_API HORO_ERROR
+horo_sharedUnscheduleAction(horo_shared_clock_t* clock, int actionID);
+
+/**
+ * The number of actions scheduled on a shared clock.
+ */
+HORO_API HORO_ERROR
+horo_sharedActionCount(horo_shared_clock_t* clock, int* oActionCount);
+
+/**
+ * Claim and execute the actions of a shared clock that are due at
+ * 'utcSeconds'.  May be called concurrently by any number of processes; each
+ * due action is passed to exactly one 'action' callback per minute.  The
+ * schedules are matched against the process' local time, claims are made
+ * on the UTC minute and only move forward, so a process that is behind
+ * the others never runs a minute again.
+ *
+ * @param[in] clock The shared clock.
+ *
+ * @param[in] utcSeconds The current time, e.g. time(NULL), up to 2106.
+ *
+ * @param[in] action Called for every action claimed by this process.
+ *
+ * @param[in] userp Passed to 'action' unchanged.
+ */
+HORO_API HORO_ERROR
+horo_sharedProcess(horo_shared_clock_t* clock, int64_t utcSeconds,
+                   horo_sharedActionFunc action, void* userp);
+
+/**
+ * Unmap a shared clock from this process.  The segment itself stays
+ * alive until it is removed with horo_sharedUnlink().
+ */
+HORO_API HORO_ERROR
+horo_sharedDetach(horo_shared_clock_t* clock);
+
+/**
+ * Remove a shared clock segment.  Processes that are attached keep their
+ * mapping.
+ */
+HORO_API HORO_ERROR
+horo_sharedUnlink(const char* name);
+
+/**
+ * Opaque data structure for a crontab file whose schedule lines are kept
+ * scheduled on a clock.
+ *
+ * Every non blank line that does not start with '#' has the form
+ * "<schedule> <command>", where the schedule is five fields or an @macro.
+ * Environment assignments such as "MAILTO=root" are skipped, they are not
+ * applied to the commands.
+ * Lines are keyed by their contents: on reload, lines that are unchanged keep
+ * their action (and therefore their last run time), removed lines are
+ * unscheduled and new lines are scheduled.  The line is also set as the key
+ * of its action, see horo_setActionKey().
+ */
+typedef struct horo_crontab horo_crontab_t;
+
+/**
+ * The changes applied by a crontab (re)load.
+ */
+struct horo_crontab_diff
+{
+    int added;
+    int removed;
+    int kept;
+
+    /**
+     * The 1 based line number that could not be scheduled, 0 if the error
+     * was not caused by a line.
+     */
+    int errorLine;
+};
+typedef struct horo_crontab_diff horo_crontab_diff_t;
+
+/**
+ * Load a crontab file into a clock and start watching it for changes
+ * (inotify on Linux, modification time and size elsewhere).
+ *
+ * @param[in] clock The clock to schedule the lines on.  It must outlive the
+ * crontab.
+ *
+ * @param[in] path The crontab file.
+ *
+ * @param[in] resolve Called with the command of every new line.  It must
+ * set *oAction to the action to execute.
+ *
+ * @param[in] release Called with the action data of every line that is
+ * unscheduled.  May be NULL.
+ *
+ * @param[in] userp Passed to 'resolve' and 'release' unchanged.
+ *
+ * @param[out] oCrontab Receives the crontab.  Release it with
+ * horo_crontabClose().
+ *
+ * @param[out] oDiff Receives the number of scheduled lines.  May be NULL.
+ */
+HORO_API HORO_ERROR
+horo_crontabOpen(horo_clock_t* clock, const char* path,
+                 horo_resolveFunc resolve, horo_releaseFunc release,
+                 void* userp, horo_crontab_t** oCrontab,
+                 horo_crontab_diff_t* oDiff);
+
+/**
+ * Re-read the crontab and apply the difference to the clock.  Either all of
+ * the changes are applied or, if a line fails to parse or resolve, none.
+ *
+ * @param[out] oDiff Receives the applied changes or the failing line.  May
+ * be NULL.
+ */
+HORO_API HORO_ERROR
+horo_crontabReload(horo_crontab_t* crontab, horo_crontab_diff_t* oDiff);
+
+/**
+ * Reload the crontab if it changed since it was last read.  Does not block.
+ *
+ * @param[out] oDiff Receives the applied changes, all zero if the file did
+ * not change.  May be NULL.
+ */
+HORO_API HORO_ERROR
+horo_crontabPoll(horo_crontab_t* crontab, horo_crontab_diff_t* oDiff);
+
+/**
+ * Get a file descriptor that becomes readable when the crontab may have
+ * changed, for use with poll() or select() followed by horo_crontabPoll().
+ *
+ * @param[out] oFD Receives the descriptor, -1 if the platform has none and
+ * horo_crontabPoll() must be called periodically instead.
+ */
+HORO_API HORO_ERROR
+horo_crontabWatchFD(horo_crontab_t* crontab, int* oFD);
+
+/**
+ * Stop watching the crontab and unschedule all of its lines.
+ */
+HORO_API HORO_ERROR
+horo_crontabClose(horo_crontab_t* crontab);
+
 #ifdef __cplusplus
 }
 #endif
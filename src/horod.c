@@ -0,0 +1,1189 @@
+/**
+ * December 19, 2013
+ * The author disclaims copyright to this source code.
+ */
+
+/*
+ * horod is a cron daemon for Linux built on libhoro.  It runs the commands
+ * of a user crontab (five fields or an @macro followed by a command) with
+ * /bin/sh and re-reads the crontab when it changes.  The output of every
+ * job is collected and logged together with its exit status once the job
+ * is done.  Jobs whose time passed while the daemon was late waking up,
+ * e.g. on a loaded machine, are started as soon as it runs again.
+ *
+ * The daemon is built to start many jobs cheaply:
+ *   - It sleeps in epoll_wait() until the next fire time reported by
+ *     horo_queryWindow(), the crontab is only read when inotify reports a
+ *     change.
+ *   - Jobs are started with posix_spawn(), which glibc implements with
+ *     clone(CLONE_VM | CLONE_VFORK).  The daemon's memory is not copied,
+ *     so the cost of a spawn does not grow with the size of the daemon.
+ *   - The output pipes of all jobs and a signalfd that reaps them are
+ *     serviced by the same epoll loop.  Job records and their output
+ *     buffers are pooled.
+ *
+ * With -z jobs are started by a zygote, a helper process forked before the
+ * clock and crontab are loaded.  The daemon only sends it the command and
+ * the output pipe, so the spawn work leaves the daemon's loop.  -b measures
+ * the spawn rate of either path.
+ *
+ * On SIGINT or SIGTERM the daemon prints the number of jobs it ran and the
+ * CPU time it used, so the same crontab can be compared with another cron
+ * daemon.  SIGHUP forces a reload of the crontab.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "horo.h"
+
+extern char** environ;
+
+#define MAX_EVENTS 256
+
+/*Job output beyond this is read and dropped*/
+#define JOB_OUTPUT_MAX (64 * 1024)
+
+/*How far ahead the next fire is looked for, the loop wakes at least this often*/
+#define LOOKAHEAD_SECONDS 60
+
+/*
+ * A late wakeup runs the fires it missed if they are at most this far
+ * behind.  Longer gaps, e.g. after a suspend, are skipped like cron does.
+ */
+#define CATCH_UP_SECONDS (3 * 60 * 60)
+
+/*Must be a power of 2*/
+#define PID_BUCKETS 4096
+
+/*Longer commands are spawned by the daemon itself*/
+#define ZYGOTE_MAX_COMMAND 16384
+
+#define ZYGOTE_STARTED 1
+#define ZYGOTE_EXITED 2
+
+/*
+ * Sent by the zygote.  Requests are answered in order with ZYGOTE_STARTED,
+ * each started job later with ZYGOTE_EXITED.
+ */
+typedef struct
+{
+    int type;
+    pid_t pid;
+
+    /*An errno for ZYGOTE_STARTED, the wait status for ZYGOTE_EXITED*/
+    int value;
+}zygoteReply_t;
+
+/*The command of a crontab line, the action data of its action*/
+typedef struct
+{
+    char* command;
+}horodCommand_t;
+
+/*A started job, from posix_spawn() until it exited and closed its output*/
+typedef struct horodJob horodJob_t;
+struct horodJob
+{
+    pid_t pid;
+    int outputFD;
+    int exited;
+    int status;
+    time_t started;
+    char* command;
+
+    char* output;
+    size_t outputLength;
+    size_t outputCapacity;
+    int truncated;
+
+    /*Reaped by the zygote, which reports the exit status*/
+    int viaZygote;
+
+    /*Chain in the pid table, the zygote's request queue or the free list*/
+    horodJob_t* next;
+};
+
+typedef struct
+{
+    horo_clock_t* clock;
+    horo_crontab_t* crontab;
+    int epollFD;
+    int signalFD;
+    int crontabFD;
+    int zygoteFD;
+    FILE* log;
+    posix_spawnattr_t spawnAttr;
+
+    horodJob_t* pidTable[PID_BUCKETS];
+    horodJob_t* freeJobs;
+
+    /*Jobs sent to the zygote that it has not answered yet*/
+    horodJob_t* startingHead;
+    horodJob_t* startingTail;
+
+    long long jobsStarted;
+    long long spawnFailures;
+    int running;
+    int crontabChanged;
+    int stopping;
+}horod_t;
+
+static horod_t horod;
+
+static void
+usage()
+{
+    fprintf(stderr,
+            "horod [options] <crontab>\n"
+            "horod [options] -b <jobs>\n"
+            "  -l <file>   Log job output to <file> (default stdout)\n"
+            "  -z          Start jobs through a zygote process\n"
+            "  -b <jobs>   Start <jobs> jobs of 'true' at once, report the rate\n"
+            "  -m <MiB>    With -b, grow the daemon by <MiB> of memory first\n");
+}
+
+static void
+logTime(FILE* file)
+{
+    char buffer[32];
+    time_t now = time(NULL);
+    struct tm local;
+
+    localtime_r(&now, &local);
+    strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+    fprintf(file, "%s ", buffer);
+}
+
+static horodJob_t**
+pidBucket(pid_t pid)
+{
+    return &horod.pidTable[(unsigned int)pid & (PID_BUCKETS - 1)];
+}
+
+static horodJob_t*
+allocJob()
+{
+    horodJob_t* job = horod.freeJobs;
+
+    if(job != NULL)
+    {
+        horod.freeJobs = job->next;
+    }
+    else
+    {
+        job = (horodJob_t*)calloc(1, sizeof(horodJob_t));
+        if(job == NULL) return NULL;
+    }
+
+    job->pid = -1;
+    job->outputFD = -1;
+    job->exited = 0;
+    job->status = 0;
+    job->outputLength = 0;
+    job->truncated = 0;
+    job->viaZygote = 0;
+    job->next = NULL;
+    return job;
+}
+
+/*Returns the job to the pool, its output buffer is kept for the next job*/
+static void
+releaseJob(horodJob_t* job)
+{
+    //A stale epoll event of the same batch must not finish the job again
+    job->exited = 0;
+    job->command = NULL;
+    job->next = horod.freeJobs;
+    horod.freeJobs = job;
+}
+
+static void
+reportJob(horodJob_t* job)
+{
+    FILE* log = horod.log;
+
+    logTime(log);
+    fprintf(log, "[%d] ", (int)job->pid);
+    if(job->status == -1)
+    {
+        fprintf(log, "status unknown");
+    }
+    else if(WIFEXITED(job->status))
+    {
+        fprintf(log, "exit %d", WEXITSTATUS(job->status));
+    }
+    else if(WIFSIGNALED(job->status))
+    {
+        fprintf(log, "signal %d", WTERMSIG(job->status));
+    }
+    fprintf(log, " after %lds: %s\n", (long)(time(NULL) - job->started),
+            job->command);
+
+    if(job->outputLength > 0)
+    {
+        fwrite(job->output, 1, job->outputLength, log);
+        if(job->output[job->outputLength - 1] != '\n') fputc('\n', log);
+    }
+    if(job->truncated)
+    {
+        fprintf(log, "[output truncated after %d bytes]\n", JOB_OUTPUT_MAX);
+    }
+    fflush(log);
+}
+
+/*A job is done once it exited and everything it wrote has been read*/
+static void
+finishJobIfDone(horodJob_t* job)
+{
+    horodJob_t** link = NULL;
+
+    if(!job->exited || (job->outputFD >= 0)) return;
+
+    reportJob(job);
+
+    for(link = pidBucket(job->pid); *link != NULL; link = &(*link)->next)
+    {
+        if(*link == job)
+        {
+            *link = job->next;
+            break;
+        }
+    }
+
+    horod.running--;
+    releaseJob(job);
+}
+
+static void
+closeOutput(horodJob_t* job)
+{
+    epoll_ctl(horod.epollFD, EPOLL_CTL_DEL, job->outputFD, NULL);
+    close(job->outputFD);
+    job->outputFD = -1;
+}
+
+/*Most jobs print little, buffers grow up to JOB_OUTPUT_MAX when needed*/
+static void
+growOutput(horodJob_t* job)
+{
+    size_t capacity = job->outputCapacity ? (job->outputCapacity * 2) : 4096;
+    char* grown = NULL;
+
+    if(capacity > JOB_OUTPUT_MAX) capacity = JOB_OUTPUT_MAX;
+    grown = (char*)realloc(job->output, capacity);
+    if(grown != NULL)
+    {
+        job->output = grown;
+        job->outputCapacity = capacity;
+    }
+}
+
+static void
+readOutput(horodJob_t* job)
+{
+    char discard[4096];
+
+    while(job->outputFD >= 0)
+    {
+        char* buffer = NULL;
+        size_t space = 0;
+        ssize_t got = 0;
+
+        if((job->outputLength == job->outputCapacity) &&
+           (job->outputCapacity < JOB_OUTPUT_MAX))
+        {
+            growOutput(job);
+        }
+
+        buffer = job->output + job->outputLength;
+        space = job->outputCapacity - job->outputLength;
+        if(space == 0)
+        {
+            buffer = discard;
+            space = sizeof(discard);
+        }
+
+        got = read(job->outputFD, buffer, space);
+        if(got > 0)
+        {
+            if(buffer == discard) job->truncated = 1;
+            else job->outputLength += (size_t)got;
+            continue;
+        }
+        if((got < 0) && (errno == EINTR)) continue;
+        if((got < 0) && (errno == EAGAIN)) return;
+
+        //End of file, or an error that leaves nothing more to read
+        closeOutput(job);
+    }
+
+    finishJobIfDone(job);
+}
+
+/*Starts 'command' with its output going to 'outputFD', returns an errno*/
+static int
+spawnCommand(const char* command, int outputFD, pid_t* oPid)
+{
+    posix_spawn_file_actions_t fileActions;
+    char* argv[4];
+    int err = 0;
+
+    //dup2() clears close-on-exec, so the job keeps only these
+    posix_spawn_file_actions_init(&fileActions);
+    posix_spawn_file_actions_addopen(&fileActions, STDIN_FILENO, "/dev/null",
+                                     O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&fileActions, outputFD, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&fileActions, outputFD, STDERR_FILENO);
+
+    argv[0] = "sh";
+    argv[1] = "-c";
+    argv[2] = (char*)command;
+    argv[3] = NULL;
+
+    err = posix_spawn(oPid, "/bin/sh", &fileActions, &horod.spawnAttr,
+                      argv, environ);
+    posix_spawn_file_actions_destroy(&fileActions);
+    return err;
+}
+
+static void
+watchOutput(horodJob_t* job, int outputFD)
+{
+    struct epoll_event event;
+
+    job->outputFD = outputFD;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = job;
+    if(epoll_ctl(horod.epollFD, EPOLL_CTL_ADD, job->outputFD, &event) != 0)
+    {
+        //The job runs anyway, its output is lost
+        close(job->outputFD);
+        job->outputFD = -1;
+    }
+}
+
+static void
+addRunning(horodJob_t* job)
+{
+    job->next = *pidBucket(job->pid);
+    *pidBucket(job->pid) = job;
+    horod.running++;
+    horod.jobsStarted++;
+}
+
+static void
+failJob(horodJob_t* job, int err)
+{
+    logTime(stderr);
+    fprintf(stderr, "Unable to start '%s': %s\n", job->command, strerror(err));
+
+    if(job->outputFD >= 0) closeOutput(job);
+    releaseJob(job);
+    horod.spawnFailures++;
+}
+
+static void
+jobExited(pid_t pid, int status, int viaZygote)
+{
+    horodJob_t* job = NULL;
+
+    //A pid the zygote reaped may already belong to one of our own children
+    for(job = *pidBucket(pid); job != NULL; job = job->next)
+    {
+        if((job->pid == pid) && (job->viaZygote == viaZygote)) break;
+    }
+    if(job == NULL) return;
+
+    job->exited = 1;
+    job->status = status;
+
+    //Whatever is left in the pipe is read before the job is reported
+    if(job->outputFD >= 0) readOutput(job);
+    else finishJobIfDone(job);
+}
+
+/*Fails the jobs the zygote did not start and gives up on reaping the rest*/
+static void
+zygoteLost()
+{
+    horodJob_t* job = NULL;
+    horodJob_t* next = NULL;
+    size_t i = 0;
+
+    logTime(stderr);
+    fprintf(stderr, "The zygote exited, jobs are started directly\n");
+
+    epoll_ctl(horod.epollFD, EPOLL_CTL_DEL, horod.zygoteFD, NULL);
+    close(horod.zygoteFD);
+    horod.zygoteFD = -1;
+
+    while((job = horod.startingHead) != NULL)
+    {
+        horod.startingHead = job->next;
+        failJob(job, ECONNRESET);
+    }
+    horod.startingTail = NULL;
+
+    for(i = 0; i < PID_BUCKETS; i++)
+    {
+        for(job = horod.pidTable[i]; job != NULL; job = next)
+        {
+            next = job->next;
+            if(job->viaZygote && !job->exited)
+            {
+                job->exited = 1;
+                job->status = -1;
+                finishJobIfDone(job);
+            }
+        }
+    }
+}
+
+static void
+readZygote()
+{
+    zygoteReply_t reply;
+    horodJob_t* job = NULL;
+    ssize_t got = 0;
+
+    while((got = recv(horod.zygoteFD, &reply, sizeof(reply), MSG_DONTWAIT)) ==
+          sizeof(reply))
+    {
+        if(reply.type == ZYGOTE_EXITED)
+        {
+            jobExited(reply.pid, reply.value, 1);
+            continue;
+        }
+
+        job = horod.startingHead;
+        if(job == NULL) continue;
+        horod.startingHead = job->next;
+        if(horod.startingHead == NULL) horod.startingTail = NULL;
+        job->next = NULL;
+
+        if(reply.value)
+        {
+            failJob(job, reply.value);
+            continue;
+        }
+        job->pid = reply.pid;
+        job->viaZygote = 1;
+        addRunning(job);
+    }
+
+    if((got == 0) || ((got < 0) && (errno != EAGAIN) && (errno != EINTR)))
+    {
+        zygoteLost();
+    }
+}
+
+/*Hands a command and its output pipe to the zygote, returns an errno*/
+static int
+zygoteRequest(const char* command, int outputFD)
+{
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr message;
+    struct cmsghdr* header = NULL;
+    struct iovec body;
+    struct pollfd socketPoll;
+
+    body.iov_base = (void*)command;
+    body.iov_len = strlen(command) + 1;
+    if(body.iov_len > ZYGOTE_MAX_COMMAND) return E2BIG;
+
+    memset(control, 0, sizeof(control));
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &body;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &outputFD, sizeof(int));
+
+    while(sendmsg(horod.zygoteFD, &message, MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+    {
+        if(errno == EINTR) continue;
+        if(errno != EAGAIN) return errno;
+
+        //The zygote stalls on its replies while ours are unread, read them
+        socketPoll.fd = horod.zygoteFD;
+        socketPoll.events = POLLIN | POLLOUT;
+        if((poll(&socketPoll, 1, -1) > 0) && (socketPoll.revents & ~POLLOUT))
+        {
+            readZygote();
+            if(horod.zygoteFD < 0) return ECONNRESET;
+        }
+    }
+
+    return 0;
+}
+
+static void
+spawnJob(horodCommand_t* command)
+{
+    horodJob_t* job = NULL;
+    int pipeFDs[2] = {-1, -1};
+    int err = 0;
+
+    job = allocJob();
+    if(job == NULL)
+    {
+        logTime(stderr);
+        fprintf(stderr, "Unable to start '%s': %s\n", command->command,
+                strerror(ENOMEM));
+        horod.spawnFailures++;
+        return;
+    }
+    job->command = command->command;
+    job->started = time(NULL);
+
+    if(pipe2(pipeFDs, O_CLOEXEC) != 0)
+    {
+        err = errno;
+        goto ERR;
+    }
+    fcntl(pipeFDs[0], F_SETFL, O_NONBLOCK);
+
+    if((horod.zygoteFD >= 0) && (zygoteRequest(command->command, pipeFDs[1]) == 0))
+    {
+        //The pid comes with the zygote's answer
+        close(pipeFDs[1]);
+        watchOutput(job, pipeFDs[0]);
+        if(horod.startingTail != NULL) horod.startingTail->next = job;
+        else horod.startingHead = job;
+        horod.startingTail = job;
+        return;
+    }
+
+    err = spawnCommand(command->command, pipeFDs[1], &job->pid);
+    close(pipeFDs[1]);
+    if(err)
+    {
+        close(pipeFDs[0]);
+        goto ERR;
+    }
+
+    watchOutput(job, pipeFDs[0]);
+    addRunning(job);
+    return;
+
+ERR:
+    failJob(job, err);
+}
+
+static void
+runCommand(void* actionData)
+{
+    spawnJob((horodCommand_t*)actionData);
+}
+
+static void
+reapChildren()
+{
+    pid_t pid = 0;
+    int status = 0;
+
+    //The zygote, when it exits, is reaped here too
+    while((pid = waitpid(-1, &status, WNOHANG)) > 0)
+    {
+        jobExited(pid, status, 0);
+    }
+}
+
+/*
+ * The zygote's loop: start the jobs the daemon asks for and report their
+ * exit status.  It keeps the daemon's blocked signals and ends when the
+ * daemon closes its end of the socket.
+ */
+static void
+runZygote(int socketFD)
+{
+    static char command[ZYGOTE_MAX_COMMAND];
+    char control[CMSG_SPACE(sizeof(int))];
+    struct signalfd_siginfo info;
+    struct pollfd fds[2];
+    struct msghdr message;
+    struct cmsghdr* header = NULL;
+    struct iovec body;
+    zygoteReply_t reply;
+    sigset_t childSignal;
+    ssize_t got = 0;
+    int outputFD = -1;
+    int status = 0;
+
+    sigemptyset(&childSignal);
+    sigaddset(&childSignal, SIGCHLD);
+    fds[0].fd = socketFD;
+    fds[0].events = POLLIN;
+    fds[1].fd = signalfd(-1, &childSignal, SFD_NONBLOCK | SFD_CLOEXEC);
+    fds[1].events = POLLIN;
+    if(fds[1].fd < 0) _exit(EXIT_FAILURE);
+
+    memset(&reply, 0, sizeof(reply));
+    for(;;)
+    {
+        if(poll(fds, 2, -1) < 0)
+        {
+            if(errno == EINTR) continue;
+            break;
+        }
+
+        while(fds[0].revents)
+        {
+            body.iov_base = command;
+            body.iov_len = sizeof(command);
+            memset(&message, 0, sizeof(message));
+            message.msg_iov = &body;
+            message.msg_iovlen = 1;
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+
+            got = recvmsg(socketFD, &message, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+            if((got < 0) && ((errno == EAGAIN) || (errno == EINTR))) break;
+            if(got <= 0) _exit(EXIT_SUCCESS);
+
+            outputFD = -1;
+            header = CMSG_FIRSTHDR(&message);
+            if((header != NULL) && (header->cmsg_type == SCM_RIGHTS))
+            {
+                memcpy(&outputFD, CMSG_DATA(header), sizeof(int));
+            }
+
+            reply.type = ZYGOTE_STARTED;
+            reply.pid = -1;
+            if((outputFD < 0) || (command[got - 1] != '\0') ||
+               (message.msg_flags & MSG_TRUNC))
+            {
+                reply.value = EINVAL;
+            }
+            else
+            {
+                reply.value = spawnCommand(command, outputFD, &reply.pid);
+            }
+            if(outputFD >= 0) close(outputFD);
+
+            if(send(socketFD, &reply, sizeof(reply), MSG_NOSIGNAL) < 0)
+            {
+                _exit(EXIT_FAILURE);
+            }
+        }
+
+        if(fds[1].revents)
+        {
+            while(read(fds[1].fd, &info, sizeof(info)) == sizeof(info));
+
+            reply.type = ZYGOTE_EXITED;
+            while((reply.pid = waitpid(-1, &status, WNOHANG)) > 0)
+            {
+                reply.value = status;
+                if(send(socketFD, &reply, sizeof(reply), MSG_NOSIGNAL) < 0)
+                {
+                    _exit(EXIT_FAILURE);
+                }
+            }
+        }
+    }
+
+    _exit(EXIT_FAILURE);
+}
+
+/*Forks the zygote while the daemon is still small*/
+static int
+startZygote()
+{
+    int sockets[2];
+    pid_t pid = 0;
+
+    if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) != 0)
+    {
+        return 0;
+    }
+
+    fflush(NULL);
+    pid = fork();
+    if(pid < 0)
+    {
+        close(sockets[0]);
+        close(sockets[1]);
+        return 0;
+    }
+    if(pid == 0)
+    {
+        close(sockets[0]);
+        runZygote(sockets[1]);
+    }
+
+    close(sockets[1]);
+    horod.zygoteFD = sockets[0];
+    return 1;
+}
+
+static void
+reloadCrontab(HORO_ERROR (*reload)(horo_crontab_t*, horo_crontab_diff_t*))
+{
+    horo_crontab_diff_t diff;
+    HORO_ERROR err = reload(horod.crontab, &diff);
+
+    logTime(stderr);
+    if(err)
+    {
+        fprintf(stderr, "Crontab not reloaded, error %d at line %d\n", err,
+                diff.errorLine);
+    }
+    else if(diff.added || diff.removed)
+    {
+        fprintf(stderr, "Crontab reloaded: %d added, %d removed, %d kept\n",
+                diff.added, diff.removed, diff.kept);
+        horod.crontabChanged = 1;
+    }
+}
+
+static void
+readSignals()
+{
+    struct signalfd_siginfo info;
+    int childExited = 0;
+
+    while(read(horod.signalFD, &info, sizeof(info)) == sizeof(info))
+    {
+        switch(info.ssi_signo)
+        {
+        case SIGCHLD:
+            //Signals coalesce, one reap collects every exited child
+            childExited = 1;
+            break;
+        case SIGHUP:
+            reloadCrontab(horo_crontabReload);
+            break;
+        default:
+            horod.stopping = 1;
+            break;
+        }
+    }
+
+    if(childExited) reapChildren();
+}
+
+static HORO_ERROR
+resolveCommand(void* userp, const char* key, horo_actionFunc* oAction,
+               void** oActionData)
+{
+    horodCommand_t* command = NULL;
+
+    (void)userp;
+    command = (horodCommand_t*)malloc(sizeof(horodCommand_t) + strlen(key) + 1);
+    if(command == NULL)
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+    command->command = (char*)(command + 1);
+    strcpy(command->command, key);
+
+    *oAction = runCommand;
+    *oActionData = command;
+    return HORO_SUCCESS;
+}
+
+static void
+releaseCommand(void* userp, void* actionData)
+{
+    (void)userp;
+    free(actionData);
+}
+
+static HORO_ERROR
+stopAtFirstFire(void* userp, int actionID, time_t fireTime)
+{
+    (void)actionID;
+    *(time_t*)userp = fireTime;
+
+    //Any error ends the query, only the first fire is needed
+    return HORO_ERROR_OUT_OF_RANGE;
+}
+
+/*The next time the clock has to be driven, at most LOOKAHEAD_SECONDS away*/
+static time_t
+nextWakeTime(time_t after)
+{
+    time_t wake = after + LOOKAHEAD_SECONDS;
+
+    horo_queryWindow(horod.clock, after, wake, stopAtFirstFire, &wake);
+    return wake;
+}
+
+static int
+millisUntil(time_t when)
+{
+    struct timespec now;
+    long long millis = 0;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    millis = ((long long)(when - now.tv_sec) * 1000) - (now.tv_nsec / 1000000);
+    if(millis < 0) return 0;
+    if(millis > (LOOKAHEAD_SECONDS * 1000)) return LOOKAHEAD_SECONDS * 1000;
+    return (int)millis;
+}
+
+static int
+watchFD(int fd, void* tag)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = tag;
+    return epoll_ctl(horod.epollFD, EPOLL_CTL_ADD, fd, &event);
+}
+
+/*Running thousands of jobs at once needs a descriptor for each output pipe*/
+static void
+raiseFileLimit()
+{
+    struct rlimit limit;
+
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+static int
+setupDaemon(int useZygote)
+{
+    sigset_t signals;
+    sigset_t childSignals;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGCHLD);
+    sigaddset(&signals, SIGHUP);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    if(sigprocmask(SIG_BLOCK, &signals, NULL) != 0) goto ERR;
+
+    //Jobs start with no blocked signals, in their own process group
+    sigemptyset(&childSignals);
+    posix_spawnattr_init(&horod.spawnAttr);
+    posix_spawnattr_setsigmask(&horod.spawnAttr, &childSignals);
+    posix_spawnattr_setpgroup(&horod.spawnAttr, 0);
+    posix_spawnattr_setflags(&horod.spawnAttr,
+                             POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETPGROUP);
+
+    //Before anything else is allocated, so the zygote stays small
+    horod.zygoteFD = -1;
+    if(useZygote && !startZygote()) goto ERR;
+
+    horod.signalFD = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    horod.epollFD = epoll_create1(EPOLL_CLOEXEC);
+    if((horod.signalFD < 0) || (horod.epollFD < 0)) goto ERR;
+    if(watchFD(horod.signalFD, &horod.signalFD) != 0) goto ERR;
+    if((horod.zygoteFD >= 0) &&
+       (watchFD(horod.zygoteFD, &horod.zygoteFD) != 0))
+    {
+        goto ERR;
+    }
+
+    return 1;
+
+ERR:
+    perror("horod");
+    return 0;
+}
+
+static int
+loadCrontab(const char* crontabPath)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_crontab_diff_t diff;
+
+    memset(&diff, 0, sizeof(diff));
+    err = horo_init(&horod.clock);
+    if(!err)
+    {
+        err = horo_crontabOpen(horod.clock, crontabPath, resolveCommand,
+                               releaseCommand, NULL, &horod.crontab, &diff);
+    }
+    if(err)
+    {
+        fprintf(stderr, "Unable to load %s: error %d at line %d\n",
+                crontabPath, err, diff.errorLine);
+        return 0;
+    }
+
+    horo_crontabWatchFD(horod.crontab, &horod.crontabFD);
+    if((horod.crontabFD >= 0) &&
+       (watchFD(horod.crontabFD, &horod.crontabFD) != 0))
+    {
+        perror("horod");
+        return 0;
+    }
+
+    logTime(stderr);
+    fprintf(stderr, "Loaded %s: %d jobs\n", crontabPath, diff.added);
+    return 1;
+}
+
+static void
+dispatchEvents(struct epoll_event* events, int numEvents)
+{
+    int i = 0;
+
+    for(i = 0; i < numEvents; i++)
+    {
+        void* tag = events[i].data.ptr;
+
+        if(tag == &horod.signalFD)
+        {
+            readSignals();
+        }
+        else if(tag == &horod.crontabFD)
+        {
+            reloadCrontab(horo_crontabPoll);
+        }
+        else if(tag == &horod.zygoteFD)
+        {
+            readZygote();
+        }
+        else
+        {
+            readOutput((horodJob_t*)tag);
+        }
+    }
+}
+
+static double
+secondsSince(const struct timespec* start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) +
+           ((double)(now.tv_nsec - start->tv_nsec) / 1e9);
+}
+
+/*Starts 'jobs' jobs at once, like a crontab where they all share a minute*/
+static void
+runBenchmark(long jobs)
+{
+    struct epoll_event events[MAX_EVENTS];
+    struct timespec start;
+    horodCommand_t command;
+    double spawnSeconds = 0;
+    double totalSeconds = 0;
+    const char* path = (horod.zygoteFD >= 0) ? "zygote" : "direct";
+    long i = 0;
+    int numEvents = 0;
+
+    command.command = "true";
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i = 0; i < jobs; i++)
+    {
+        spawnJob(&command);
+    }
+    spawnSeconds = secondsSince(&start);
+
+    while(!horod.stopping &&
+          ((horod.running > 0) || (horod.startingHead != NULL)))
+    {
+        numEvents = epoll_wait(horod.epollFD, events, MAX_EVENTS, -1);
+        if((numEvents < 0) && (errno != EINTR))
+        {
+            perror("epoll_wait");
+            break;
+        }
+        dispatchEvents(events, numEvents);
+    }
+    totalSeconds = secondsSince(&start);
+
+    fprintf(stderr,
+            "%s: %ld jobs\n"
+            "spawn loop:      %.3f s (%.0f jobs/s)\n"
+            "all finished:    %.3f s (%.0f jobs/s)\n",
+            path, jobs,
+            spawnSeconds, jobs / spawnSeconds,
+            totalSeconds, jobs / totalSeconds);
+}
+
+static void
+printStats()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    fprintf(stderr,
+            "jobs started:    %lld\n"
+            "spawn failures:  %lld\n"
+            "still running:   %d\n"
+            "cpu user:        %ld.%06ld s\n"
+            "cpu system:      %ld.%06ld s\n"
+            "max rss:         %ld KiB\n",
+            horod.jobsStarted, horod.spawnFailures, horod.running,
+            (long)usage.ru_utime.tv_sec, (long)usage.ru_utime.tv_usec,
+            (long)usage.ru_stime.tv_sec, (long)usage.ru_stime.tv_usec,
+            usage.ru_maxrss);
+}
+
+/*Grows the daemon like a large deployment would, to show the cost of fork*/
+static void
+addBallast(long mebibytes)
+{
+    size_t size = (size_t)mebibytes * 1024 * 1024;
+    char* ballast = NULL;
+
+    ballast = (char*)malloc(size);
+    if(ballast == NULL)
+    {
+        perror("horod");
+        exit(EXIT_FAILURE);
+    }
+
+    //Touched, so every page is mapped; kept until the process exits
+    memset(ballast, 1, size);
+}
+
+int
+main(int argc, char** argv)
+{
+    struct epoll_event events[MAX_EVENTS];
+    const char* crontabPath = NULL;
+    const char* logFile = NULL;
+    long benchmarkJobs = 0;
+    long ballastMiB = 0;
+    int useZygote = 0;
+    time_t lastProcessed = 0;
+    time_t wake = 0;
+    time_t now = 0;
+    int numEvents = 0;
+    int i = 0;
+
+    for(i = 1; i < argc; i++)
+    {
+        if((strcmp(argv[i], "-l") == 0) && (i + 1 < argc))
+        {
+            logFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "-z") == 0)
+        {
+            useZygote = 1;
+        }
+        else if((strcmp(argv[i], "-b") == 0) && (i + 1 < argc))
+        {
+            benchmarkJobs = atol(argv[++i]);
+        }
+        else if((strcmp(argv[i], "-m") == 0) && (i + 1 < argc))
+        {
+            ballastMiB = atol(argv[++i]);
+        }
+        else if((argv[i][0] != '-') && (crontabPath == NULL))
+        {
+            crontabPath = argv[i];
+        }
+        else
+        {
+            usage();
+            exit(EXIT_FAILURE);
+        }
+    }
+    if((crontabPath == NULL) == (benchmarkJobs <= 0))
+    {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    horod.log = stdout;
+    if(logFile != NULL)
+    {
+        horod.log = fopen(logFile, "ae");
+        if(horod.log == NULL)
+        {
+            perror(logFile);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    raiseFileLimit();
+    if(!setupDaemon(useZygote))
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    if(benchmarkJobs > 0)
+    {
+        if(ballastMiB > 0) addBallast(ballastMiB);
+        runBenchmark(benchmarkJobs);
+        printStats();
+        exit(EXIT_SUCCESS);
+    }
+
+    if(!loadCrontab(crontabPath))
+    {
+        exit(EXIT_FAILURE);
+    }
+
+    //Like cron, the first jobs run at the next fire time, not at startup
+    lastProcessed = time(NULL);
+    wake = nextWakeTime(lastProcessed + 1);
+
+    while(!horod.stopping)
+    {
+        numEvents = epoll_wait(horod.epollFD, events, MAX_EVENTS,
+                               millisUntil(wake));
+        if((numEvents < 0) && (errno != EINTR))
+        {
+            perror("epoll_wait");
+            break;
+        }
+        dispatchEvents(events, numEvents);
+
+        now = time(NULL);
+        if(horod.crontabChanged)
+        {
+            //A wake that is due for the old lines still has to happen
+            time_t changedWake = nextWakeTime(now + 1);
+            if(changedWake < wake) wake = changedWake;
+            horod.crontabChanged = 0;
+        }
+        if((now >= wake) && (now != lastProcessed))
+        {
+            //Every fire time slept through is processed at its own time
+            if((now - wake) > CATCH_UP_SECONDS) wake = now;
+            while(wake < now)
+            {
+                horo_processUtc(horod.clock, wake);
+                wake = nextWakeTime(wake + 1);
+            }
+            horo_processUtc(horod.clock, now);
+            lastProcessed = now;
+            wake = nextWakeTime(now + 1);
+        }
+    }
+
+    printStats();
+
+    horo_crontabClose(horod.crontab);
+    horo_destroy(horod.clock);
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,576 @@
+/**
+ * December 19, 2013
+ * The author disclaims copyright to this source code.
+ */
+
+/*
+ * horosim drives a clock through an arbitrary span of synthetic time as fast
+ * as possible.  Time advances one minute of epoch time per tick and is broken
+ * down with localtime(), so leap years and the DST transitions of the zone
+ * given with -z are exercised exactly as they would be by a real driver loop.
+ *
+ * Every fire is recorded.  At the end the throughput of horo_process() is
+ * reported and, with -c, every tick is compared against an independent
+ * reference evaluator.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "horo.h"
+
+#ifdef _WIN32
+#define localtime_r(timep, result) localtime_s((result), (timep))
+#define strtok_r strtok_s
+#define setTimeZone(zone) _putenv_s("TZ", (zone))
+#else
+#define setTimeZone(zone) setenv("TZ", (zone), 1)
+#endif
+
+#define MAX_SCHEDULE_LENGTH 128
+#define MAX_MISMATCHES_REPORTED 20
+
+/*
+ * The reference evaluator.  It deliberately shares no code with libhoro.
+ * It implements libhoro's documented semantics, which differ from Vixie cron
+ * in two places:
+ *   - The day of month and day of week fields must BOTH match.
+ *   - A '*' step starts counting at 0 for every field (e.g. months with
+ *     '*\/2' are 2,4,...,12).
+ */
+typedef struct
+{
+    char minute[60];
+    char hour[24];
+    char dayOfMonth[32];
+    char month[13];
+    char dayOfWeek[8];
+}refSchedule_t;
+
+typedef struct
+{
+    int index;
+    char schedule[MAX_SCHEDULE_LENGTH];
+    int actionID;
+    long long fires;
+
+    refSchedule_t ref;
+    long lastRefFire; /*Packed local time of the last reference fire*/
+}simEntry_t;
+
+typedef struct
+{
+    simEntry_t* entries;
+    int numEntries;
+
+    int* firedThisTick;
+    int numFiredThisTick;
+
+    long long totalFires;
+    FILE* fireLog;
+    struct tm now;
+}simulation_t;
+
+static simulation_t sim;
+
+static void
+usage()
+{
+    fprintf(stderr,
+            "horosim [options]\n"
+            "  -f <file>   Schedules to simulate, one per line\n"
+            "  -n <count>  Number of synthetic schedules (default 1000)\n"
+            "  -s <date>   First simulated day, YYYY-MM-DD (default 2024-01-01)\n"
+            "  -d <days>   Number of simulated days (default 366)\n"
+            "  -z <zone>   Time zone used to break down time (default: TZ)\n"
+            "  -t <ticks>  Calls to horo_process() per minute (default 1)\n"
+            "  -l <file>   Write every fire to <file>\n"
+            "  -r <seed>   Seed for the synthetic schedules (default 1)\n"
+            "  -c          Compare every tick against the reference evaluator\n");
+}
+
+static int
+refParseField(const char* field, char* values, int min, int max)
+{
+    char buffer[MAX_SCHEDULE_LENGTH];
+    char* item = NULL;
+    char* save = NULL;
+
+    memset(values, 0, max + 1);
+    strncpy(buffer, field, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = '\0';
+
+    for(item = strtok_r(buffer, ",", &save); item != NULL;
+        item = strtok_r(NULL, ",", &save))
+    {
+        int start = 0;
+        int stop = 0;
+        int step = 1;
+        int i = 0;
+        char* slash = strchr(item, '/');
+
+        if(slash != NULL)
+        {
+            *slash = '\0';
+            step = atoi(slash + 1);
+            if(step <= 0) return 0;
+        }
+
+        if(strcmp(item, "*") == 0)
+        {
+            start = 0;
+            stop = max;
+        }
+        else if(sscanf(item, "%d-%d", &start, &stop) == 2)
+        {
+        }
+        else if(sscanf(item, "%d", &start) == 1)
+        {
+            stop = start;
+        }
+        else
+        {
+            return 0;
+        }
+
+        if((start < 0) || (stop > max) || (start > stop)) return 0;
+        if((start < min) && (strcmp(item, "*") != 0)) return 0;
+
+        for(i = start; i <= stop; i += step)
+        {
+            values[i] = 1;
+        }
+    }
+
+    return 1;
+}
+
+static int
+refParse(const char* schedule, refSchedule_t* ref)
+{
+    char fields[5][MAX_SCHEDULE_LENGTH];
+
+    if(strcmp(schedule, "@yearly") == 0) schedule = "0 0 1 1 *";
+    else if(strcmp(schedule, "@monthly") == 0) schedule = "0 0 1 * *";
+    else if(strcmp(schedule, "@weekly") == 0) schedule = "0 0 * * 0";
+    else if(strcmp(schedule, "@daily") == 0) schedule = "0 0 * * *";
+    else if(strcmp(schedule, "@hourly") == 0) schedule = "0 * * * *";
+
+    if(sscanf(schedule, "%127s %127s %127s %127s %127s", fields[0], fields[1],
+              fields[2], fields[3], fields[4]) != 5)
+    {
+        return 0;
+    }
+
+    return refParseField(fields[0], ref->minute, 0, 59) &&
+        refParseField(fields[1], ref->hour, 0, 23) &&
+        refParseField(fields[2], ref->dayOfMonth, 1, 31) &&
+        refParseField(fields[3], ref->month, 1, 12) &&
+        refParseField(fields[4], ref->dayOfWeek, 0, 7);
+}
+
+static int
+refMatches(refSchedule_t const* ref, struct tm const* now)
+{
+    return ref->minute[now->tm_min] &&
+        ref->hour[now->tm_hour] &&
+        ref->month[now->tm_mon + 1] &&
+        ref->dayOfMonth[now->tm_mday] &&
+        ref->dayOfWeek[now->tm_wday];
+}
+
+static long
+packLocalTime(struct tm const* now)
+{
+    return (((((long)now->tm_mon * 32) + now->tm_mday) * 24 + now->tm_hour) * 60) +
+        now->tm_min;
+}
+
+static void
+randomSchedule(char* schedule, size_t size)
+{
+    static const char* specials[] = {
+        "@hourly", "@daily", "@weekly", "@monthly", "@yearly"
+    };
+    int m = rand() % 60;
+    int h = rand() % 24;
+    int dom = 1 + (rand() % 31);
+    int mon = 1 + (rand() % 12);
+    int dow = rand() % 8;
+
+    switch(rand() % 12)
+    {
+    case 0:
+        snprintf(schedule, size, "*/%d * * * *", 1 + (rand() % 30));
+        break;
+    case 1:
+        snprintf(schedule, size, "%d * * * *", m);
+        break;
+    case 2:
+        snprintf(schedule, size, "%d %d * * *", m, h);
+        break;
+    case 3:
+        snprintf(schedule, size, "%d %d %d * *", m, h, dom);
+        break;
+    case 4:
+        snprintf(schedule, size, "%d %d * * %d", m, h, dow);
+        break;
+    case 5:
+        snprintf(schedule, size, "%d %d %d %d *", m, h, dom, mon);
+        break;
+    case 6:
+        snprintf(schedule, size, "%d-%d/%d %d-%d * * *", m % 30, 30 + (m % 30),
+                 1 + (rand() % 7), h % 12, 12 + (h % 12));
+        break;
+    case 7:
+        snprintf(schedule, size, "%d,%d,%d %d * * *", m % 20, 20 + (m % 20),
+                 40 + (m % 20), h);
+        break;
+    case 8:
+        snprintf(schedule, size, "%d %d * * %d-%d", m, h, dow % 4, 4 + (dow % 4));
+        break;
+    case 9:
+        snprintf(schedule, size, "%d */%d * * *", m, 1 + (rand() % 12));
+        break;
+    case 10:
+        /*Leap day and the hours that DST transitions skip or repeat*/
+        snprintf(schedule, size, (rand() % 2) ? "%d 2 29 2 *" : "%d 1-3 * * *", m);
+        break;
+    default:
+        snprintf(schedule, size, "%s", specials[rand() % 5]);
+        break;
+    }
+}
+
+static void
+fireAction(void* actionData)
+{
+    simEntry_t* entry = (simEntry_t*)actionData;
+
+    entry->fires++;
+    sim.totalFires++;
+    sim.firedThisTick[sim.numFiredThisTick++] = entry->index;
+
+    if(sim.fireLog != NULL)
+    {
+        fprintf(sim.fireLog, "%04d-%02d-%02d %02d:%02d %d %s\n",
+                sim.now.tm_year + 1900, sim.now.tm_mon + 1, sim.now.tm_mday,
+                sim.now.tm_hour, sim.now.tm_min, entry->index, entry->schedule);
+    }
+}
+
+static int
+compareInts(const void* a, const void* b)
+{
+    return *(const int*)a - *(const int*)b;
+}
+
+/*Returns the number of entries on which libhoro and the reference disagree*/
+static int
+compareTick(int* refFired)
+{
+    int numRefFired = 0;
+    int mismatches = 0;
+    int i = 0;
+    int j = 0;
+    long packedNow = packLocalTime(&sim.now);
+
+    for(i = 0; i < sim.numEntries; i++)
+    {
+        simEntry_t* entry = &sim.entries[i];
+        if(refMatches(&entry->ref, &sim.now) && (entry->lastRefFire != packedNow))
+        {
+            entry->lastRefFire = packedNow;
+            refFired[numRefFired++] = i;
+        }
+    }
+
+    qsort(sim.firedThisTick, sim.numFiredThisTick, sizeof(int), compareInts);
+
+    i = 0;
+    while((i < sim.numFiredThisTick) || (j < numRefFired))
+    {
+        int horoIndex = (i < sim.numFiredThisTick) ? sim.firedThisTick[i] : sim.numEntries;
+        int refIndex = (j < numRefFired) ? refFired[j] : sim.numEntries;
+
+        if(horoIndex == refIndex)
+        {
+            i++;
+            j++;
+            continue;
+        }
+
+        mismatches++;
+        if(mismatches <= MAX_MISMATCHES_REPORTED)
+        {
+            int index = (horoIndex < refIndex) ? horoIndex : refIndex;
+            fprintf(stderr, "MISMATCH %04d-%02d-%02d %02d:%02d (dow %d) '%s': "
+                    "libhoro %s, reference %s\n",
+                    sim.now.tm_year + 1900, sim.now.tm_mon + 1, sim.now.tm_mday,
+                    sim.now.tm_hour, sim.now.tm_min, sim.now.tm_wday,
+                    sim.entries[index].schedule,
+                    (horoIndex < refIndex) ? "fired" : "did not fire",
+                    (horoIndex < refIndex) ? "did not" : "fired");
+        }
+
+        if(horoIndex < refIndex) i++;
+        else j++;
+    }
+
+    return mismatches;
+}
+
+static int
+loadSchedules(const char* path)
+{
+    char line[MAX_SCHEDULE_LENGTH];
+    int capacity = 1024;
+    FILE* file = fopen(path, "r");
+
+    if(file == NULL)
+    {
+        perror(path);
+        return 0;
+    }
+
+    sim.entries = (simEntry_t*)malloc(capacity * sizeof(simEntry_t));
+    while((sim.entries != NULL) && (fgets(line, sizeof(line), file) != NULL))
+    {
+        line[strcspn(line, "\r\n")] = '\0';
+        if((line[0] == '\0') || (line[0] == '#')) continue;
+
+        if(sim.numEntries == capacity)
+        {
+            capacity *= 2;
+            sim.entries = (simEntry_t*)realloc(sim.entries, capacity * sizeof(simEntry_t));
+            if(sim.entries == NULL) break;
+        }
+        strcpy(sim.entries[sim.numEntries++].schedule, line);
+    }
+
+    fclose(file);
+    return sim.entries != NULL;
+}
+
+static int
+generateSchedules(int count)
+{
+    int i = 0;
+
+    sim.entries = (simEntry_t*)malloc(count * sizeof(simEntry_t));
+    if(sim.entries == NULL) return 0;
+
+    for(i = 0; i < count; i++)
+    {
+        randomSchedule(sim.entries[i].schedule, MAX_SCHEDULE_LENGTH);
+    }
+    sim.numEntries = count;
+    return 1;
+}
+
+int
+main(int argc, char** argv)
+{
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_clock_t* horoClock = NULL;
+    const char* scheduleFile = NULL;
+    const char* logFile = NULL;
+    const char* zone = NULL;
+    int count = 1000;
+    int year = 2024;
+    int month = 1;
+    int day = 1;
+    int days = 366;
+    int ticksPerMinute = 1;
+    int compare = 0;
+    unsigned int seed = 1;
+    int* refFired = NULL;
+    long long ticks = 0;
+    long long mismatches = 0;
+    int rejected = 0;
+    double cpuSeconds = 0.0;
+    struct tm startTm;
+    time_t now;
+    time_t end;
+    int i = 0;
+
+    for(i = 1; i < argc; i++)
+    {
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if(strcmp(argv[i], "-c") == 0)
+        {
+            compare = 1;
+            continue;
+        }
+        if(value == NULL)
+        {
+            usage();
+            exit(EXIT_FAILURE);
+        }
+
+        if(strcmp(argv[i], "-f") == 0) scheduleFile = value;
+        else if(strcmp(argv[i], "-n") == 0) count = atoi(value);
+        else if(strcmp(argv[i], "-d") == 0) days = atoi(value);
+        else if(strcmp(argv[i], "-z") == 0) zone = value;
+        else if(strcmp(argv[i], "-t") == 0) ticksPerMinute = atoi(value);
+        else if(strcmp(argv[i], "-l") == 0) logFile = value;
+        else if(strcmp(argv[i], "-r") == 0) seed = (unsigned int)atoi(value);
+        else if(strcmp(argv[i], "-s") == 0)
+        {
+            if(sscanf(value, "%d-%d-%d", &year, &month, &day) != 3)
+            {
+                usage();
+                exit(EXIT_FAILURE);
+            }
+        }
+        else
+        {
+            usage();
+            exit(EXIT_FAILURE);
+        }
+        i++;
+    }
+
+    if((count < 0) || (days <= 0) || (ticksPerMinute <= 0))
+    {
+        usage();
+        exit(EXIT_FAILURE);
+    }
+
+    if(zone != NULL)
+    {
+        setTimeZone(zone);
+    }
+    tzset();
+    srand(seed);
+
+    if(!(scheduleFile ? loadSchedules(scheduleFile) : generateSchedules(count)))
+    {
+        fprintf(stderr, "Unable to load schedules\n");
+        exit(EXIT_FAILURE);
+    }
+
+    sim.firedThisTick = (int*)malloc((sim.numEntries + 1) * sizeof(int));
+    refFired = (int*)malloc((sim.numEntries + 1) * sizeof(int));
+    if((sim.firedThisTick == NULL) || (refFired == NULL))
+    {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if(logFile != NULL)
+    {
+        sim.fireLog = fopen(logFile, "w");
+        if(sim.fireLog == NULL)
+        {
+            perror(logFile);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    err = horo_init(&horoClock);
+    if(err)
+    {
+        fprintf(stderr, "Error in horo_init: %d\n", err);
+        exit(EXIT_FAILURE);
+    }
+
+    for(i = 0; i < sim.numEntries; i++)
+    {
+        simEntry_t* entry = &sim.entries[i];
+
+        entry->index = i;
+        entry->fires = 0;
+        entry->lastRefFire = -1;
+
+        err = horo_scheduleAction(horoClock, entry->schedule, fireAction, entry,
+                                  &entry->actionID);
+        if(err || !refParse(entry->schedule, &entry->ref))
+        {
+            if(rejected++ < MAX_MISMATCHES_REPORTED)
+            {
+                fprintf(stderr, "Rejected '%s' (libhoro error %d)\n",
+                        entry->schedule, err);
+            }
+            if(!err)
+            {
+                horo_unscheduleAction(horoClock, entry->actionID);
+            }
+            /*Never matches in the reference either*/
+            memset(&entry->ref, 0, sizeof(entry->ref));
+        }
+    }
+
+    memset(&startTm, 0, sizeof(startTm));
+    startTm.tm_year = year - 1900;
+    startTm.tm_mon = month - 1;
+    startTm.tm_mday = day;
+    startTm.tm_isdst = -1;
+    now = mktime(&startTm);
+
+    startTm.tm_mday += days;
+    startTm.tm_isdst = -1;
+    end = mktime(&startTm);
+
+    for(; now < end; now += 60)
+    {
+        horo_time_t horoTime;
+        int tick = 0;
+
+        localtime_r(&now, &sim.now);
+        horoTime.minute = sim.now.tm_min;
+        horoTime.hour = sim.now.tm_hour;
+        horoTime.dayOfMonth = sim.now.tm_mday;
+        horoTime.month = sim.now.tm_mon + 1;
+        horoTime.dayOfWeek = sim.now.tm_wday;
+        horoTime.second = 0;
+
+        sim.numFiredThisTick = 0;
+        for(tick = 0; tick < ticksPerMinute; tick++)
+        {
+            clock_t start = clock();
+            err = horo_process(horoClock, &horoTime);
+            cpuSeconds += (double)(clock() - start) / CLOCKS_PER_SEC;
+            ticks++;
+
+            if(err)
+            {
+                fprintf(stderr, "Error in horo_process: %d\n", err);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        if(compare)
+        {
+            mismatches += compareTick(refFired);
+        }
+    }
+
+    fprintf(stdout, "entries:        %d (%d rejected)\n", sim.numEntries, rejected);
+    fprintf(stdout, "ticks:          %lld\n", ticks);
+    fprintf(stdout, "fires:          %lld\n", sim.totalFires);
+    fprintf(stdout, "process cpu:    %.3f s\n", cpuSeconds);
+    if(cpuSeconds > 0.0)
+    {
+        fprintf(stdout, "ticks/second:   %.0f\n", ticks / cpuSeconds);
+        fprintf(stdout, "fires/second:   %.0f\n", sim.totalFires / cpuSeconds);
+    }
+    if(compare)
+    {
+        fprintf(stdout, "mismatches:     %lld\n", mismatches);
+    }
+
+    if(sim.fireLog != NULL)
+    {
+        fclose(sim.fireLog);
+    }
+    horo_destroy(horoClock);
+    free(sim.entries);
+    free(sim.firedThisTick);
+    free(refFired);
+
+    exit(mismatches ? EXIT_FAILURE : EXIT_SUCCESS);
+}
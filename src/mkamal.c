@@ -0,0 +1,207 @@
+/**
+ * December 19, 2013
+ * The author disclaims copyright to this source code.
+ */
+
+/*
+ * Generates horo-single.h, the whole library as one stb style header, and
+ * horo-amal.c, a file that compiles it for builds that want an object file.
+ * Run it in the source directory after lemon and flex have generated cron.c
+ * and lex.horo.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SINGLE_HEADER_NAME "horo-single.h"
+#define AMALGAMATION_NAME "horo-amal.c"
+
+/*Everything after horo.h, in the order the sources need each other*/
+static const char* implementationFiles[] = {
+    "cron.h", "Parser.h", "Trace.h", "Parser.c", "cron.c", "lex.horo.c",
+    "Histogram.h", "Histogram.c", "Zone.h", "Zone.c", "SharedClock.c",
+    "Crontab.c", "horo.c", NULL
+};
+
+static const char singleHeaderPreamble[] =
+    "/**\n"
+    " * " SINGLE_HEADER_NAME ", generated by mkamal from the libhoro sources.\n"
+    " * The author disclaims copyright to this source code.\n"
+    " *\n"
+    " * Include it like horo.h.  In exactly one C or C++ file write\n"
+    " *\n"
+    " *     #define HORO_IMPLEMENTATION\n"
+    " *     #include \"" SINGLE_HEADER_NAME "\"\n"
+    " *\n"
+    " * to compile the library into that file.  Its internal functions are\n"
+    " * static there.  Defining HORO_STATIC as well makes the public functions\n"
+    " * static too, so that horo_process() and the schedule matcher can be\n"
+    " * inlined into the caller's tick loop without link time optimization.\n"
+    " */\n\n";
+
+static const char implementationBegin[] =
+    "\n#ifdef HORO_IMPLEMENTATION\n"
+    "#ifndef HORO_IMPLEMENTATION_INCLUDED\n"
+    "#define HORO_IMPLEMENTATION_INCLUDED\n\n"
+    "#undef HORO_INTERNAL\n"
+    "#ifdef __GNUC__\n"
+    "#define HORO_INTERNAL static __attribute__((unused))\n"
+    "#else\n"
+    "#define HORO_INTERNAL static\n"
+    "#endif\n";
+
+static const char implementationEnd[] =
+    "\n#endif /*HORO_IMPLEMENTATION_INCLUDED*/\n"
+    "#endif /*HORO_IMPLEMENTATION*/\n";
+
+static const char amalgamation[] =
+    "/**\n"
+    " * " AMALGAMATION_NAME ", generated by mkamal.  Compiles the library in\n"
+    " * " SINGLE_HEADER_NAME ".\n"
+    " */\n\n"
+    "#define HORO_IMPLEMENTATION\n"
+    "#include \"" SINGLE_HEADER_NAME "\"\n";
+
+/*Reads one line including its newline, returns 0 at the end of the file*/
+static int
+readLine(FILE* in, char** line, size_t* capacity)
+{
+    size_t length = 0;
+    int c = 0;
+
+    while((c = getc(in)) != EOF)
+    {
+        if(length + 2 > *capacity)
+        {
+            size_t newCapacity = (*capacity == 0) ? 256 : (*capacity * 2);
+            char* newLine = (char*)realloc(*line, newCapacity);
+            if(newLine == NULL)
+            {
+                fprintf(stderr, "mkamal: out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            *line = newLine;
+            *capacity = newCapacity;
+        }
+
+        (*line)[length++] = (char)c;
+        if(c == '\n') break;
+    }
+
+    if(length == 0) return 0;
+    (*line)[length] = '\0';
+    return 1;
+}
+
+/*Returns the text after '#' and 'directive' or NULL if the line is not one*/
+static const char*
+matchDirective(const char* line, const char* directive)
+{
+    size_t length = strlen(directive);
+
+    while(*line == ' ' || *line == '\t') line++;
+    if(*line++ != '#') return NULL;
+    while(*line == ' ' || *line == '\t') line++;
+    if(strncmp(line, directive, length) != 0) return NULL;
+
+    return line + length;
+}
+
+/*
+ * Copies a source file.  "#line" markers no longer point at the right
+ * place and are dropped.  Includes of the library's own headers are
+ * commented out since the header is already part of the output, the rest
+ * of the line stays because it may open a comment.
+ */
+static void
+copyFile(FILE* out, const char* name)
+{
+    FILE* in = fopen(name, "r");
+    char* line = NULL;
+    size_t capacity = 0;
+    const char* rest = NULL;
+
+    if(in == NULL)
+    {
+        fprintf(stderr, "mkamal: can not open %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(out, "\n/******** %s ********/\n", name);
+    while(readLine(in, &line, &capacity))
+    {
+        if(matchDirective(line, "line") != NULL)
+        {
+            continue;
+        }
+
+        rest = matchDirective(line, "include");
+        if(rest != NULL)
+        {
+            while(*rest == ' ' || *rest == '\t') rest++;
+            if(*rest == '"')
+            {
+                const char* end = strchr(rest + 1, '"');
+                if(end != NULL)
+                {
+                    fprintf(out, "/*#include %.*s*/%s",
+                            (int)(end - rest + 1), rest, end + 1);
+                    continue;
+                }
+            }
+        }
+
+        fputs(line, out);
+    }
+
+    free(line);
+    fclose(in);
+}
+
+static FILE*
+openOutput(const char* name)
+{
+    FILE* out = fopen(name, "w");
+    if(out == NULL)
+    {
+        fprintf(stderr, "mkamal: can not create %s\n", name);
+        exit(EXIT_FAILURE);
+    }
+    return out;
+}
+
+static void
+closeOutput(FILE* out, const char* name)
+{
+    if(ferror(out) || fclose(out) != 0)
+    {
+        fprintf(stderr, "mkamal: error writing %s\n", name);
+        remove(name);
+        exit(EXIT_FAILURE);
+    }
+}
+
+int
+main(void)
+{
+    FILE* out = NULL;
+    size_t i = 0;
+
+    out = openOutput(SINGLE_HEADER_NAME);
+    fputs(singleHeaderPreamble, out);
+    copyFile(out, "horo.h");
+    fputs(implementationBegin, out);
+    for(i = 0; implementationFiles[i] != NULL; i++)
+    {
+        copyFile(out, implementationFiles[i]);
+    }
+    fputs(implementationEnd, out);
+    closeOutput(out, SINGLE_HEADER_NAME);
+
+    out = openOutput(AMALGAMATION_NAME);
+    fputs(amalgamation, out);
+    closeOutput(out, AMALGAMATION_NAME);
+
+    return EXIT_SUCCESS;
+}
@@ -9,6 +9,12 @@
 #include <string.h>
 #include <time.h>
 
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #include "horo.h"
 
 typedef struct
@@ -45,7 +51,12 @@ char *errorStrings[] = {
     "Day of Week Range Error",
     "Illegal Field",
     "Generic Out of Range Error",
-    "Unknown Action ID"
+    "Unknown Action ID",
+    "Unsupported Version",
+    "Not Supported",
+    "I/O Error",
+    "Second Range Error",
+    "Unknown Zone"
 };
 
 /**
@@ -323,10 +334,2072 @@ testRemove()
     assert(count == 0);
 }
 
+static void
+busyAction(void* actionData)
+{
+    int* calls = (int*)actionData;
+    clock_t start = clock();
+
+    while((clock() - start) < (CLOCKS_PER_SEC / 500));
+    (*calls)++;
+}
+
+static void
+testActionStats()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_action_stats_t stats;
+    horo_time_t timeVals = {0, 0, 1, 1, 0};
+    int actionID = -1;
+    int calls = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleAction(clock, "* * * * *", busyAction, &calls, &actionID);
+    assert(err == HORO_SUCCESS);
+
+    //Nothing is recorded until stats are enabled
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    err = horo_getActionStats(clock, actionID, &stats);
+    assert(err == HORO_SUCCESS);
+    assert(stats.duration.count == 0);
+
+    err = horo_enableActionStats(clock, 1);
+    assert(err == HORO_SUCCESS);
+
+    for(timeVals.minute = 1; timeVals.minute < 11; timeVals.minute++)
+    {
+        err = horo_process(clock, &timeVals);
+        assert(err == HORO_SUCCESS);
+    }
+    assert(calls == 11);
+
+    err = horo_getActionStats(clock, actionID, &stats);
+    assert(err == HORO_SUCCESS);
+    assert(stats.duration.count == 10);
+    assert(stats.lateness.count == 10);
+    assert(stats.duration.min >= 1900);
+    assert(stats.duration.min <= stats.duration.p50);
+    assert(stats.duration.p50 <= stats.duration.p99);
+    assert(stats.duration.p99 <= stats.duration.max);
+
+    err = horo_getActionStats(clock, actionID + 1, &stats);
+    assert(err == HORO_ERROR_UNKNOWN_ACTION);
+
+    //Actions with a seconds field are late from their second on
+    err = horo_scheduleAction(clock, "* * * * * *", busyAction, &calls, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_processUtc(clock, (int64_t)time(NULL));
+    assert(err == HORO_SUCCESS);
+    err = horo_getActionStats(clock, actionID, &stats);
+    assert((stats.lateness.count == 1) && (stats.lateness.max < 2000000));
+
+    horo_destroy(clock);
+}
+
+typedef struct
+{
+    int begins[3];
+    int ends[3];
+    int lastActionID;
+    HORO_ERROR lastError;
+}traceCounts_t;
+
+static void
+traceBegin(void* userp, horo_trace_event_t const* event)
+{
+    traceCounts_t* counts = (traceCounts_t*)userp;
+    counts->begins[event->type]++;
+}
+
+static void
+traceEnd(void* userp, horo_trace_event_t const* event)
+{
+    traceCounts_t* counts = (traceCounts_t*)userp;
+    counts->ends[event->type]++;
+    counts->lastError = event->error;
+    if(event->type == HORO_TRACE_ACTION)
+    {
+        counts->lastActionID = event->actionID;
+        assert(event->minuteMask == ((uint64_t)1 << 5));
+        assert(event->hourMask == 0xFFFFFF);
+    }
+}
+
+static void
+testTraceHooks()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    traceCounts_t counts;
+    horo_time_t timeVals = {5, 0, 1, 1, 0};
+    int actionID = -1;
+
+    memset(&counts, 0, sizeof(counts));
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+    err = horo_setTraceHooks(clock, traceBegin, traceEnd, &counts);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleAction(clock, "60 * * * *", dummyAction, NULL, &actionID);
+    assert(err == HORO_ERROR_PARSER_MINUTE_RANGE);
+    assert(counts.lastError == HORO_ERROR_PARSER_MINUTE_RANGE);
+
+    err = horo_scheduleAction(clock, "5 * * * *", dummyAction, NULL, &actionID);
+    assert(err == HORO_SUCCESS);
+    assert(counts.begins[HORO_TRACE_PARSE] == 2);
+    assert(counts.ends[HORO_TRACE_PARSE] == 2);
+
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(counts.begins[HORO_TRACE_PROCESS] == 1);
+    assert(counts.ends[HORO_TRACE_PROCESS] == 1);
+    assert(counts.begins[HORO_TRACE_ACTION] == 1);
+    assert(counts.ends[HORO_TRACE_ACTION] == 1);
+    assert(counts.lastActionID == actionID);
+
+    timeVals.minute = 60;
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_ERROR_OUT_OF_RANGE);
+    assert(counts.ends[HORO_TRACE_PROCESS] == 2);
+    assert(counts.lastError == HORO_ERROR_OUT_OF_RANGE);
+
+    horo_destroy(clock);
+}
+
+typedef struct
+{
+    horo_clock_t* clock;
+    int otherID;
+    uint32_t counts[2];
+}forecastingAction_t;
+
+static void
+unscheduleAndForecast(void* data)
+{
+    forecastingAction_t* context = (forecastingAction_t*)data;
+    int actionID = -1;
+
+    assert(horo_unscheduleAction(context->clock, context->otherID) == HORO_SUCCESS);
+    assert(horo_scheduleAction(context->clock, "* * * * *", dummyAction, NULL,
+                               &actionID) == HORO_SUCCESS);
+    assert(horo_forecast(context->clock, 0, 60, context->counts) == HORO_SUCCESS);
+}
+
+static void
+testForecast()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    uint32_t counts[24 * 60];
+    horo_time_t timeVals = {0, 3, 1, 1, 3, 0};
+    forecastingAction_t forecaster;
+    struct tm day;
+    time_t from;
+    int actionID = -1;
+    int i = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    for(i = 0; i < 3; i++)
+    {
+        err = horo_scheduleAction(clock, "*/15 * * * *", dummyAction, NULL, &actionID);
+        assert(err == HORO_SUCCESS);
+    }
+    err = horo_scheduleAction(clock, "30 2 * * *", dummyAction, NULL, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "@daily", dummyAction, NULL, &actionID);
+    assert(err == HORO_SUCCESS);
+    //Only fires on Saturdays, January 15th 2014 is a Wednesday.
+    err = horo_scheduleAction(clock, "* * * * 6", dummyAction, NULL, &actionID);
+    assert(err == HORO_SUCCESS);
+
+    memset(&day, 0, sizeof(day));
+    day.tm_year = 2014 - 1900;
+    day.tm_mon = 0;
+    day.tm_mday = 15;
+    day.tm_isdst = -1;
+    from = mktime(&day);
+
+    err = horo_forecast(clock, from, from + (24 * 60 * 60), counts);
+    assert(err == HORO_SUCCESS);
+
+    assert(counts[0] == 4);
+    assert(counts[1] == 0);
+    assert(counts[15] == 3);
+    assert(counts[(2 * 60) + 30] == 4);
+    assert(counts[(23 * 60) + 59] == 0);
+
+    //Saturday January 18th
+    err = horo_forecast(clock, from + (3 * 24 * 60 * 60),
+                        from + (3 * 24 * 60 * 60) + 120, counts);
+    assert(err == HORO_SUCCESS);
+    assert(counts[0] == 5);
+    assert(counts[1] == 1);
+
+    err = horo_forecast(clock, from + 60, from, counts);
+    assert(err == HORO_ERROR_ILLEGAL_ARG);
+
+    //The window starts at the minute of 'from', also before 1970
+    memset(counts, 0xff, sizeof(counts));
+    err = horo_forecast(clock, from + 30, from + 90, counts);
+    assert(err == HORO_SUCCESS);
+    assert((counts[0] == 4) && (counts[1] == 0) && (counts[2] == UINT32_MAX));
+    horo_destroy(clock);
+
+    err = horo_init(&clock);
+    err = horo_scheduleAction(clock, "* * * * *", dummyAction, NULL, &actionID);
+    assert(err == HORO_SUCCESS);
+    memset(counts, 0xff, sizeof(counts));
+    err = horo_forecast(clock, -30, 30, counts);
+    assert(err == HORO_SUCCESS);
+    assert((counts[0] == 1) && (counts[1] == 1) && (counts[2] == UINT32_MAX));
+
+    //Called from an action, unscheduled and new actions are left out
+    memset(&forecaster, 0, sizeof(forecaster));
+    forecaster.clock = clock;
+    forecaster.otherID = actionID;
+    err = horo_scheduleAction(clock, "* * * * *", unscheduleAndForecast, &forecaster,
+                              &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(forecaster.counts[0] == 1);
+
+    horo_destroy(clock);
+}
+
+typedef struct
+{
+    int actionIDs[64];
+    time_t fireTimes[64];
+    int numFires;
+    int maxFires;
+}windowFires_t;
+
+static HORO_ERROR
+collectFire(void* userp, int actionID, time_t fireTime)
+{
+    windowFires_t* fires = (windowFires_t*)userp;
+
+    if(fires->numFires == fires->maxFires) return HORO_ERROR_OUT_OF_RANGE;
+
+    fires->actionIDs[fires->numFires] = actionID;
+    fires->fireTimes[fires->numFires] = fireTime;
+    fires->numFires++;
+    return HORO_SUCCESS;
+}
+
+static void
+testQueryWindow()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    windowFires_t fires;
+    const time_t from = 1389744000; //Wednesday, January 15th 2014 00:00 UTC
+    int quarterID = -1;
+    int nightlyID = -1;
+    int secondsID = -1;
+    int actionID = -1;
+    int i = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleActionInZone(clock, "*/15 * * * *", "UTC", dummyAction, NULL,
+                                    &quarterID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleActionInZone(clock, "30 2 * * *", "UTC", dummyAction, NULL,
+                                    &nightlyID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleActionInZone(clock, "*/20 0 * * * *", "UTC", dummyAction, NULL,
+                                    &secondsID);
+    assert(err == HORO_SUCCESS);
+    //Saturdays only
+    err = horo_scheduleActionInZone(clock, "* * * * 6", "UTC", dummyAction, NULL, &actionID);
+    assert(err == HORO_SUCCESS);
+
+    memset(&fires, 0, sizeof(fires));
+    fires.maxFires = 64;
+    err = horo_queryWindow(clock, from, from + (3 * 60 * 60), collectFire, &fires);
+    assert(err == HORO_SUCCESS);
+    assert(fires.numFires == 12 + 1 + 9);
+
+    //Chronological, equal times by id
+    assert((fires.actionIDs[0] == quarterID) && (fires.fireTimes[0] == from));
+    assert((fires.actionIDs[1] == secondsID) && (fires.fireTimes[1] == from));
+    assert((fires.actionIDs[2] == secondsID) && (fires.fireTimes[2] == from + 20));
+    assert((fires.actionIDs[4] == quarterID) && (fires.fireTimes[4] == from + (15 * 60)));
+    for(i = 1; i < fires.numFires; i++)
+    {
+        assert(fires.fireTimes[i - 1] <= fires.fireTimes[i]);
+    }
+    assert(fires.fireTimes[fires.numFires - 1] == from + (2 * 60 * 60) + (45 * 60));
+    assert(fires.actionIDs[fires.numFires - 2] == nightlyID);
+
+    //The window starts mid minute and leaves out paused actions
+    err = horo_setActionEnabled(clock, quarterID, 0);
+    assert(err == HORO_SUCCESS);
+    memset(&fires, 0, sizeof(fires));
+    fires.maxFires = 64;
+    err = horo_queryWindow(clock, from + 30, from + (2 * 60 * 60) + (31 * 60), collectFire,
+                           &fires);
+    assert(err == HORO_SUCCESS);
+    assert(fires.numFires == 1 + 6 + 1);
+    assert(fires.fireTimes[0] == from + 40);
+
+    //Errors from the callback stop the query
+    memset(&fires, 0, sizeof(fires));
+    fires.maxFires = 2;
+    err = horo_queryWindow(clock, from, from + (3 * 60 * 60), collectFire, &fires);
+    assert(err == HORO_ERROR_OUT_OF_RANGE);
+    assert(fires.numFires == 2);
+
+    err = horo_queryWindow(clock, from + 60, from, collectFire, &fires);
+    assert(err == HORO_ERROR_ILLEGAL_ARG);
+    horo_destroy(clock);
+
+    //01:30 happens twice on November 2nd 2014 in New York
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleActionInZone(clock, "30 1 * * *", "America/New_York", dummyAction,
+                                    NULL, &actionID);
+    assert(err == HORO_SUCCESS);
+    memset(&fires, 0, sizeof(fires));
+    fires.maxFires = 64;
+    err = horo_queryWindow(clock, 1414900800, 1414900800 + (4 * 60 * 60), collectFire,
+                           &fires);
+    assert(err == HORO_SUCCESS);
+    assert(fires.numFires == 2);
+    assert(fires.fireTimes[0] == 1414900800 + (90 * 60));
+    assert(fires.fireTimes[1] == 1414900800 + (150 * 60));
+
+    horo_destroy(clock);
+}
+
+typedef struct
+{
+    unsigned char bytes[4096];
+    size_t size;
+}snapshotBuffer_t;
+
+static HORO_ERROR
+writeSnapshot(void* userp, const void* data, size_t size)
+{
+    snapshotBuffer_t* buffer = (snapshotBuffer_t*)userp;
+
+    if((buffer->size + size) > sizeof(buffer->bytes))
+    {
+        return HORO_ERROR_NO_MEM;
+    }
+    memcpy(buffer->bytes + buffer->size, data, size);
+    buffer->size += size;
+    return HORO_SUCCESS;
+}
+
+static void
+countAction(void* actionData)
+{
+    (*(int*)actionData)++;
+}
+
+static int restoredCalls = 0;
+
+static HORO_ERROR
+resolveAction(void* userp, const char* key, horo_actionFunc* oAction,
+              void** oActionData)
+{
+    //Drop the action without a key
+    *oAction = (key[0] != '\0') ? countAction : NULL;
+    *oActionData = &restoredCalls;
+    return HORO_SUCCESS;
+}
+
+static int releasedData = 0;
+
+//Fails at the key "hourly"
+static HORO_ERROR
+resolveUntilHourly(void* userp, const char* key, horo_actionFunc* oAction,
+                   void** oActionData)
+{
+    if(strcmp(key, "hourly") == 0) return HORO_ERROR_UNKNOWN_ACTION;
+
+    *oAction = countAction;
+    *oActionData = userp;
+    return HORO_SUCCESS;
+}
+
+static void
+releaseData(void* userp, void* actionData)
+{
+    assert(actionData == userp);
+    releasedData++;
+}
+
+static void
+testSnapshot()
+{
+    horo_clock_t* clock = NULL;
+    horo_clock_t* restored = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    snapshotBuffer_t buffer;
+    snapshotBuffer_t second;
+    horo_time_t timeVals = {5, 0, 1, 1, 0};
+    size_t i = 0;
+    int calls = 0;
+    int actionID = -1;
+    int count = 0;
+
+    memset(&buffer, 0, sizeof(buffer));
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleAction(clock, "*/5 * * * *", countAction, &calls, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_setActionKey(clock, actionID, "every-five");
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "1 * * * *", countAction, &calls, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_setActionKey(clock, actionID, "hourly");
+    assert(err == HORO_SUCCESS);
+    err = horo_setActionKey(clock, 99, "unknown");
+    assert(err == HORO_ERROR_UNKNOWN_ACTION);
+
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(calls == 2);
+
+    err = horo_serialize(clock, writeSnapshot, &buffer);
+    assert(err == HORO_SUCCESS);
+    assert((buffer.size % 8) == 0);
+
+    err = horo_init(&restored);
+    assert(err == HORO_SUCCESS);
+    err = horo_deserialize(restored, buffer.bytes, buffer.size - 8,
+                           resolveAction, NULL, NULL);
+    assert(err == HORO_ERROR_CORRUPT);
+    err = horo_deserialize(restored, buffer.bytes, buffer.size,
+                           resolveAction, NULL, NULL);
+    assert(err == HORO_SUCCESS);
+    err = horo_actionCount(restored, &count);
+    assert(count == 2);
+
+    //The every-five action already ran in this minute before the snapshot
+    err = horo_process(restored, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(restoredCalls == 0);
+
+    timeVals.minute = 1;
+    err = horo_process(restored, &timeVals);
+    assert(restoredCalls == 1);
+
+    //IDs and the ID counter survive the restore
+    err = horo_unscheduleAction(restored, 2);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(restored, "* * * * *", countAction, &calls, &actionID);
+    assert(actionID == 3);
+
+    //The data of the actions resolved before the failure is given back
+    horo_destroy(restored);
+    err = horo_init(&restored);
+    err = horo_deserialize(restored, buffer.bytes, buffer.size, resolveUntilHourly,
+                           releaseData, &calls);
+    assert(err == HORO_ERROR_UNKNOWN_ACTION);
+    assert(releasedData == 2);
+    err = horo_actionCount(restored, &count);
+    assert(count == 0);
+    horo_destroy(restored);
+
+    buffer.bytes[0] = 'X';
+    err = horo_deserialize(clock, buffer.bytes, buffer.size, resolveAction, NULL, NULL);
+    assert(err == HORO_ERROR_ILLEGAL_ARG);
+
+    horo_destroy(clock);
+
+    //Snapshots with the IDs 0 and 1, and 0 and 2, differ in the next ID and
+    //in the ID of the second action.  Copying 0 into the second ID makes a
+    //snapshot that lists ID 0 twice.
+    memset(&second, 0, sizeof(second));
+    err = horo_init(&clock);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+    err = horo_unscheduleAction(clock, 1);
+    assert(err == HORO_SUCCESS);
+    err = horo_serialize(clock, writeSnapshot, &second);
+    horo_destroy(clock);
+
+    buffer.size = 0;
+    err = horo_init(&clock);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+    err = horo_serialize(clock, writeSnapshot, &buffer);
+    horo_destroy(clock);
+
+    assert(buffer.size == second.size);
+    for(i = 0; (i < buffer.size) && (buffer.bytes[i] == second.bytes[i]); i++);
+    for(i++; (i < buffer.size) && (buffer.bytes[i] == second.bytes[i]); i++);
+    assert(i < buffer.size);
+    buffer.bytes[i] = 0;
+
+    err = horo_init(&restored);
+    err = horo_deserialize(restored, buffer.bytes, buffer.size, resolveUntilHourly,
+                           releaseData, &calls);
+    assert(err == HORO_ERROR_CORRUPT);
+    assert(releasedData == 3);
+    err = horo_actionCount(restored, &count);
+    assert(count == 0);
+    horo_destroy(restored);
+}
+
+static void
+testCheckpoint()
+{
+#ifndef _WIN32
+    const char* path = "test-checkpoint.bin";
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_time_t timeVals = {7, 3, 1, 1, 0};
+    horo_group_limits_t limits;
+    struct stat fileStat;
+    int calls = 0;
+    int actionID = -1;
+    int run = 0;
+
+    remove(path);
+
+    //The second run simulates a restart within the same minute
+    for(run = 0; run < 2; run++)
+    {
+        err = horo_init(&clock);
+        assert(err == HORO_SUCCESS);
+
+        err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+        assert(err == HORO_SUCCESS);
+        err = horo_setActionKey(clock, actionID, "job");
+        assert(err == HORO_SUCCESS);
+
+        err = horo_openCheckpoint(clock, path, 4);
+        assert(err == HORO_SUCCESS);
+
+        //Keys set after the checkpoint is opened are restored too
+        err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+        assert(err == HORO_SUCCESS);
+        err = horo_setActionKey(clock, actionID, "late-job");
+        assert(err == HORO_SUCCESS);
+
+        err = horo_process(clock, &timeVals);
+        assert(err == HORO_SUCCESS);
+        assert(calls == 2);
+
+        horo_destroy(clock);
+    }
+
+    timeVals.minute++;
+    err = horo_init(&clock);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+    err = horo_setActionKey(clock, actionID, "job");
+    err = horo_openCheckpoint(clock, path, 4);
+    assert(err == HORO_SUCCESS);
+    err = horo_process(clock, &timeVals);
+    assert(calls == 3);
+
+    //Keys that keep changing do not fill the file, rebuilds keep "job"
+    err = horo_scheduleAction(clock, "0 0 1 1 *", countAction, &calls, &actionID);
+    assert(err == HORO_SUCCESS);
+    for(run = 0; run < 1000; run++)
+    {
+        char key[32];
+
+        snprintf(key, sizeof(key), "edited-%d", run);
+        err = horo_setActionKey(clock, actionID, key);
+        assert(err == HORO_SUCCESS);
+    }
+    assert((stat(path, &fileStat) == 0) && (fileStat.st_size < 4096));
+    err = horo_process(clock, &timeVals);
+    assert(calls == 3);
+    horo_destroy(clock);
+
+    err = horo_init(&clock);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+    err = horo_setActionKey(clock, actionID, "job");
+    err = horo_openCheckpoint(clock, path, 4);
+    assert(err == HORO_SUCCESS);
+    err = horo_process(clock, &timeVals);
+    assert(calls == 3);
+    horo_destroy(clock);
+
+    //A run that waits in its group is recorded when it is called
+    timeVals.minute++;
+    err = horo_init(&clock);
+    memset(&limits, 0, sizeof(limits));
+    limits.maxInFlight = 1;
+    limits.maxPending = 1;
+    err = horo_setGroupLimits(clock, 1, &limits);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+    err = horo_setActionGroup(clock, actionID, 1, 0);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+    err = horo_setActionKey(clock, actionID, "job");
+    err = horo_setActionGroup(clock, actionID, 1, 0);
+    err = horo_openCheckpoint(clock, path, 4);
+    assert(err == HORO_SUCCESS);
+    err = horo_process(clock, &timeVals);
+    assert(calls == 4);
+    horo_destroy(clock);
+
+    err = horo_init(&clock);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &calls, &actionID);
+    err = horo_setActionKey(clock, actionID, "job");
+    err = horo_openCheckpoint(clock, path, 4);
+    assert(err == HORO_SUCCESS);
+    err = horo_process(clock, &timeVals);
+    assert(calls == 5);
+    horo_destroy(clock);
+
+    remove(path);
+#endif
+}
+
+static void
+countSharedAction(void* userp, int actionID, uint64_t tag)
+{
+    assert((uint64_t)actionID == tag);
+    ++(*(int*)userp);
+}
+
+static void
+testSharedClock()
+{
+#ifndef _WIN32
+    const char* name = "/horo-test-shared";
+    const int actionCount = 50;
+    const int processCount = 4;
+    horo_shared_clock_t* writer = NULL;
+    horo_shared_clock_t* reader = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    //2014-01-01 03:07:00 UTC
+    int64_t now = 1388545620;
+    pid_t children[4];
+    int actionID = -1;
+    int count = 0;
+    int calls = 0;
+    int total = 0;
+    int status = 0;
+    int i = 0;
+
+    horo_sharedUnlink(name);
+    err = horo_sharedCreate(name, actionCount, &writer);
+    assert(err == HORO_SUCCESS);
+
+    for(i = 0; i < actionCount; i++)
+    {
+        err = horo_sharedScheduleAction(writer, "* * * * *", i, &actionID);
+        assert(err == HORO_SUCCESS);
+        assert(actionID == i);
+    }
+    err = horo_sharedScheduleAction(writer, "* * * * *", i, &actionID);
+    assert(err == HORO_ERROR_NO_MEM);
+
+    //Every due action runs in exactly one of the competing processes
+    for(i = 0; i < processCount; i++)
+    {
+        children[i] = fork();
+        assert(children[i] >= 0);
+        if(children[i] == 0)
+        {
+            calls = 0;
+            if(horo_sharedAttach(name, &reader) != HORO_SUCCESS) _exit(255);
+            horo_sharedProcess(reader, now, countSharedAction, &calls);
+            horo_sharedDetach(reader);
+            _exit(calls);
+        }
+    }
+
+    for(i = 0; i < processCount; i++)
+    {
+        waitpid(children[i], &status, 0);
+        assert(WIFEXITED(status));
+        total += WEXITSTATUS(status);
+    }
+    assert(total == actionCount);
+
+    //Nothing is left for the same minute, everything is due again in the next
+    err = horo_sharedProcess(writer, now + 59, countSharedAction, &calls);
+    assert(err == HORO_SUCCESS);
+    assert(calls == 0);
+    now += 60;
+    err = horo_sharedProcess(writer, now, countSharedAction, &calls);
+    assert(calls == actionCount);
+
+    //A process that is behind can not run an earlier minute again
+    calls = 0;
+    err = horo_sharedProcess(writer, now - 60, countSharedAction, &calls);
+    assert(err == HORO_SUCCESS);
+    assert(calls == 0);
+
+    //Creating it again attaches to the live table
+    err = horo_sharedCreate(name, 1, &reader);
+    assert(err == HORO_SUCCESS);
+    err = horo_sharedActionCount(reader, &count);
+    assert(count == actionCount);
+    horo_sharedDetach(reader);
+
+    //Ids are reused and a rescheduled slot is claimable in the same minute
+    err = horo_sharedUnscheduleAction(writer, 10);
+    assert(err == HORO_SUCCESS);
+    err = horo_sharedUnscheduleAction(writer, 10);
+    assert(err == HORO_ERROR_UNKNOWN_ACTION);
+    err = horo_sharedActionCount(writer, &count);
+    assert(count == actionCount - 1);
+    err = horo_sharedScheduleAction(writer, "* * * * *", 10, &actionID);
+    assert(actionID == 10);
+
+    calls = 0;
+    err = horo_sharedProcess(writer, now, countSharedAction, &calls);
+    assert(calls == 1);
+
+    //Freed slots are reused most recent first
+    err = horo_sharedUnscheduleAction(writer, 3);
+    assert(err == HORO_SUCCESS);
+    err = horo_sharedUnscheduleAction(writer, 7);
+    assert(err == HORO_SUCCESS);
+    err = horo_sharedScheduleAction(writer, "* * * * *", 7, &actionID);
+    assert(actionID == 7);
+    err = horo_sharedScheduleAction(writer, "* * * * *", 3, &actionID);
+    assert(actionID == 3);
+    err = horo_sharedScheduleAction(writer, "* * * * *", 0, &actionID);
+    assert(err == HORO_ERROR_NO_MEM);
+
+    horo_sharedDetach(writer);
+    err = horo_sharedUnlink(name);
+    assert(err == HORO_SUCCESS);
+    err = horo_sharedAttach(name, &reader);
+    assert(err == HORO_ERROR_IO);
+#endif
+}
+
+static HORO_ERROR
+resolveCommand(void* userp, const char* command, horo_actionFunc* oAction,
+               void** oActionData)
+{
+    int* counters = (int*)userp;
+
+    if(strcmp(command, "fail") == 0) return HORO_ERROR_UNKNOWN_ACTION;
+
+    //The command names the counter to increment
+    *oAction = countAction;
+    *oActionData = &counters[atoi(command)];
+    return HORO_SUCCESS;
+}
+
+static void
+releaseCommand(void* userp, void* actionData)
+{
+    int* counters = (int*)userp;
+    counters[9]++;
+}
+
+static void
+writeCrontab(const char* path, const char* contents)
+{
+    FILE* file = fopen(path, "w");
+    assert(file != NULL);
+    fputs(contents, file);
+    fclose(file);
+}
+
+static void
+testSeconds()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_time_t timeVals = {0, 12, 1, 1, 3, 0};
+    uint32_t counts[1];
+    struct tm day;
+    int everyTen = 0;
+    int noon = 0;
+    int minutely = 0;
+    int late = 0;
+    int actionID = -1;
+    int count = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleAction(clock, "60 * * * * *", countAction, &everyTen, &actionID);
+    assert(err == HORO_ERROR_PARSER_SECOND_RANGE);
+
+    err = horo_scheduleAction(clock, "*/10 * * * * *", countAction, &everyTen, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "30 0 12 * * *", countAction, &noon, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &minutely, &actionID);
+    assert(err == HORO_SUCCESS);
+
+    //Tick every second of two minutes, twice per second
+    for(count = 0; count < 4 * 60; count++)
+    {
+        timeVals.minute = count / 120;
+        timeVals.second = (count / 2) % 60;
+        err = horo_process(clock, &timeVals);
+        assert(err == HORO_SUCCESS);
+
+        //An entry added mid minute still runs in that minute
+        if(count == 61)
+        {
+            err = horo_scheduleAction(clock, "* * * * *", countAction, &late, &actionID);
+            assert(err == HORO_SUCCESS);
+        }
+    }
+
+    assert(everyTen == 12);
+    assert(noon == 1);
+    assert(minutely == 2);
+    assert(late == 2);
+
+    //A leap second counts as the last second of the minute
+    timeVals.minute = 2;
+    timeVals.second = 60;
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(everyTen == 12);
+    timeVals.second = 61;
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_ERROR_OUT_OF_RANGE);
+
+    //Six field schedules are weighted by their number of seconds
+    memset(&day, 0, sizeof(day));
+    day.tm_year = 2014 - 1900;
+    day.tm_mday = 15;
+    day.tm_isdst = -1;
+    err = horo_unscheduleAction(clock, actionID);
+    err = horo_forecast(clock, mktime(&day), mktime(&day) + 60, counts);
+    assert(err == HORO_SUCCESS);
+    assert(counts[0] == 6 + 1);
+
+    horo_destroy(clock);
+
+    //Without six field schedules the second is not looked at
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &minutely, &actionID);
+    assert(err == HORO_SUCCESS);
+    minutely = 0;
+    timeVals.second = 12345;
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(minutely == 1);
+
+    horo_destroy(clock);
+}
+
+static void
+testZones()
+{
+    //2014-01-15 08:00:00 UTC, a Wednesday
+    const int64_t january = 1389772800;
+    //2014-07-15 08:00:00 UTC
+    const int64_t july = january + (181 * 24 * 60 * 60);
+    //2150-07-15 13:00:00 UTC, only covered by the zone's POSIX rule
+    const int64_t future = 5697176400LL;
+    horo_clock_t* clock = NULL;
+    horo_clock_t* restored = NULL;
+    snapshotBuffer_t buffer;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_time_t timeVals = {0, 9, 15, 1, 3, 0};
+    uint32_t counts[1];
+    int newYork = 0;
+    int berlin = 0;
+    int utc = 0;
+    int actionID = -1;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleActionInZone(clock, "0 9 * * *", "Mars/Olympus_Mons",
+                                    countAction, &utc, &actionID);
+    assert(err == HORO_ERROR_UNKNOWN_ZONE);
+    err = horo_scheduleActionInZone(clock, "0 9 * * *", "../../etc/passwd",
+                                    countAction, &utc, &actionID);
+    assert(err == HORO_ERROR_ILLEGAL_ARG);
+
+    err = horo_scheduleActionInZone(clock, "0 9 * * *", "America/New_York",
+                                    countAction, &newYork, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_setActionKey(clock, actionID, "new-york");
+    err = horo_scheduleActionInZone(clock, "0 9 * * *", "Europe/Berlin",
+                                    countAction, &berlin, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleActionInZone(clock, "0 9 * * *", "UTC",
+                                    countAction, &utc, &actionID);
+    assert(err == HORO_SUCCESS);
+
+    //Local time ticks do not run actions that live in a zone
+    err = horo_process(clock, &timeVals);
+    assert((newYork == 0) && (berlin == 0) && (utc == 0));
+
+    err = horo_processUtc(clock, january);
+    assert(err == HORO_SUCCESS);
+    assert((newYork == 0) && (berlin == 1) && (utc == 0));
+    err = horo_processUtc(clock, january + (60 * 60));
+    assert((newYork == 0) && (berlin == 1) && (utc == 1));
+    err = horo_processUtc(clock, january + (6 * 60 * 60));
+    assert((newYork == 1) && (berlin == 1) && (utc == 1));
+
+    //Daylight saving time moves the UTC time of the fires
+    err = horo_processUtc(clock, july - (60 * 60));
+    assert(berlin == 2);
+    err = horo_processUtc(clock, july + (5 * 60 * 60));
+    assert(newYork == 2);
+    err = horo_processUtc(clock, future);
+    assert(newYork == 3);
+
+    err = horo_forecast(clock, (time_t)(january + (6 * 60 * 60)),
+                        (time_t)(january + (6 * 60 * 60) + 60), counts);
+    assert(err == HORO_SUCCESS);
+    assert(counts[0] == 1);
+
+    //The zone is part of a snapshot
+    memset(&buffer, 0, sizeof(buffer));
+    err = horo_serialize(clock, writeSnapshot, &buffer);
+    assert(err == HORO_SUCCESS);
+    err = horo_init(&restored);
+    err = horo_deserialize(restored, buffer.bytes, buffer.size, resolveAction, NULL, NULL);
+    assert(err == HORO_SUCCESS);
+
+    restoredCalls = 0;
+    err = horo_processUtc(restored, january + (6 * 60 * 60) + (24 * 60 * 60));
+    assert(restoredCalls == 1);
+
+    horo_destroy(restored);
+    horo_destroy(clock);
+}
+
+static void
+testDstPolicies()
+{
+    //2014-03-09 06:50 UTC, New York springs forward from 02:00 to 03:00 at 07:00
+    const int64_t springForward = 1394347800;
+    //2014-11-02 05:00 UTC, New York falls back from 02:00 to 01:00 at 06:00
+    const int64_t fallBack = 1414904400;
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_group_limits_t limits;
+    horo_group_stats_t stats;
+    //Sunday, March 9th 02:30, skipped by springing forward
+    horo_time_t skippedTime = {30, 2, 9, 3, 0, 0};
+    const char* path = "test-dst-checkpoint.bin";
+    int restarted = 0;
+    int skippedOnce = 0;
+    int skippedSkip = 0;
+    int skippedTwice = 0;
+    int skippedSeconds = 0;
+    int repeatedOnce = 0;
+    int repeatedSkip = 0;
+    int repeatedTwice = 0;
+    int actionID = -1;
+    int64_t utc = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleActionInZone(clock, "30 2 * * *", "America/New_York",
+                                    countAction, &skippedOnce, &actionID);
+    assert(err == HORO_SUCCESS);
+#ifndef _WIN32
+    remove(path);
+    err = horo_openCheckpoint(clock, path, 16);
+    assert(err == HORO_SUCCESS);
+    err = horo_setActionKey(clock, actionID, "skipped");
+    assert(err == HORO_SUCCESS);
+#endif
+    memset(&limits, 0, sizeof(limits));
+    limits.maxInFlight = 1;
+    err = horo_setGroupLimits(clock, 1, &limits);
+    assert(err == HORO_SUCCESS);
+    err = horo_setActionGroup(clock, actionID, 1, 0);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleActionInZone(clock, "30 2 * * *", "America/New_York",
+                                    countAction, &skippedSkip, &actionID);
+    err = horo_setActionDstPolicy(clock, actionID, HORO_DST_SKIP);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleActionInZone(clock, "30 2 * * *", "America/New_York",
+                                    countAction, &skippedTwice, &actionID);
+    err = horo_setActionDstPolicy(clock, actionID, HORO_DST_RUN_TWICE);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleActionInZone(clock, "0,30 15 2 * * *", "America/New_York",
+                                    countAction, &skippedSeconds, &actionID);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleActionInZone(clock, "30 1 * * *", "America/New_York",
+                                    countAction, &repeatedOnce, &actionID);
+    err = horo_scheduleActionInZone(clock, "30 1 * * *", "America/New_York",
+                                    countAction, &repeatedSkip, &actionID);
+    err = horo_setActionDstPolicy(clock, actionID, HORO_DST_SKIP);
+    err = horo_scheduleActionInZone(clock, "30 1 * * *", "America/New_York",
+                                    countAction, &repeatedTwice, &actionID);
+    err = horo_setActionDstPolicy(clock, actionID, HORO_DST_RUN_TWICE);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_setActionDstPolicy(clock, actionID, (HORO_DST_POLICY)7);
+    assert(err == HORO_ERROR_ILLEGAL_ARG);
+    err = horo_setActionDstPolicy(clock, actionID + 1, HORO_DST_SKIP);
+    assert(err == HORO_ERROR_UNKNOWN_ACTION);
+
+    for(utc = springForward; utc < springForward + (20 * 60); utc += 30)
+    {
+        err = horo_processUtc(clock, utc);
+        assert(err == HORO_SUCCESS);
+    }
+    assert(skippedOnce == 1);
+    assert(skippedSkip == 0);
+    assert(skippedTwice == 0);
+    assert(skippedSeconds == 1);
+    err = horo_getGroupStats(clock, 1, &stats);
+    assert((stats.dispatched == 1) && (stats.inFlight == 1));
+
+    for(utc = fallBack; utc < fallBack + (150 * 60); utc += 30)
+    {
+        err = horo_processUtc(clock, utc);
+        assert(err == HORO_SUCCESS);
+    }
+    assert(repeatedOnce == 1);
+    assert(repeatedSkip == 1);
+    assert(repeatedTwice == 2);
+
+    horo_destroy(clock);
+
+#ifndef _WIN32
+    //The replayed run is checkpointed as a run at the skipped time
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "30 2 * * *", countAction, &restarted, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_setActionKey(clock, actionID, "skipped");
+    assert(err == HORO_SUCCESS);
+    err = horo_openCheckpoint(clock, path, 16);
+    assert(err == HORO_SUCCESS);
+    err = horo_process(clock, &skippedTime);
+    assert(restarted == 0);
+    skippedTime.dayOfMonth = 10;
+    skippedTime.dayOfWeek = 1;
+    err = horo_process(clock, &skippedTime);
+    assert(restarted == 1);
+    horo_destroy(clock);
+    remove(path);
+#endif
+}
+
+static void
+testSummaryCounts()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_time_t timeVals = {0, 0, 1, 1, 3, 0};
+    int hourly = 0;
+    int daily = 0;
+    int hourlyID = -1;
+    int dailyID = -1;
+    int minute = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleAction(clock, "0 * * * *", countAction, &hourly, &hourlyID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "30 5 * 1 *", countAction, &daily, &dailyID);
+    assert(err == HORO_SUCCESS);
+
+    for(timeVals.hour = 0; timeVals.hour < 24; timeVals.hour++)
+    {
+        for(minute = 0; minute < 60; minute++)
+        {
+            timeVals.minute = minute;
+            err = horo_process(clock, &timeVals);
+            assert(err == HORO_SUCCESS);
+        }
+    }
+    assert(hourly == 24);
+    assert(daily == 1);
+
+    //Removing an entry stops counting its values, the other entry still runs
+    err = horo_unscheduleAction(clock, hourlyID);
+    assert(err == HORO_SUCCESS);
+    timeVals.dayOfMonth = 2;
+    timeVals.hour = 5;
+    timeVals.minute = 0;
+    err = horo_process(clock, &timeVals);
+    assert(hourly == 24);
+    timeVals.minute = 30;
+    err = horo_process(clock, &timeVals);
+    assert(daily == 2);
+
+    //A month that no entry includes
+    timeVals.month = 2;
+    err = horo_process(clock, &timeVals);
+    assert(daily == 2);
+
+    err = horo_scheduleAction(clock, "30 5 * 2 *", countAction, &hourly, &hourlyID);
+    assert(err == HORO_SUCCESS);
+    err = horo_process(clock, &timeVals);
+    assert(hourly == 25);
+
+    horo_destroy(clock);
+}
+
+static void
+testDayPlan()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    //Wednesday, January 1st
+    horo_time_t timeVals = {0, 0, 1, 1, 3, 0};
+    int weekday = 0;
+    int dense = 0;
+    int added = 0;
+    int removed = 0;
+    int many = 0;
+    int moved[6] = {0, 0, 0, 0, 0, 0};
+    int movedIDs[6];
+    int removedID = -1;
+    int actionID = -1;
+    int i = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleAction(clock, "0 9 * * 1-5", countAction, &weekday, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "*/5 * * * *", countAction, &dense, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "0 10 * * *", countAction, &removed, &removedID);
+    assert(err == HORO_SUCCESS);
+
+    //Builds the plan for Wednesday
+    err = horo_process(clock, &timeVals);
+    assert(dense == 1);
+
+    //Added and removed while the plan is in use
+    err = horo_scheduleAction(clock, "0 11 * * *", countAction, &added, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_unscheduleAction(clock, removedID);
+    assert(err == HORO_SUCCESS);
+
+    //More additions than the plan keeps pending forces a rebuild
+    for(i = 0; i < 100; i++)
+    {
+        err = horo_scheduleAction(clock, "30 11 1 1 *", countAction, &many, &actionID);
+        assert(err == HORO_SUCCESS);
+    }
+
+    for(timeVals.hour = 0; timeVals.hour < 24; timeVals.hour++)
+    {
+        for(timeVals.minute = 0; timeVals.minute < 60; timeVals.minute++)
+        {
+            err = horo_process(clock, &timeVals);
+            assert(err == HORO_SUCCESS);
+        }
+    }
+    assert(weekday == 1);
+    assert(dense == 24 * 12);
+    assert(added == 1);
+    assert(removed == 0);
+    assert(many == 100);
+
+    //Saturday, January 4th
+    timeVals.dayOfMonth = 4;
+    timeVals.dayOfWeek = 6;
+    for(timeVals.hour = 0; timeVals.hour < 24; timeVals.hour++)
+    {
+        for(timeVals.minute = 0; timeVals.minute < 60; timeVals.minute++)
+        {
+            err = horo_process(clock, &timeVals);
+        }
+    }
+    assert(weekday == 1);
+    assert(dense == 2 * 24 * 12);
+    assert(added == 2);
+    assert(many == 100);
+
+    //Removals from the dense and pending arrays move their last entry in
+    for(i = 0; i < 3; i++)
+    {
+        err = horo_scheduleAction(clock, "*/2 * * * *", countAction, &moved[i],
+                                  &movedIDs[i]);
+        assert(err == HORO_SUCCESS);
+    }
+    timeVals.dayOfMonth = 5;
+    timeVals.dayOfWeek = 0;
+    timeVals.hour = 0;
+    timeVals.minute = 0;
+    err = horo_process(clock, &timeVals);
+    for(i = 3; i < 6; i++)
+    {
+        err = horo_scheduleAction(clock, "*/2 * * * *", countAction, &moved[i],
+                                  &movedIDs[i]);
+        assert(err == HORO_SUCCESS);
+    }
+    assert(horo_unscheduleAction(clock, movedIDs[0]) == HORO_SUCCESS);
+    assert(horo_rescheduleAction(clock, movedIDs[1], "0 12 * * *") == HORO_SUCCESS);
+    assert(horo_unscheduleAction(clock, movedIDs[3]) == HORO_SUCCESS);
+    for(timeVals.hour = 0; timeVals.hour < 24; timeVals.hour++)
+    {
+        for(timeVals.minute = 0; timeVals.minute < 60; timeVals.minute++)
+        {
+            err = horo_process(clock, &timeVals);
+        }
+    }
+    assert((moved[0] == 1) && (moved[1] == 2) && (moved[2] == 720));
+    assert((moved[3] == 0) && (moved[4] == 720) && (moved[5] == 720));
+
+    horo_destroy(clock);
+}
+
+static void
+testDayFields()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_time_t timeVals = {0, 0, 1, 1, 0, 0};
+    int fridayThe13th = 0;
+    int sundays = 0;
+    int fifteenths = 0;
+    int actionID = -1;
+    int day = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleAction(clock, "0 0 13 * 5", countAction, &fridayThe13th, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "0 0 * * 0", countAction, &sundays, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "0 0 15 2-12 *", countAction, &fifteenths, &actionID);
+    assert(err == HORO_SUCCESS);
+
+    //January 2014 starts on a Wednesday, 13th is a Monday
+    for(day = 1; day <= 31; day++)
+    {
+        timeVals.dayOfMonth = day;
+        timeVals.dayOfWeek = (day + 2) % 7;
+        err = horo_process(clock, &timeVals);
+        assert(err == HORO_SUCCESS);
+    }
+    assert(fridayThe13th == 0);
+    assert(sundays == 4);
+    assert(fifteenths == 0);
+
+    //June 2014 starts on a Sunday, 13th is a Friday
+    timeVals.month = 6;
+    for(day = 1; day <= 30; day++)
+    {
+        timeVals.dayOfMonth = day;
+        timeVals.dayOfWeek = (day - 1) % 7;
+        err = horo_process(clock, &timeVals);
+    }
+    assert(fridayThe13th == 1);
+    assert(sundays == 9);
+    assert(fifteenths == 1);
+
+    horo_destroy(clock);
+}
+
+static void
+testBatchSchedule()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_time_t timeVals = {0, 0, 1, 1, 3, 0};
+    horo_schedule_req_t reqs[1000];
+    int actionIDs[1000];
+    HORO_ERROR errors[1000];
+    int keepIDs[3];
+    int unknownIDs[3];
+    int fired = 0;
+    int actionCount = 0;
+    int i = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    for(i = 0; i < 1000; i++)
+    {
+        reqs[i].scheduleString = (i % 2) ? "0 * * * *" : "*/30 0 * * * *";
+        reqs[i].zoneName = NULL;
+        reqs[i].action = countAction;
+        reqs[i].actionData = &fired;
+    }
+
+    //A single bad request fails the whole batch
+    reqs[10].scheduleString = "61 * * * *";
+    reqs[20].zoneName = "Mars/Olympus_Mons";
+    err = horo_scheduleActions(clock, reqs, 1000, actionIDs, errors);
+    assert(err == HORO_ERROR_PARSER_MINUTE_RANGE);
+    assert(errors[9] == HORO_SUCCESS);
+    assert(errors[10] == HORO_ERROR_PARSER_MINUTE_RANGE);
+    assert(errors[20] == HORO_ERROR_UNKNOWN_ZONE);
+    err = horo_actionCount(clock, &actionCount);
+    assert(actionCount == 0);
+
+    reqs[10].scheduleString = "0 * * * *";
+    reqs[20].zoneName = NULL;
+    err = horo_scheduleActions(clock, reqs, 1000, actionIDs, errors);
+    assert(err == HORO_SUCCESS);
+    err = horo_actionCount(clock, &actionCount);
+    assert(actionCount == 1000);
+    for(i = 1; i < 1000; i++)
+    {
+        assert(actionIDs[i] == actionIDs[i - 1] + 1);
+    }
+
+    err = horo_scheduleActions(clock, reqs, 3, keepIDs, NULL);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_process(clock, &timeVals);
+    timeVals.second = 30;
+    err = horo_process(clock, &timeVals);
+    //501 minute and 499 seconds entries in the first batch, 1 and 2 in the second
+    assert(fired == (501 + (2 * 499)) + (1 + (2 * 2)));
+
+    //Unknown and repeated ids fail the whole batch
+    unknownIDs[0] = actionIDs[0];
+    unknownIDs[1] = 100000;
+    unknownIDs[2] = actionIDs[0];
+    err = horo_unscheduleActions(clock, unknownIDs, 3, errors);
+    assert(err == HORO_ERROR_UNKNOWN_ACTION);
+    assert(errors[0] == HORO_SUCCESS);
+    assert(errors[1] == HORO_ERROR_UNKNOWN_ACTION);
+    assert(errors[2] == HORO_ERROR_ILLEGAL_ARG);
+    err = horo_actionCount(clock, &actionCount);
+    assert(actionCount == 1003);
+
+    err = horo_unscheduleActions(clock, actionIDs, 1000, errors);
+    assert(err == HORO_SUCCESS);
+    err = horo_actionCount(clock, &actionCount);
+    assert(actionCount == 3);
+
+    fired = 0;
+    timeVals.hour = 1;
+    timeVals.second = 0;
+    err = horo_process(clock, &timeVals);
+    assert(fired == 3);
+
+    err = horo_unscheduleAction(clock, keepIDs[1]);
+    assert(err == HORO_SUCCESS);
+    err = horo_unscheduleAction(clock, actionIDs[0]);
+    assert(err == HORO_ERROR_UNKNOWN_ACTION);
+
+    horo_destroy(clock);
+}
+
+typedef struct
+{
+    horo_clock_t* clock;
+    int selfID;
+    int otherID;
+    int calls;
+    int scheduledID;
+    int scheduledCalls;
+    HORO_ERROR nestedErr;
+}mutatingAction_t;
+
+static void
+unscheduleSelfAndOther(void* data)
+{
+    mutatingAction_t* context = (mutatingAction_t*)data;
+    horo_time_t timeVals = {0, 0, 1, 1, 3, 0};
+
+    context->calls++;
+    assert(horo_unscheduleAction(context->clock, context->selfID) == HORO_SUCCESS);
+    assert(horo_unscheduleAction(context->clock, context->otherID) == HORO_SUCCESS);
+    assert(horo_unscheduleAction(context->clock, context->otherID) == HORO_ERROR_UNKNOWN_ACTION);
+    context->nestedErr = horo_process(context->clock, &timeVals);
+}
+
+static void
+countScheduled(void* data)
+{
+    ((mutatingAction_t*)data)->scheduledCalls++;
+}
+
+static void
+scheduleAnother(void* data)
+{
+    mutatingAction_t* context = (mutatingAction_t*)data;
+
+    context->calls++;
+    if(context->scheduledID < 0)
+    {
+        assert(horo_scheduleActionInZone(context->clock, "* * * * *", "UTC", countScheduled,
+                                         context, &context->scheduledID) == HORO_SUCCESS);
+    }
+}
+
+static void
+testCallbackMutation()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_time_t timeVals = {0, 3, 1, 1, 3, 0};
+    mutatingAction_t unscheduler;
+    mutatingAction_t scheduler;
+    int other = 0;
+    int oneShot = 0;
+    int actionID = -1;
+    int actionCount = 0;
+    int i = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+    memset(&unscheduler, 0, sizeof(unscheduler));
+    memset(&scheduler, 0, sizeof(scheduler));
+    unscheduler.clock = clock;
+    scheduler.clock = clock;
+    scheduler.scheduledID = -1;
+
+    err = horo_scheduleAction(clock, "* * * * *", unscheduleSelfAndOther, &unscheduler,
+                              &unscheduler.selfID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "* * * * *", countAction, &other, &unscheduler.otherID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleAction(clock, "* * * * *", scheduleAnother, &scheduler, &actionID);
+    assert(err == HORO_SUCCESS);
+
+    //A "run once at 03:00" job
+    err = horo_scheduleAction(clock, "0 3 * * *", countAction, &oneShot, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_setActionOneShot(clock, actionID, 1);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(unscheduler.calls == 1);
+    assert(unscheduler.nestedErr == HORO_ERROR_ILLEGAL_ARG);
+    assert(other == 0);
+    assert(scheduler.calls == 1);
+    assert(scheduler.scheduledID >= 0);
+    assert(scheduler.scheduledCalls == 0);
+    assert(oneShot == 1);
+
+    //Unscheduled entries are gone, the scheduled one stays
+    err = horo_actionCount(clock, &actionCount);
+    assert(actionCount == 2);
+    err = horo_unscheduleAction(clock, actionID);
+    assert(err == HORO_ERROR_UNKNOWN_ACTION);
+
+    for(i = 0; i < 3; i++)
+    {
+        err = horo_processUtc(clock, 1388545200 + (i * 24 * 60 * 60));
+        assert(err == HORO_SUCCESS);
+    }
+    assert(unscheduler.calls == 1);
+    assert(oneShot == 1);
+    assert(scheduler.scheduledCalls == 3);
+
+    horo_destroy(clock);
+}
+
+static void
+rescheduleSelf(void* data)
+{
+    mutatingAction_t* context = (mutatingAction_t*)data;
+
+    context->calls++;
+    assert(horo_rescheduleAction(context->clock, context->selfID, "0 4 * * *") == HORO_SUCCESS);
+}
+
+static void
+testReschedule()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_time_t timeVals = {0, 3, 1, 1, 3, 0};
+    mutatingAction_t rescheduler;
+    int actionIDs[100];
+    int count = 0;
+    int actionID = -1;
+    int i = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    err = horo_scheduleAction(clock, "0 3 * * *", countAction, &count, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_process(clock, &timeVals);
+    assert(count == 1);
+
+    //The id and action data stay, only the schedule changes
+    err = horo_rescheduleAction(clock, actionID, "5 3 * * *");
+    assert(err == HORO_SUCCESS);
+    timeVals.dayOfMonth = 2;
+    err = horo_process(clock, &timeVals);
+    assert(count == 1);
+    timeVals.minute = 5;
+    err = horo_process(clock, &timeVals);
+    assert(count == 2);
+
+    err = horo_rescheduleAction(clock, actionID, "61 3 * * *");
+    assert(err != HORO_SUCCESS);
+    err = horo_rescheduleAction(clock, actionID + 1, "5 3 * * *");
+    assert(err == HORO_ERROR_UNKNOWN_ACTION);
+
+    //Paused actions keep their schedule
+    err = horo_setActionEnabled(clock, actionID, 0);
+    assert(err == HORO_SUCCESS);
+    timeVals.dayOfMonth = 3;
+    err = horo_process(clock, &timeVals);
+    assert(count == 2);
+    err = horo_setActionEnabled(clock, actionID, 1);
+    assert(err == HORO_SUCCESS);
+    err = horo_process(clock, &timeVals);
+    assert(count == 3);
+
+    //Moving between the minute entries and the seconds wheel
+    err = horo_rescheduleAction(clock, actionID, "*/30 * * * * *");
+    assert(err == HORO_SUCCESS);
+    timeVals.second = 30;
+    err = horo_process(clock, &timeVals);
+    assert(count == 4);
+    err = horo_rescheduleAction(clock, actionID, "6 3 * * *");
+    assert(err == HORO_SUCCESS);
+    timeVals.minute = 6;
+    timeVals.second = 0;
+    err = horo_process(clock, &timeVals);
+    assert(count == 5);
+
+    //An action that reschedules itself runs on its new schedule from the next tick on
+    memset(&rescheduler, 0, sizeof(rescheduler));
+    rescheduler.clock = clock;
+    err = horo_scheduleAction(clock, "* * * * *", rescheduleSelf, &rescheduler,
+                              &rescheduler.selfID);
+    assert(err == HORO_SUCCESS);
+    timeVals.minute = 7;
+    err = horo_process(clock, &timeVals);
+    assert(rescheduler.calls == 1);
+    timeVals.minute = 8;
+    err = horo_process(clock, &timeVals);
+    assert(rescheduler.calls == 1);
+
+    //Ids stay reachable while others are unscheduled around them
+    for(i = 0; i < 100; i++)
+    {
+        err = horo_scheduleAction(clock, "0 0 1 1 *", dummyAction, NULL, &actionIDs[i]);
+        assert(err == HORO_SUCCESS);
+    }
+    for(i = 0; i < 100; i += 3)
+    {
+        err = horo_unscheduleAction(clock, actionIDs[i]);
+        assert(err == HORO_SUCCESS);
+    }
+    for(i = 0; i < 100; i++)
+    {
+        err = horo_setActionEnabled(clock, actionIDs[i], 0);
+        assert(err == ((i % 3) ? HORO_SUCCESS : HORO_ERROR_UNKNOWN_ACTION));
+    }
+    err = horo_setActionEnabled(clock, actionID, 0);
+    assert(err == HORO_SUCCESS);
+
+    horo_destroy(clock);
+}
+
+static void
+testScheduleSlices()
+{
+    const char buffer[] = "0 3 * * *5 3 * * *@hourly";
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_time_t timeVals = {0, 3, 1, 1, 3, 0};
+    int first = 0;
+    int second = 0;
+    int actionID = -1;
+    int otherID = -1;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+
+    //Schedules are parsed out of the buffer without a NUL terminator
+    err = horo_scheduleActionN(clock, buffer, 9, countAction, &first, &actionID);
+    assert(err == HORO_SUCCESS);
+    err = horo_scheduleActionN(clock, buffer + 9, 9, countAction, &second, &otherID);
+    assert(err == HORO_SUCCESS);
+    err = horo_process(clock, &timeVals);
+    assert((first == 1) && (second == 0));
+    timeVals.minute = 5;
+    err = horo_process(clock, &timeVals);
+    assert((first == 1) && (second == 1));
+
+    err = horo_rescheduleActionN(clock, actionID, buffer + 18, 7);
+    assert(err == HORO_SUCCESS);
+    timeVals.minute = 0;
+    timeVals.hour = 4;
+    err = horo_process(clock, &timeVals);
+    assert((first == 2) && (second == 1));
+
+    //A slice that runs into the next schedule is an error
+    err = horo_scheduleActionN(clock, buffer, 10, countAction, &first, &otherID);
+    assert(err == HORO_ERROR_PARSER_ILLEGAL_FIELD);
+    err = horo_rescheduleActionN(clock, actionID, buffer, 10);
+    assert(err == HORO_ERROR_PARSER_ILLEGAL_FIELD);
+    err = horo_scheduleActionN(clock, buffer, 0, countAction, &first, &otherID);
+    assert(err != HORO_SUCCESS);
+    err = horo_scheduleActionN(clock, NULL, 9, countAction, &first, &otherID);
+    assert(err == HORO_ERROR_ILLEGAL_ARG);
+
+    horo_destroy(clock);
+}
+
+static void
+checkCanonical(const char* schedule, const char* expected)
+{
+    char canonical[HORO_CANONICAL_SCHEDULE_MAX];
+    char again[HORO_CANONICAL_SCHEDULE_MAX];
+    uint64_t fingerprint = 0;
+    uint64_t againFingerprint = 0;
+    HORO_ERROR err = HORO_SUCCESS;
+
+    err = horo_canonicalizeSchedule(schedule, canonical, sizeof(canonical), &fingerprint);
+    assert(err == HORO_SUCCESS);
+    assert(strcmp(canonical, expected) == 0);
+
+    //The canonical form is its own canonical form
+    err = horo_canonicalizeSchedule(canonical, again, sizeof(again), &againFingerprint);
+    assert(err == HORO_SUCCESS);
+    assert(strcmp(again, canonical) == 0);
+    assert(againFingerprint == fingerprint);
+}
+
+static void
+testCanonicalSchedule()
+{
+    char canonical[HORO_CANONICAL_SCHEDULE_MAX];
+    uint64_t fingerprint = 0;
+    uint64_t other = 0;
+    HORO_ERROR err = HORO_SUCCESS;
+
+    checkCanonical("0-59 0-23 1-31 1-12 0-7", "* * * * *");
+    checkCanonical("*/1 * * * *", "* * * * *");
+    checkCanonical("0,15,30,45 * * * *", "*/15 * * * *");
+    checkCanonical("0-59/15 * * * *", "*/15 * * * *");
+    checkCanonical("@daily", "0 0 * * *");
+    checkCanonical("@weekly", "0 0 * * 0");
+    checkCanonical("5,6,7,8 9,10 * * 1-5", "5-8 9-10 * * 1-5");
+    checkCanonical("10-40/10 * */2 * *", "10-40/10 * */2 * *");
+    checkCanonical("1,2,7 * * 1,3,5,7,9,11 *", "1,2,7 * * 1-11/2 *");
+    checkCanonical("1-5,9-12 * * * *", "1-5,9-12 * * * *");
+    checkCanonical("0 */10 * * * *", "0 */10 * * * *");
+
+    //Numbers and ranges mix in a list, Sunday is 0
+    checkCanonical("1,2,3,5,7,9 * * * *", "1-3,5,7,9 * * * *");
+    checkCanonical("7-9,5 1,2,5-7 * * *", "5,7-9 1,2,5-7 * * *");
+    checkCanonical("0-57/3,1-58/3 * * * *",
+                   "0-1,3-4,6-7,9-10,12,13,15,16,18,19,21,22,24,25,27,28,30,31,"
+                   "33,34,36,37,39,40,42,43,45,46,48,49,51,52,54,55,57,58 * * * *");
+    checkCanonical("* * * * 7", "* * * * 0");
+    checkCanonical("* * * * 0,7", "* * * * 0");
+    checkCanonical("* * * * 5-7", "* * * * 0,5,6");
+    checkCanonical("* * * * 0-6", "* * * * *");
+
+    err = horo_canonicalizeSchedule("0,15,30,45 * * * *", NULL, 0, &fingerprint);
+    assert(err == HORO_SUCCESS);
+    err = horo_canonicalizeSchedule("*/15 * * * *", NULL, 0, &other);
+    assert(other == fingerprint);
+    err = horo_canonicalizeSchedule("*/15 * * * 1-6", NULL, 0, &other);
+    assert(other != fingerprint);
+    err = horo_canonicalizeSchedule("0 */15 * * * *", NULL, 0, &other);
+    assert(other != fingerprint);
+
+    //Fingerprints are persistent keys
+    err = horo_canonicalizeSchedule("* * * * *", NULL, 0, &fingerprint);
+    assert(fingerprint == 0x0413BC7EE5F1C689ULL);
+    err = horo_canonicalizeSchedule("0 0 * * 0", NULL, 0, &fingerprint);
+    err = horo_canonicalizeSchedule("0 0 * * 7", NULL, 0, &other);
+    assert(other == fingerprint);
+
+    err = horo_canonicalizeSchedule("*/15 * * * *", canonical, 5, NULL);
+    assert(err == HORO_ERROR_ILLEGAL_ARG);
+    err = horo_canonicalizeSchedule("61 * * * *", canonical, sizeof(canonical), NULL);
+    assert(err != HORO_SUCCESS);
+}
+
+static void
+checkValidation(const char* schedule, HORO_ERROR error, size_t offset, size_t length)
+{
+    horo_validation_t validation;
+    HORO_ERROR err = horo_validate(schedule, strlen(schedule), &validation);
+
+    assert(err == error);
+    assert(validation.error == error);
+    if(error != HORO_SUCCESS)
+    {
+        assert(validation.offset == offset);
+        assert(validation.length == length);
+    }
+}
+
+static void
+testValidate()
+{
+    const char slice[] = "*/5 * * * *0 0 1 1 *";
+    horo_validation_t validation;
+    HORO_ERROR err = HORO_SUCCESS;
+
+    checkValidation("*/5 * * * *", HORO_SUCCESS, 0, 0);
+    checkValidation("@hourly", HORO_SUCCESS, 0, 0);
+    checkValidation("*/10 0 12 * * *", HORO_SUCCESS, 0, 0);
+
+    checkValidation("0 24 * * *", HORO_ERROR_PARSER_HOUR_RANGE, 2, 2);
+    checkValidation("0 0 1 13 *", HORO_ERROR_PARSER_MONTH_RANGE, 6, 2);
+    checkValidation("60 0 1 1 * *", HORO_ERROR_PARSER_SECOND_RANGE, 0, 2);
+    checkValidation("0 60 1 1 * *", HORO_ERROR_PARSER_MINUTE_RANGE, 2, 2);
+    checkValidation("1,2,100 * * * *", HORO_ERROR_OUT_OF_RANGE, 0, 7);
+    checkValidation("0 0 x * *", HORO_ERROR_PARSER_ILLEGAL_FIELD, 4, 1);
+    checkValidation("0 0 * *", HORO_ERROR_PARSER_ILLEGAL_FIELD, 7, 0);
+    checkValidation("0 0 1--2 * *", HORO_ERROR_PARSER_ILLEGAL_FIELD, 4, 4);
+
+    //Schedules do not need a NUL terminator
+    err = horo_validate(slice, 11, &validation);
+    assert(err == HORO_SUCCESS);
+    err = horo_validate(slice + 11, 9, &validation);
+    assert(err == HORO_SUCCESS);
+    err = horo_validate(slice, 12, &validation);
+    assert(err == HORO_ERROR_PARSER_ILLEGAL_FIELD);
+    assert((validation.offset == 10) && (validation.length == 2));
+
+    err = horo_validate("* * * * *", 9, NULL);
+    assert(err == HORO_ERROR_ILLEGAL_ARG);
+}
+
+static void
+testCrontab()
+{
+    const char* path = "test-crontab.txt";
+    horo_clock_t* clock = NULL;
+    horo_crontab_t* crontab = NULL;
+    horo_crontab_diff_t diff;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_time_t timeVals = {7, 3, 1, 1, 0};
+    int counters[10] = {0};
+    int count = 0;
+
+    writeCrontab(path,
+                 "# comment\n"
+                 "MAILTO=root\n"
+                 "SHELL = /bin/sh\n"
+                 "* * * * * 0\n"
+                 "\n"
+                 "  7 3 * * *   1  \n"
+                 "@hourly 2\n");
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+    err = horo_crontabOpen(clock, path, resolveCommand, releaseCommand, counters,
+                           &crontab, &diff);
+    assert(err == HORO_SUCCESS);
+    assert((diff.added == 3) && (diff.removed == 0) && (diff.kept == 0));
+
+    err = horo_process(clock, &timeVals);
+    assert((counters[0] == 1) && (counters[1] == 1) && (counters[2] == 0));
+
+    //Unchanged lines keep their last run time, only the new line runs again
+    writeCrontab(path,
+                 "7 3 * * * 1\n"
+                 "* * * * * 0\n"
+                 "* * * * * 3\n");
+    err = horo_crontabReload(crontab, &diff);
+    assert(err == HORO_SUCCESS);
+    assert((diff.added == 1) && (diff.removed == 1) && (diff.kept == 2));
+    assert(counters[9] == 1);
+
+    err = horo_process(clock, &timeVals);
+    assert((counters[0] == 1) && (counters[1] == 1) && (counters[3] == 1));
+    err = horo_actionCount(clock, &count);
+    assert(count == 3);
+
+    //A bad line rejects the whole reload
+    writeCrontab(path,
+                 "* * * * * 4\n"
+                 "* * * * * fail\n");
+    err = horo_crontabReload(crontab, &diff);
+    assert(err == HORO_ERROR_UNKNOWN_ACTION);
+    assert(diff.errorLine == 2);
+    writeCrontab(path, "* * * * 4\n");
+    err = horo_crontabReload(crontab, &diff);
+    assert(err != HORO_SUCCESS);
+    assert(diff.errorLine == 1);
+    err = horo_actionCount(clock, &count);
+    assert(count == 3);
+
+    //Identical lines are matched one to one
+    writeCrontab(path,
+                 "* * * * * 0\n"
+                 "* * * * * 3\n"
+                 "* * * * * 0\n");
+    err = horo_crontabReload(crontab, &diff);
+    assert(err == HORO_SUCCESS);
+    assert((diff.added == 1) && (diff.removed == 1) && (diff.kept == 2));
+    err = horo_process(clock, &timeVals);
+    assert((counters[0] == 2) && (counters[3] == 1));
+
+    //Polling picks the change up
+    writeCrontab(path, "* * * * * 0\n");
+    err = horo_crontabPoll(crontab, &diff);
+    assert(err == HORO_SUCCESS);
+    assert((diff.removed == 2) && (diff.kept == 1));
+    err = horo_crontabPoll(crontab, &diff);
+    assert((diff.added == 0) && (diff.removed == 0));
+
+    err = horo_crontabClose(crontab);
+    assert(err == HORO_SUCCESS);
+    err = horo_actionCount(clock, &count);
+    assert(count == 0);
+    assert(counters[9] == 6);
+
+    horo_destroy(clock);
+    remove(path);
+}
+
+typedef struct
+{
+    horo_clock_t* clock;
+    int* log;
+    int* numLogged;
+    int index;
+
+    /*Nonzero to free the slot from within the callback*/
+    int groupID;
+}groupedAction_t;
+
+static void
+logGroupedAction(void* data)
+{
+    groupedAction_t* context = (groupedAction_t*)data;
+
+    context->log[(*context->numLogged)++] = context->index;
+    if(context->groupID != 0)
+    {
+        assert(horo_groupActionDone(context->clock, context->groupID) == HORO_SUCCESS);
+    }
+}
+
+static void
+testGroupLimits()
+{
+    horo_clock_t* clock = NULL;
+    HORO_ERROR err = HORO_SUCCESS;
+    horo_time_t timeVals = {0, 3, 1, 1, 3, 0};
+    horo_group_limits_t limits;
+    horo_group_stats_t stats;
+    groupedAction_t actions[10];
+    int priorities[5] = {0, 3, 3, 1, 0};
+    int log[32];
+    int numLogged = 0;
+    int actionIDs[10];
+    int count = 0;
+    int i = 0;
+
+    err = horo_init(&clock);
+    assert(err == HORO_SUCCESS);
+    for(i = 0; i < 10; i++)
+    {
+        actions[i].clock = clock;
+        actions[i].log = log;
+        actions[i].numLogged = &numLogged;
+        actions[i].index = i;
+        actions[i].groupID = 0;
+        err = horo_scheduleAction(clock, "* * * * *", logGroupedAction, &actions[i],
+                                  &actionIDs[i]);
+        assert(err == HORO_SUCCESS);
+    }
+
+    memset(&limits, 0, sizeof(limits));
+    limits.maxInFlight = 0;
+    assert(horo_setGroupLimits(clock, 1, &limits) == HORO_ERROR_ILLEGAL_ARG);
+    limits.maxInFlight = 2;
+    limits.maxPending = 3;
+    assert(horo_setGroupLimits(clock, 0, &limits) == HORO_ERROR_ILLEGAL_ARG);
+    assert(horo_setActionGroup(clock, actionIDs[0], 1, 0) == HORO_ERROR_UNKNOWN_GROUP);
+    err = horo_setGroupLimits(clock, 1, &limits);
+    assert(err == HORO_SUCCESS);
+    assert(horo_setActionGroup(clock, actionIDs[0], 1, HORO_GROUP_MAX_PRIORITY + 1) ==
+           HORO_ERROR_ILLEGAL_ARG);
+    assert(horo_groupActionDone(clock, 1) == HORO_ERROR_ILLEGAL_ARG);
+
+    //FIFO, 2 in flight and 3 waiting, the rest of the 9 is dropped
+    for(i = 1; i < 10; i++)
+    {
+        err = horo_setActionGroup(clock, actionIDs[i], 1, 0);
+        assert(err == HORO_SUCCESS);
+    }
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(numLogged == 3);
+    assert((log[0] == 0) && (log[1] == 1) && (log[2] == 2));
+    err = horo_getGroupStats(clock, 1, &stats);
+    assert(err == HORO_SUCCESS);
+    assert((stats.inFlight == 2) && (stats.pending == 3));
+    assert((stats.dispatched == 2) && (stats.queued == 7) && (stats.dropped == 4));
+
+    //Firing while still queued counts as a drop
+    timeVals.minute = 1;
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(numLogged == 4);
+    err = horo_getGroupStats(clock, 1, &stats);
+    assert((stats.pending == 3) && (stats.dropped == 4 + 3 + 6));
+
+    err = horo_groupActionDone(clock, 1);
+    assert(err == HORO_SUCCESS);
+    assert((numLogged == 5) && (log[4] == 3));
+    assert(horo_groupActionDone(clock, 1) == HORO_SUCCESS);
+    assert(horo_groupActionDone(clock, 1) == HORO_SUCCESS);
+    assert((numLogged == 7) && (log[5] == 4) && (log[6] == 5));
+    err = horo_getGroupStats(clock, 1, &stats);
+    assert((stats.inFlight == 2) && (stats.pending == 0));
+
+    //Actions that finish in their callback let the whole queue run
+    for(i = 1; i < 10; i++)
+    {
+        actions[i].groupID = 1;
+    }
+    assert(horo_groupActionDone(clock, 1) == HORO_SUCCESS);
+    assert(horo_groupActionDone(clock, 1) == HORO_SUCCESS);
+    numLogged = 0;
+    limits.maxInFlight = 1;
+    limits.maxPending = 8;
+    err = horo_setGroupLimits(clock, 1, &limits);
+    assert(err == HORO_SUCCESS);
+    timeVals.minute = 2;
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(numLogged == 10);
+    for(i = 0; i < 10; i++)
+    {
+        assert(log[i] == i);
+    }
+
+    //Priorities: of 0, 3, 3, 1, 0 the first 0 is pushed out by the 1
+    limits.maxInFlight = 1;
+    limits.maxPending = 2;
+    limits.order = HORO_GROUP_PRIORITY;
+    limits.overflow = HORO_GROUP_DROP_OLDEST;
+    err = horo_setGroupLimits(clock, 2, &limits);
+    assert(err == HORO_SUCCESS);
+    for(i = 0; i < 10; i++)
+    {
+        actions[i].groupID = 0;
+        err = horo_setActionGroup(clock, actionIDs[i], (i < 5) ? 2 : 0,
+                                  (i < 5) ? priorities[i] : 0);
+        assert(err == HORO_SUCCESS);
+    }
+    numLogged = 0;
+    timeVals.minute = 3;
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(numLogged == 6);
+    assert((log[0] == 5) && (log[4] == 9) && (log[5] == 1));
+    assert(horo_groupActionDone(clock, 2) == HORO_SUCCESS);
+    assert(horo_groupActionDone(clock, 2) == HORO_SUCCESS);
+    assert((numLogged == 8) && (log[6] == 2) && (log[7] == 3));
+    err = horo_getGroupStats(clock, 2, &stats);
+    assert((stats.inFlight == 1) && (stats.pending == 0) && (stats.dropped == 2));
+
+    //A queued one-shot action stays scheduled until it ran
+    for(i = 0; i < 10; i++)
+    {
+        err = horo_setActionOneShot(clock, actionIDs[i], i < 2);
+        assert(err == HORO_SUCCESS);
+        err = horo_setActionGroup(clock, actionIDs[i], (i < 2) ? 2 : 0, 0);
+        assert(err == HORO_SUCCESS);
+    }
+    assert(horo_groupActionDone(clock, 2) == HORO_SUCCESS);
+    numLogged = 0;
+    timeVals.minute = 4;
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    err = horo_actionCount(clock, &count);
+    assert((numLogged == 9) && (count == 9));
+    assert(horo_groupActionDone(clock, 2) == HORO_SUCCESS);
+    err = horo_actionCount(clock, &count);
+    assert((numLogged == 10) && (count == 8));
+
+    //A queued run moves with its action, or is dropped without a group
+    err = horo_setActionGroup(clock, actionIDs[2], 2, 0);
+    assert(err == HORO_SUCCESS);
+    err = horo_setActionGroup(clock, actionIDs[3], 2, 0);
+    assert(err == HORO_SUCCESS);
+    numLogged = 0;
+    timeVals.minute = 5;
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(numLogged == 6);
+    err = horo_setActionGroup(clock, actionIDs[3], 1, 0);
+    assert(err == HORO_SUCCESS);
+    err = horo_setActionGroup(clock, actionIDs[2], 0, 0);
+    assert(err == HORO_SUCCESS);
+    err = horo_getGroupStats(clock, 2, &stats);
+    assert((stats.pending == 0) && (stats.dropped == 3));
+    err = horo_getGroupStats(clock, 1, &stats);
+    assert(stats.pending == 1);
+    numLogged = 0;
+    timeVals.minute = 6;
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert((numLogged == 8) && (log[7] == 3));
+    err = horo_getGroupStats(clock, 1, &stats);
+    assert((stats.pending == 0) && (stats.inFlight == 1));
+
+    //A new priority moves a queued run ahead within its group
+    err = horo_setActionGroup(clock, actionIDs[2], 2, 0);
+    assert(err == HORO_SUCCESS);
+    err = horo_setActionGroup(clock, actionIDs[3], 2, 0);
+    assert(err == HORO_SUCCESS);
+    numLogged = 0;
+    timeVals.minute = 7;
+    err = horo_process(clock, &timeVals);
+    assert(err == HORO_SUCCESS);
+    assert(numLogged == 6);
+    err = horo_setActionGroup(clock, actionIDs[3], 2, 1);
+    assert(err == HORO_SUCCESS);
+    assert(horo_groupActionDone(clock, 2) == HORO_SUCCESS);
+    assert((numLogged == 7) && (log[6] == 3));
+    err = horo_getGroupStats(clock, 2, &stats);
+    assert(stats.pending == 1);
+
+    horo_destroy(clock);
+}
+
 int
 main(int argc, char** argv)
 {
     testRemove();
+    testActionStats();
+    testTraceHooks();
+    testForecast();
+    testQueryWindow();
+    testSnapshot();
+    testCheckpoint();
+    testSharedClock();
+    testCrontab();
+    testSeconds();
+    testZones();
+    testDstPolicies();
+    testSummaryCounts();
+    testDayPlan();
+    testDayFields();
+    testBatchSchedule();
+    testCallbackMutation();
+    testReschedule();
+    testScheduleSlices();
+    testCanonicalSchedule();
+    testValidate();
+    testGroupLimits();
     testMaxVals();
     testSpecialStrings();
     testLists();